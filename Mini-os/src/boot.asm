@@ -1,6 +1,13 @@
 [BITS 16]
 [ORG 0x7C00]
 
+; Kernel image size in 512-byte sectors (loaded to 0x10000, max 0x80000 bytes)
+KERNEL_SECTORS equ 256
+
+; 1.44 MB floppy geometry used to turn LBA sector numbers into CHS
+SECTORS_PER_TRACK equ 18
+HEADS             equ 2
+
 start:
     ; Initialize segments and stack to known state
     mov [boot_drive], dl  ; Save boot drive from DL
@@ -27,18 +34,34 @@ start:
     ; Save VBE mode info for kernel at 0x5000
     call save_vbe_info
     
-    ; Load kernel from disk to 0x10000 (64KB) - INCREASED SECTORS
+    ; Load kernel from disk to 0x10000 (64KB), one sector at a time so the
+    ; read never crosses a track or a 64KB DMA boundary
     mov ax, 0x1000        ; ES segment for 0x10000
     mov es, ax
     xor bx, bx            ; BX offset 0
-    mov ah, 0x02          ; BIOS read sectors function
-    mov al, 100           ; INCREASED: Number of sectors to read (was 50)
-    mov ch, 0             ; Cylinder 0
-    mov cl, 2             ; Sector 2 (after boot sector)
-    mov dh, 0             ; Head 0
+.read_sector:
+    mov ax, [lba]         ; LBA -> CHS
+    xor dx, dx
+    mov cx, SECTORS_PER_TRACK
+    div cx                ; AX = track, DX = sector index within track
+    mov cl, dl
+    inc cl                ; Sector (1-based)
+    xor dx, dx
+    mov si, HEADS
+    div si                ; AX = cylinder, DX = head
+    mov ch, al            ; Cylinder
+    mov dh, dl            ; Head
     mov dl, [boot_drive]  ; Boot drive
+    mov ax, 0x0201        ; BIOS read sectors function, 1 sector
     int 0x13              ; BIOS disk interrupt
     jc disk_error         ; Jump if disk error
+
+    mov ax, es            ; Next 512 bytes
+    add ax, 0x20
+    mov es, ax
+    inc word [lba]
+    cmp word [lba], KERNEL_SECTORS + 1
+    jb .read_sector
     
     mov si, load_msg
     call print_string
@@ -103,7 +126,7 @@ init_pm:
     ; Copy kernel from 0x10000 to 0x100000 (1MB) - UPDATED COUNT
     mov esi, 0x10000      ; Source address
     mov edi, 0x100000     ; Destination address
-    mov ecx, 100 * 128    ; UPDATED: 100 sectors * 128 dwords per sector (was 50)
+    mov ecx, KERNEL_SECTORS * 128 ; 128 dwords per sector
     cld                   ; Clear direction flag (forward copy)
     rep movsd             ; Copy ECX dwords from ESI to EDI
     
@@ -125,6 +148,7 @@ vbe_error_msg:   db 'VBE failed', 0x0D, 0x0A, 0
 load_msg:        db 'Kernel loaded', 0x0D, 0x0A, 0
 error_msg:       db 'Disk Error!', 0
 boot_drive:      db 0
+lba:             dw 1     ; Next sector to load (kernel starts after boot sector)
 
 ; === Global Descriptor Table ===
 gdt_start:
@@ -3,6 +3,7 @@
 #include "drivers/keyboard.h"
 #include "shell/shell.h"
 #include "snake/snake.h"
+#include "drivers/clock.h"
 
 // Helper function for string length
 static int string_length(const char* str) {
@@ -398,7 +399,7 @@ void run_shell_from_menu(void) {
     while (!shell_should_exit()) {
         // The shell runs via keyboard interrupts
         // Just wait here until exit command is executed
-        for (volatile int i = 0; i < 10000; i++);
+        udelay(1000);
     }
     
     // Clear screen and return to menu
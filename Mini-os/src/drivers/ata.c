@@ -0,0 +1,271 @@
+#include "ata.h"
+#include "../io.h"
+#include "../sched/sync.h"
+#include <stdint.h>
+
+// Command block register offsets
+#define ATA_REG_DATA     0
+#define ATA_REG_ERROR    1
+#define ATA_REG_COUNT    2
+#define ATA_REG_LBA0     3
+#define ATA_REG_LBA1     4
+#define ATA_REG_LBA2     5
+#define ATA_REG_DEVICE   6
+#define ATA_REG_STATUS   7              // read
+#define ATA_REG_COMMAND  7              // write
+
+// Status bits
+#define ATA_SR_ERR  0x01
+#define ATA_SR_DRQ  0x08
+#define ATA_SR_DF   0x20
+#define ATA_SR_BSY  0x80
+
+// Device control: interrupts off
+#define ATA_CTL_NIEN 0x02
+
+#define ATA_CMD_READ_SECTORS   0x20
+#define ATA_CMD_WRITE_SECTORS  0x30
+#define ATA_CMD_READ_MULTIPLE  0xC4
+#define ATA_CMD_WRITE_MULTIPLE 0xC5
+#define ATA_CMD_SET_MULTIPLE   0xC6
+#define ATA_CMD_FLUSH_CACHE    0xE7
+#define ATA_CMD_IDENTIFY       0xEC
+
+// Status polls before giving up (each is an I/O read, ~1us)
+#define ATA_TIMEOUT 2000000u
+
+#define ATA_CHANNELS 2
+
+static const uint16_t channel_io[ATA_CHANNELS] = {0x1F0, 0x170};
+static const uint16_t channel_ctrl[ATA_CHANNELS] = {0x3F6, 0x376};
+
+static ata_drive_t drives[ATA_MAX_DRIVES];
+
+// One command at a time per channel; the stats are per channel too so
+// they need no other lock.
+static mutex_t channel_lock[ATA_CHANNELS];
+static ata_stats_t channel_stats[ATA_CHANNELS];
+
+// The spec wants 400ns after selecting a drive before status is valid:
+// four reads of the alternate status register.
+static void ata_delay(const ata_drive_t* d) {
+    for (int i = 0; i < 4; i++) inb(d->ctrl);
+}
+
+// Wait for BSY to clear and, if want_drq, for DRQ. -1 on error or timeout.
+static int ata_wait(const ata_drive_t* d, int want_drq) {
+    for (uint32_t i = 0; i < ATA_TIMEOUT; i++) {
+        uint8_t status = inb(d->io + ATA_REG_STATUS);
+        if (status & ATA_SR_BSY) continue;
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) return -1;
+        if (!want_drq || (status & ATA_SR_DRQ)) return 0;
+    }
+    return -1;
+}
+
+// Select the drive and load an LBA28 address and sector count (0 = 256)
+static void ata_setup(const ata_drive_t* d, uint32_t lba, uint32_t count) {
+    outb(d->io + ATA_REG_DEVICE, (uint8_t)(0xE0 | (d->slave << 4) | ((lba >> 24) & 0x0F)));
+    ata_delay(d);
+    outb(d->io + ATA_REG_COUNT, (uint8_t)count);
+    outb(d->io + ATA_REG_LBA0, (uint8_t)lba);
+    outb(d->io + ATA_REG_LBA1, (uint8_t)(lba >> 8));
+    outb(d->io + ATA_REG_LBA2, (uint8_t)(lba >> 16));
+}
+
+// Copy an IDENTIFY string (byte-swapped words) and trim trailing spaces
+static void ata_copy_string(char* dst, const uint16_t* words, int nwords) {
+    int len = 0;
+    for (int i = 0; i < nwords; i++) {
+        dst[len++] = (char)(words[i] >> 8);
+        dst[len++] = (char)(words[i] & 0xFF);
+    }
+    while (len > 0 && dst[len - 1] == ' ') len--;
+    dst[len] = '\0';
+}
+
+static void ata_probe(int dev) {
+    ata_drive_t* d = &drives[dev];
+    int channel = dev / 2;
+    d->present = 0;
+    d->io = channel_io[channel];
+    d->ctrl = channel_ctrl[channel];
+    d->slave = (uint8_t)(dev & 1);
+    d->multiple = 0;
+
+    // A floating bus reads 0xFF: no controller on this channel
+    if (inb(d->io + ATA_REG_STATUS) == 0xFF) return;
+
+    outb(d->ctrl, ATA_CTL_NIEN);
+    outb(d->io + ATA_REG_DEVICE, (uint8_t)(0xA0 | (d->slave << 4)));
+    ata_delay(d);
+    outb(d->io + ATA_REG_COUNT, 0);
+    outb(d->io + ATA_REG_LBA0, 0);
+    outb(d->io + ATA_REG_LBA1, 0);
+    outb(d->io + ATA_REG_LBA2, 0);
+    outb(d->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    if (inb(d->io + ATA_REG_STATUS) == 0) return; // No drive
+
+    for (uint32_t i = 0; i < ATA_TIMEOUT; i++) {
+        if (!(inb(d->io + ATA_REG_STATUS) & ATA_SR_BSY)) break;
+    }
+    // ATAPI and SATA devices answer with a signature instead
+    if (inb(d->io + ATA_REG_LBA1) || inb(d->io + ATA_REG_LBA2)) return;
+    if (ata_wait(d, 1) < 0) return;
+
+    uint16_t id[256];
+    insw(d->io + ATA_REG_DATA, id, 256);
+
+    d->sectors = (uint32_t)id[60] | ((uint32_t)id[61] << 16);
+    if (d->sectors == 0) return; // No LBA
+    ata_copy_string(d->model, &id[27], 20);
+
+    // READ/WRITE MULTIPLE: word 47 holds the largest block size
+    uint32_t max_multiple = id[47] & 0xFF;
+    if (max_multiple > 1) {
+        uint32_t multiple = max_multiple < ATA_MULTIPLE_MAX ? max_multiple : ATA_MULTIPLE_MAX;
+        outb(d->io + ATA_REG_DEVICE, (uint8_t)(0xE0 | (d->slave << 4)));
+        ata_delay(d);
+        outb(d->io + ATA_REG_COUNT, (uint8_t)multiple);
+        outb(d->io + ATA_REG_COMMAND, ATA_CMD_SET_MULTIPLE);
+        ata_delay(d);
+        if (ata_wait(d, 0) == 0) d->multiple = (uint8_t)multiple;
+    }
+    d->present = 1;
+}
+
+int ata_init(void) {
+    int found = 0;
+    for (int c = 0; c < ATA_CHANNELS; c++) {
+        mutex_init(&channel_lock[c], "ata");
+    }
+    for (int dev = 0; dev < ATA_MAX_DRIVES; dev++) {
+        ata_probe(dev);
+        if (drives[dev].present) found++;
+    }
+    return found;
+}
+
+const ata_drive_t* ata_drive(int dev) {
+    if (dev < 0 || dev >= ATA_MAX_DRIVES || !drives[dev].present) return 0;
+    return &drives[dev];
+}
+
+static int ata_range_ok(const ata_drive_t* d, uint32_t lba, uint32_t count) {
+    return d && count > 0 && lba < d->sectors && count <= d->sectors - lba;
+}
+
+// One command of up to 256 sectors
+static int ata_pio_read(const ata_drive_t* d, uint32_t lba, uint32_t count, uint16_t* buf) {
+    ata_setup(d, lba, count);
+    outb(d->io + ATA_REG_COMMAND, d->multiple ? ATA_CMD_READ_MULTIPLE : ATA_CMD_READ_SECTORS);
+
+    uint32_t per_drq = d->multiple ? d->multiple : 1;
+    while (count > 0) {
+        // Status is stale for 400ns after the command and after each block
+        ata_delay(d);
+        if (ata_wait(d, 1) < 0) return -1;
+        uint32_t n = count < per_drq ? count : per_drq;
+        for (uint32_t s = 0; s < n; s++) {
+            insw(d->io + ATA_REG_DATA, buf, 256);
+            buf += 256;
+        }
+        count -= n;
+    }
+    return 0;
+}
+
+static int ata_pio_write(const ata_drive_t* d, uint32_t lba, uint32_t count, const uint16_t* buf) {
+    ata_setup(d, lba, count);
+    outb(d->io + ATA_REG_COMMAND, d->multiple ? ATA_CMD_WRITE_MULTIPLE : ATA_CMD_WRITE_SECTORS);
+
+    uint32_t per_drq = d->multiple ? d->multiple : 1;
+    while (count > 0) {
+        // Status is stale for 400ns after the command and after each block
+        ata_delay(d);
+        if (ata_wait(d, 1) < 0) return -1;
+        uint32_t n = count < per_drq ? count : per_drq;
+        for (uint32_t s = 0; s < n; s++) {
+            outsw(d->io + ATA_REG_DATA, buf, 256);
+            buf += 256;
+        }
+        count -= n;
+    }
+    ata_delay(d);
+    return ata_wait(d, 0);
+}
+
+int ata_read(int dev, uint32_t lba, uint32_t count, void* buf) {
+    const ata_drive_t* d = ata_drive(dev);
+    if (!ata_range_ok(d, lba, count)) return -1;
+
+    int channel = dev / 2;
+    int result = 0;
+    uint16_t* p = (uint16_t*)buf;
+    mutex_lock(&channel_lock[channel]);
+    while (count > 0 && result == 0) {
+        uint32_t n = count < 256 ? count : 256;
+        result = ata_pio_read(d, lba, n, p);
+        channel_stats[channel].read_cmds++;
+        if (result == 0) channel_stats[channel].sectors_read += n;
+        lba += n;
+        count -= n;
+        p += n * 256;
+    }
+    if (result < 0) channel_stats[channel].errors++;
+    mutex_unlock(&channel_lock[channel]);
+    return result;
+}
+
+int ata_write(int dev, uint32_t lba, uint32_t count, const void* buf) {
+    const ata_drive_t* d = ata_drive(dev);
+    if (!ata_range_ok(d, lba, count)) return -1;
+
+    int channel = dev / 2;
+    int result = 0;
+    const uint16_t* p = (const uint16_t*)buf;
+    mutex_lock(&channel_lock[channel]);
+    while (count > 0 && result == 0) {
+        uint32_t n = count < 256 ? count : 256;
+        result = ata_pio_write(d, lba, n, p);
+        channel_stats[channel].write_cmds++;
+        if (result == 0) channel_stats[channel].sectors_written += n;
+        lba += n;
+        count -= n;
+        p += n * 256;
+    }
+    if (result < 0) channel_stats[channel].errors++;
+    mutex_unlock(&channel_lock[channel]);
+    return result;
+}
+
+int ata_flush(int dev) {
+    const ata_drive_t* d = ata_drive(dev);
+    if (!d) return -1;
+
+    int channel = dev / 2;
+    mutex_lock(&channel_lock[channel]);
+    outb(d->io + ATA_REG_DEVICE, (uint8_t)(0xE0 | (d->slave << 4)));
+    ata_delay(d);
+    outb(d->io + ATA_REG_COMMAND, ATA_CMD_FLUSH_CACHE);
+    ata_delay(d);
+    int result = ata_wait(d, 0);
+    if (result < 0) channel_stats[channel].errors++;
+    mutex_unlock(&channel_lock[channel]);
+    return result;
+}
+
+void ata_get_stats(ata_stats_t* out) {
+    out->read_cmds = 0;
+    out->write_cmds = 0;
+    out->sectors_read = 0;
+    out->sectors_written = 0;
+    out->errors = 0;
+    for (int c = 0; c < ATA_CHANNELS; c++) {
+        out->read_cmds += channel_stats[c].read_cmds;
+        out->write_cmds += channel_stats[c].write_cmds;
+        out->sectors_read += channel_stats[c].sectors_read;
+        out->sectors_written += channel_stats[c].sectors_written;
+        out->errors += channel_stats[c].errors;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+
+// ATA disks on the two legacy IDE channels (QEMU: -drive if=ide), driven
+// with polled PIO and LBA28 addressing. Device interrupts are masked
+// (nIEN); callers sleep on the channel mutex, not on IRQ 14/15.
+//
+// Transfers move whole sectors with one 256-word rep insw/outsw each.
+// Drives that support it are switched to READ/WRITE MULTIPLE, so one DRQ
+// handshake covers up to ATA_MULTIPLE_MAX sectors.
+
+#define ATA_MAX_DRIVES    4            // primary master/slave, secondary master/slave
+#define ATA_SECTOR_SIZE   512
+#define ATA_MULTIPLE_MAX  16
+
+typedef struct {
+    int present;
+    uint16_t io;                        // command block ports
+    uint16_t ctrl;                      // alternate status / device control
+    uint8_t slave;
+    uint8_t multiple;                   // sectors per DRQ block (0: one-sector commands)
+    uint32_t sectors;                   // LBA28 capacity
+    char model[41];
+} ata_drive_t;
+
+typedef struct {
+    uint32_t read_cmds;
+    uint32_t write_cmds;
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    uint32_t errors;
+} ata_stats_t;
+
+// Probe both channels with IDENTIFY. Call after sched_init() (the channel
+// locks are mutexes). Returns the number of disks found.
+int ata_init(void);
+
+// Drive dev (0..ATA_MAX_DRIVES-1), or 0 if there is no disk there
+const ata_drive_t* ata_drive(int dev);
+
+// Transfer count sectors starting at lba. Returns 0, or -1 on a bad range,
+// a device error or a timeout.
+int ata_read(int dev, uint32_t lba, uint32_t count, void* buf);
+int ata_write(int dev, uint32_t lba, uint32_t count, const void* buf);
+
+// Commit the drive's write cache to the medium
+int ata_flush(int dev);
+
+void ata_get_stats(ata_stats_t* out);
+
+#endif
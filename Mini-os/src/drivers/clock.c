@@ -0,0 +1,161 @@
+#include "clock.h"
+#include "pit.h"
+#include "../io.h"
+
+// TSC-based monotonic clock.
+// The TSC rate is measured once at boot by timing a fixed PIT channel 2
+// countdown, then cycles are converted to ns with a 32-bit fixed-point
+// multiplier (no 64-bit division, so no libgcc helpers are needed).
+
+#define PIT_BASE_HZ       1193182u
+#define PIT_CHANNEL2      0x42
+#define PIT_COMMAND       0x43
+#define PIT_GATE_PORT     0x61
+
+#define CALIBRATE_MS      10u
+#define CALIBRATE_LATCH   (PIT_BASE_HZ / (1000u / CALIBRATE_MS))
+#define CALIBRATE_ROUNDS  3
+
+static int has_tsc = 0;
+static uint32_t tsc_khz = 0;
+static uint64_t tsc_base = 0;
+static uint32_t ns_mult = 0;
+static uint32_t ns_shift = 0;
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// 64/32 division using two 32-bit divides (avoids __udivdi3).
+uint64_t div_u64_u32(uint64_t n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t lo = (uint32_t)n;
+    uint32_t q_hi = hi / d;
+    uint32_t r = hi % d;
+    uint32_t q_lo;
+    __asm__("divl %4" : "=a"(q_lo), "=d"(r) : "a"(lo), "d"(r), "rm"(d));
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
+
+// (a * mul) >> shift with a 64-bit a and shift <= 32.
+static uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift) {
+    uint64_t lo = (uint64_t)(uint32_t)a * mul;
+    uint64_t hi = (uint64_t)(uint32_t)(a >> 32) * mul;
+    return (lo >> shift) + (hi << (32u - shift));
+}
+
+static int cpu_has_tsc(void) {
+    uint32_t regs[4];
+    if (!cpu_cpuid(1, regs)) return 0;
+    return (regs[3] >> 4) & 1u;  // EDX.TSC
+}
+
+// Time one CALIBRATE_MS countdown of PIT channel 2 (mode 0) in TSC cycles.
+static uint32_t measure_tsc_window(void) {
+    // Gate low, speaker off, then program channel 2 for a one-shot count.
+    outb(PIT_GATE_PORT, inb(PIT_GATE_PORT) & ~0x03u);
+    outb(PIT_COMMAND, 0xB0); // channel 2, lobyte/hibyte, mode 0, binary
+    outb(PIT_CHANNEL2, (uint8_t)(CALIBRATE_LATCH & 0xFF));
+    outb(PIT_CHANNEL2, (uint8_t)((CALIBRATE_LATCH >> 8) & 0xFF));
+
+    // Raising the gate starts the count; OUT2 (bit 5) goes high at zero.
+    outb(PIT_GATE_PORT, (inb(PIT_GATE_PORT) & ~0x02u) | 0x01u);
+    uint64_t start = rdtsc();
+    while ((inb(PIT_GATE_PORT) & 0x20) == 0) {
+        // spin
+    }
+    uint64_t end = rdtsc();
+
+    outb(PIT_GATE_PORT, inb(PIT_GATE_PORT) & ~0x03u);
+    return (uint32_t)(end - start);
+}
+
+void clock_init(void) {
+    has_tsc = cpu_has_tsc();
+    tsc_khz = 0;
+    if (!has_tsc) return;
+
+    // Take the shortest window: interrupts can only make a round longer.
+    uint32_t best = 0xFFFFFFFFu;
+    for (int i = 0; i < CALIBRATE_ROUNDS; i++) {
+        uint32_t cycles = measure_tsc_window();
+        if (cycles < best) best = cycles;
+    }
+    if (best == 0 || best == 0xFFFFFFFFu) {
+        has_tsc = 0;
+        return;
+    }
+
+    tsc_khz = best / CALIBRATE_MS;
+    if (tsc_khz == 0) {
+        has_tsc = 0;
+        return;
+    }
+
+    // ns = cycles * 1e6 / khz = (cycles * ns_mult) >> ns_shift.
+    // Use the largest shift whose multiplier still fits in 32 bits.
+    ns_shift = 32;
+    while (ns_shift > 0 && div_u64_u32(1000000ull << ns_shift, tsc_khz) > 0xFFFFFFFFull) {
+        ns_shift--;
+    }
+    ns_mult = (uint32_t)div_u64_u32(1000000ull << ns_shift, tsc_khz);
+
+    tsc_base = rdtsc();
+}
+
+uint64_t clock_cycles(void) {
+    return has_tsc ? rdtsc() : 0;
+}
+
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+    if (!has_tsc) return 0;
+    return mul_u64_u32_shr(cycles, ns_mult, ns_shift);
+}
+
+uint64_t clock_ns(void) {
+    if (!has_tsc) {
+        return pit_get_ticks() * (1000000000u / pit_get_frequency());
+    }
+    return mul_u64_u32_shr(rdtsc() - tsc_base, ns_mult, ns_shift);
+}
+
+uint32_t clock_tsc_khz(void) {
+    return tsc_khz;
+}
+
+int clock_tsc_params(uint64_t* base, uint32_t* mult, uint32_t* shift) {
+    if (!has_tsc) return 0;
+    *base = tsc_base;
+    *mult = ns_mult;
+    *shift = ns_shift;
+    return 1;
+}
+
+void ndelay(uint32_t ns) {
+    if (!has_tsc) {
+        // Each port 0x80 write takes roughly a microsecond.
+        for (uint32_t i = 0; i < (ns + 999u) / 1000u; i++) io_wait();
+        return;
+    }
+
+    uint64_t wait = div_u64_u32((uint64_t)ns * tsc_khz + 999999u, 1000000u);
+    uint64_t start = rdtsc();
+    while (rdtsc() - start < wait) {
+        __asm__ __volatile__("pause");
+    }
+}
+
+void udelay(uint32_t us) {
+    if (!has_tsc) {
+        for (uint32_t i = 0; i < us; i++) io_wait();
+        return;
+    }
+
+    uint64_t wait = div_u64_u32((uint64_t)us * tsc_khz + 999u, 1000u);
+    uint64_t start = rdtsc();
+    while (rdtsc() - start < wait) {
+        __asm__ __volatile__("pause");
+    }
+}
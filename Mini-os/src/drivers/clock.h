@@ -0,0 +1,32 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Calibrate the TSC against PIT channel 2. Call once after pit_init().
+void clock_init(void);
+
+// Raw TSC value (0 if the CPU has no TSC).
+uint64_t clock_cycles(void);
+
+// Monotonic nanoseconds since clock_init(). Falls back to PIT ticks without a TSC.
+uint64_t clock_ns(void);
+
+// Convert a TSC cycle delta to nanoseconds.
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+// Calibrated TSC frequency in kHz (0 if uncalibrated).
+uint32_t clock_tsc_khz(void);
+
+// Conversion used by clock_ns(): ns = ((tsc - base) * mult) >> shift.
+// Returns 0 without a calibrated TSC.
+int clock_tsc_params(uint64_t* base, uint32_t* mult, uint32_t* shift);
+
+// 64-by-32 unsigned division without libgcc's __udivdi3.
+uint64_t div_u64_u32(uint64_t n, uint32_t d);
+
+// Busy-wait for at least the given time.
+void ndelay(uint32_t ns);
+void udelay(uint32_t us);
+
+#endif
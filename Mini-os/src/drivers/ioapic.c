@@ -0,0 +1,83 @@
+#include "ioapic.h"
+#include "../mem/paging.h"
+
+#define IOAPIC_REG_SELECT   0x00
+#define IOAPIC_REG_WINDOW   0x10
+
+#define IOAPIC_VER          0x01
+#define IOAPIC_REDTBL(pin)  (0x10 + 2 * (pin))
+
+// Redirection entry bits (low dword)
+#define REDIR_ACTIVE_LOW    0x00002000u
+#define REDIR_LEVEL         0x00008000u
+#define REDIR_MASKED        0x00010000u
+
+// MPS INTI flags: polarity in bits 0-1, trigger mode in bits 2-3
+#define MPS_POLARITY_LOW    0x3u
+#define MPS_TRIGGER_LEVEL   0xCu
+
+// Page flags: present/RW plus write-through and cache-disable for MMIO
+#define MMIO_PAGE_FLAGS     (0x002u | 0x008u | 0x010u)
+
+static volatile uint32_t* ioapic = 0;
+static uint32_t gsi_first = 0;
+static uint32_t pin_count = 0;
+
+static uint32_t ioapic_read(uint32_t reg) {
+    ioapic[IOAPIC_REG_SELECT / 4] = reg;
+    return ioapic[IOAPIC_REG_WINDOW / 4];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value) {
+    ioapic[IOAPIC_REG_SELECT / 4] = reg;
+    ioapic[IOAPIC_REG_WINDOW / 4] = value;
+}
+
+void ioapic_init(uint32_t phys_base, uint32_t gsi_base) {
+    if (!phys_base) return;
+    uint32_t page = phys_base & ~0xFFFu;
+    paging_map_page(page, page, MMIO_PAGE_FLAGS);
+    __asm__ __volatile__("invlpg (%0)" : : "r"(page) : "memory");
+    ioapic = (volatile uint32_t*)phys_base;
+    gsi_first = gsi_base;
+
+    // Maximum redirection entry index lives in bits 16-23 of the version.
+    pin_count = ((ioapic_read(IOAPIC_VER) >> 16) & 0xFFu) + 1;
+    for (uint32_t pin = 0; pin < pin_count; pin++) {
+        ioapic_write(IOAPIC_REDTBL(pin), REDIR_MASKED);
+        ioapic_write(IOAPIC_REDTBL(pin) + 1, 0);
+    }
+}
+
+int ioapic_is_present(void) {
+    return ioapic != 0;
+}
+
+int ioapic_has_gsi(uint32_t gsi) {
+    return ioapic && gsi >= gsi_first && gsi - gsi_first < pin_count;
+}
+
+void ioapic_route(uint32_t gsi, uint8_t vector, uint8_t apic_id, uint16_t mps_flags) {
+    if (!ioapic_has_gsi(gsi)) return;
+    uint32_t pin = gsi - gsi_first;
+
+    uint32_t low = REDIR_MASKED | vector;  // fixed delivery, physical destination
+    if ((mps_flags & MPS_POLARITY_LOW) == MPS_POLARITY_LOW) low |= REDIR_ACTIVE_LOW;
+    if ((mps_flags & MPS_TRIGGER_LEVEL) == MPS_TRIGGER_LEVEL) low |= REDIR_LEVEL;
+
+    ioapic_write(IOAPIC_REDTBL(pin), REDIR_MASKED);
+    ioapic_write(IOAPIC_REDTBL(pin) + 1, (uint32_t)apic_id << 24);
+    ioapic_write(IOAPIC_REDTBL(pin), low);
+}
+
+void ioapic_set_masked(uint32_t gsi, int masked) {
+    if (!ioapic_has_gsi(gsi)) return;
+    uint32_t reg = IOAPIC_REDTBL(gsi - gsi_first);
+    uint32_t low = ioapic_read(reg);
+    if (masked) {
+        low |= REDIR_MASKED;
+    } else {
+        low &= ~REDIR_MASKED;
+    }
+    ioapic_write(reg, low);
+}
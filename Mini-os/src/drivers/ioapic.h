@@ -0,0 +1,25 @@
+#ifndef IOAPIC_H
+#define IOAPIC_H
+
+#include <stdint.h>
+
+// IO-APIC: routes external interrupt pins (global system interrupts, GSIs)
+// to a vector on a chosen local APIC. Registers are reached through an
+// index/data window; the base comes from the ACPI MADT / MP tables.
+
+// Map the IO-APIC and mask every pin. Call after paging_init().
+void ioapic_init(uint32_t phys_base, uint32_t gsi_base);
+
+int ioapic_is_present(void);
+
+// Does this IO-APIC serve the given GSI?
+int ioapic_has_gsi(uint32_t gsi);
+
+// Program a pin: fixed delivery of vector to apic_id, with polarity and
+// trigger taken from MPS INTI flags (0 = ISA default: edge, active high).
+// The pin is left masked.
+void ioapic_route(uint32_t gsi, uint8_t vector, uint8_t apic_id, uint16_t mps_flags);
+
+void ioapic_set_masked(uint32_t gsi, int masked);
+
+#endif
@@ -1,7 +1,11 @@
 #include "../drivers/keyboard.h"
+#include "../drivers/tty.h"
 #include "../graphic/vbe.h"
 #include "../io.h"
+#include "../idt.h"
 #include "../shell/shell.h"
+#include "../sched/softirq.h"
+#include "../sched/workqueue.h"
 #include <stdint.h>
 
 // Remove buffer variables, keep only scale
@@ -15,6 +19,20 @@ static volatile uint8_t kbd_tail = 0;
 
 static volatile int shell_input_enabled = 0;
 
+// Raw scancodes queued by the IRQ1 top half for the keyboard softirq.
+#define KBD_RAW_SIZE 32
+static volatile uint8_t kbd_raw[KBD_RAW_SIZE];
+static volatile uint8_t kbd_raw_head = 0;
+static volatile uint8_t kbd_raw_tail = 0;
+
+// Translated characters waiting for the shell (runs on kworker, since a
+// newline executes a whole command).
+#define SHELL_CHAR_SIZE 64
+static volatile char shell_chars[SHELL_CHAR_SIZE];
+static volatile uint8_t shell_chars_head = 0;
+static volatile uint8_t shell_chars_tail = 0;
+static work_t shell_input_work;
+
 // Key state tracking
 bool shift_pressed = false;
 bool ctrl_pressed = false;
@@ -46,6 +64,10 @@ void keyboard_flush_scancodes(void) {
     kbd_tail = kbd_head;
 }
 
+void keyboard_discard_shell_input(void) {
+    shell_chars_tail = shell_chars_head;
+}
+
 void keyboard_set_shell_input(int enabled) {
     shell_input_enabled = enabled ? 1 : 0;
 }
@@ -105,8 +127,41 @@ void set_text_scale(int scale) {
     }
 }
 
+// IRQ1 top half: grab the scancode and defer everything else.
 void handle_keyboard(void) {
     uint8_t scancode = inb(0x60);
+    uint8_t next = (uint8_t)((kbd_raw_head + 1) % KBD_RAW_SIZE);
+    if (next != kbd_raw_tail) {
+        kbd_raw[kbd_raw_head] = scancode;
+        kbd_raw_head = next;
+    }
+    softirq_raise(SOFTIRQ_KEYBOARD);
+}
+
+static void shell_queue_char(char c) {
+    uint8_t next = (uint8_t)((shell_chars_head + 1) % SHELL_CHAR_SIZE);
+    if (next == shell_chars_tail) {
+        // Shell is behind; drop the keystroke.
+        return;
+    }
+    shell_chars[shell_chars_head] = c;
+    shell_chars_head = next;
+    queue_work(&shell_input_work);
+}
+
+// kworker: feed queued characters to the shell.
+static void shell_input_worker(void* arg) {
+    (void)arg;
+    while (shell_chars_tail != shell_chars_head) {
+        char c = shell_chars[shell_chars_tail];
+        shell_chars_tail = (uint8_t)((shell_chars_tail + 1) % SHELL_CHAR_SIZE);
+        if (shell_input_enabled) {
+            shell_add_char(c);
+        }
+    }
+}
+
+static void keyboard_process_scancode(uint8_t scancode) {
     char key = 0;
 
     // Always enqueue raw scancode for menu/game consumers.
@@ -166,14 +221,32 @@ void handle_keyboard(void) {
                     break;
             }
         } else if (key != 0) {
-            // Forward to shell only when shell input is enabled.
+            // A task reading the tty gets the key; otherwise forward it to
+            // the shell when shell input is enabled.
+            if (tty_input(key)) {
+                return;
+            }
             if (shell_input_enabled) {
-                shell_add_char(key);
+                shell_queue_char(key);
             }
         }
     }
 }
 
+// Keyboard softirq: translate everything the top half queued.
+static void keyboard_softirq(void) {
+    while (kbd_raw_tail != kbd_raw_head) {
+        uint8_t scancode = kbd_raw[kbd_raw_tail];
+        kbd_raw_tail = (uint8_t)((kbd_raw_tail + 1) % KBD_RAW_SIZE);
+        keyboard_process_scancode(scancode);
+    }
+}
+
+static void keyboard_irq(void* ctx) {
+    (void)ctx;
+    handle_keyboard();
+}
+
 // Initialize keyboard driver
 void init_keyboard(void) {
     shift_pressed = false;
@@ -181,8 +254,16 @@ void init_keyboard(void) {
     text_scale = 2;
     kbd_head = 0;
     kbd_tail = 0;
+    kbd_raw_head = 0;
+    kbd_raw_tail = 0;
+    shell_chars_head = 0;
+    shell_chars_tail = 0;
     shell_input_enabled = 0;
 
+    tty_init();
+    work_init(&shell_input_work, shell_input_worker, 0);
+    softirq_register(SOFTIRQ_KEYBOARD, keyboard_softirq);
+    irq_register(1, keyboard_irq, 0, "keyboard");
 }
 
 // Get current text scale
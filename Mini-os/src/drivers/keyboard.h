@@ -24,6 +24,9 @@ void keyboard_flush_scancodes(void);
 // Control whether keyboard IRQ forwards ASCII to the shell.
 void keyboard_set_shell_input(int enabled);
 
+// Drop characters translated for the shell but not yet delivered.
+void keyboard_discard_shell_input(void);
+
 // External shell function
 extern void shell_add_char(char c);
 
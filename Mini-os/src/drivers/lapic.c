@@ -0,0 +1,130 @@
+#include "lapic.h"
+#include "clock.h"
+#include "../idt.h"
+#include "../mem/paging.h"
+
+#define LAPIC_REG_ID        0x020
+#define LAPIC_REG_TPR       0x080
+#define LAPIC_REG_EOI       0x0B0
+#define LAPIC_REG_SVR       0x0F0
+#define LAPIC_REG_ESR       0x280
+#define LAPIC_REG_ICR_LO    0x300
+#define LAPIC_REG_ICR_HI    0x310
+#define LAPIC_REG_LVT_TIMER 0x320
+#define LAPIC_REG_LVT_ERROR 0x370
+#define LAPIC_REG_TIMER_INIT 0x380
+#define LAPIC_REG_TIMER_CUR 0x390
+#define LAPIC_REG_TIMER_DIV 0x3E0
+
+#define LAPIC_SVR_ENABLE    0x100u
+#define LAPIC_LVT_MASKED    0x10000u
+#define LAPIC_TIMER_PERIODIC 0x20000u
+#define LAPIC_ICR_PENDING   0x1000u
+
+#define LAPIC_TIMER_DIV_16  0x3u
+#define CALIBRATE_US        10000u
+
+// Page flags: present/RW plus write-through and cache-disable for MMIO
+#define MMIO_PAGE_FLAGS     (0x002u | 0x008u | 0x010u)
+
+static volatile uint32_t* lapic = 0;
+static uint32_t timer_hz = 0;
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic[reg / 4] = value;
+    (void)lapic[LAPIC_REG_ID / 4]; // read back to post the write
+}
+
+static void lapic_enable_local(void) {
+    // Mask the timer and error LVTs. LINT0/LINT1 keep their BIOS setup so
+    // the 8259 still reaches the BSP through LINT0 (virtual-wire mode).
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+void lapic_init(uint32_t phys_base) {
+    if (!phys_base) return;
+    paging_map_page(phys_base, phys_base, MMIO_PAGE_FLAGS);
+    __asm__ __volatile__("invlpg (%0)" : : "r"(phys_base) : "memory");
+    lapic = (volatile uint32_t*)phys_base;
+    lapic_enable_local();
+}
+
+void lapic_enable_ap(void) {
+    if (lapic) lapic_enable_local();
+}
+
+int lapic_is_enabled(void) {
+    return lapic != 0;
+}
+
+uint8_t lapic_id(void) {
+    if (!lapic) return 0;
+    return (uint8_t)(lapic_read(LAPIC_REG_ID) >> 24);
+}
+
+void lapic_eoi(void) {
+    lapic[LAPIC_REG_EOI / 4] = 0;
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint32_t flags) {
+    if (!lapic) return;
+    uint32_t irq_flags = irq_save();
+    lapic_write(LAPIC_REG_ICR_HI, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LO, flags);
+    while (lapic_read(LAPIC_REG_ICR_LO) & LAPIC_ICR_PENDING) {
+        __asm__ __volatile__("pause");
+    }
+    irq_restore(irq_flags);
+}
+
+void lapic_timer_calibrate(void) {
+    if (!lapic) return;
+
+    // Free-run the masked timer from its maximum count for a fixed delay.
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    uint64_t start = clock_ns();
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+    udelay(CALIBRATE_US);
+    uint32_t remaining = lapic_read(LAPIC_REG_TIMER_CUR);
+    uint64_t elapsed_ns = clock_ns() - start;
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    uint32_t counted = 0xFFFFFFFFu - remaining;
+    uint32_t elapsed_us = (uint32_t)div_u64_u32(elapsed_ns, 1000u);
+    if (elapsed_us == 0) elapsed_us = CALIBRATE_US; // no TSC: trust udelay
+    timer_hz = (uint32_t)div_u64_u32((uint64_t)counted * 1000000u, elapsed_us);
+}
+
+void lapic_timer_start_periodic(uint32_t hz) {
+    if (!lapic || timer_hz == 0 || hz == 0) return;
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, timer_hz / hz);
+}
+
+void lapic_timer_oneshot_ns(uint64_t ns) {
+    if (!lapic || timer_hz == 0) return;
+    if (ns > LAPIC_TIMER_MAX_NS) ns = LAPIC_TIMER_MAX_NS;
+
+    // count = ns * timer_hz / 1e9; at most 1e9 * 4.3e6 fits in 64 bits.
+    uint32_t count = (uint32_t)div_u64_u32(ns * (timer_hz / 1000u), 1000000u);
+    if (count == 0) count = 1;
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, count);
+}
+
+uint32_t lapic_timer_hz(void) {
+    return timer_hz;
+}
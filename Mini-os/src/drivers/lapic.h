@@ -0,0 +1,44 @@
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include <stdint.h>
+
+// Local APIC: per-CPU interrupt controller (EOI, timer, inter-processor
+// interrupts). Registers are memory-mapped; the physical base comes from the
+// ACPI MADT / MP tables and is identity-mapped uncached by lapic_init().
+
+// ICR delivery modes
+#define LAPIC_ICR_INIT    0x00000500u
+#define LAPIC_ICR_STARTUP 0x00000600u
+#define LAPIC_ICR_FIXED   0x00000000u
+#define LAPIC_ICR_ASSERT  0x00004000u
+#define LAPIC_ICR_LEVEL   0x00008000u
+
+// Map the LAPIC and enable it on the calling CPU (BSP). Call after paging_init().
+void lapic_init(uint32_t phys_base);
+
+// Enable the already-mapped LAPIC on an application processor.
+void lapic_enable_ap(void);
+
+int lapic_is_enabled(void);
+uint8_t lapic_id(void);
+void lapic_eoi(void);
+
+// Send an IPI: vector (or SIPI page) plus delivery-mode flags.
+void lapic_send_ipi(uint8_t apic_id, uint32_t flags);
+
+// Measure the LAPIC timer rate against clock_ns(). BSP only, once.
+void lapic_timer_calibrate(void);
+
+// Periodic LAPIC timer interrupt on LAPIC_TIMER_VECTOR for the calling CPU.
+void lapic_timer_start_periodic(uint32_t hz);
+
+// One LAPIC timer interrupt on LAPIC_TIMER_VECTOR for the calling CPU, ns
+// from now (clamped to LAPIC_TIMER_MAX_NS). MMIO only, so cheap to re-arm.
+#define LAPIC_TIMER_MAX_NS 1000000000ull
+void lapic_timer_oneshot_ns(uint64_t ns);
+
+// Calibrated LAPIC timer input frequency after the divider (Hz, 0 if unknown).
+uint32_t lapic_timer_hz(void);
+
+#endif
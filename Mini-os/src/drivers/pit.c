@@ -1,5 +1,12 @@
 #include "pit.h"
+#include "clock.h"
+#include "lapic.h"
 #include "../io.h"
+#include "../idt.h"
+#include "../sched/timer.h"
+#include "../sched/sync.h"
+#include "../kernel/smp.h"
+#include "../kernel/vdso.h"
 
 // PIT I/O ports
 #define PIT_CHANNEL0 0x40
@@ -8,7 +15,32 @@
 // PIT base frequency
 #define PIT_BASE_HZ 1193182u
 
+// 64-bit tick counter guarded by a sequence counter: a 32-bit CPU cannot
+// load it atomically, so readers retry if IRQ0 updated it mid-read.
+static volatile uint32_t pit_seq = 0;
 static volatile uint64_t pit_ticks = 0;
+static uint32_t pit_hz = 100;
+
+// Tickless mode: channel 0 runs one-shot (mode 0) and is re-armed for the
+// next deadline after every IRQ0. The tick counter is then derived from the
+// TSC clock instead of counting interrupts.
+#define PIT_MAX_COUNT     0xFFFFu
+#define PIT_MIN_COUNT     24u        // ~20us floor to avoid IRQ storms
+#define LAPIC_MIN_EVENT_NS 2000ull   // same guard for the LAPIC timer
+
+static int tickless = 0;
+static uint64_t tick_period_ns = 10000000ull;
+static uint64_t next_tick_ns = 0;
+static uint64_t armed_deadline_ns = ~0ull;
+static int event_source = PIT_EVENT_PIT;
+
+// Serializes writers of the tickless catch-up (IRQ0 and readers on any CPU)
+static spinlock_t pit_lock;
+
+static void pit_irq(void* ctx) {
+    (void)ctx;
+    pit_on_tick();
+}
 
 void pit_init(uint32_t frequency_hz) {
     if (frequency_hz == 0) {
@@ -24,14 +56,167 @@ void pit_init(uint32_t frequency_hz) {
     outb(PIT_CHANNEL0, (uint8_t)(divisor & 0xFF));
     outb(PIT_CHANNEL0, (uint8_t)((divisor >> 8) & 0xFF));
 
+    pit_hz = frequency_hz;
+    pit_seq = 0;
     pit_ticks = 0;
+    spin_lock_init(&pit_lock, "pit");
+    irq_register(0, pit_irq, 0, "pit");
+}
+
+// Advance the tick counter by every period that has elapsed on the clock.
+// Caller must have interrupts disabled.
+static void pit_sync_ticks(void) {
+    spin_lock(&pit_lock);
+    uint64_t now = clock_ns();
+    if (now < next_tick_ns) {
+        spin_unlock(&pit_lock);
+        return;
+    }
+
+    uint64_t ticks = pit_ticks;
+    while (now >= next_tick_ns) {
+        ticks++;
+        next_tick_ns += tick_period_ns;
+    }
+
+    pit_seq++;
+    __asm__ __volatile__("" ::: "memory");
+    pit_ticks = ticks;
+    __asm__ __volatile__("" ::: "memory");
+    pit_seq++;
+    vdso_update_ticks(ticks, next_tick_ns);
+    spin_unlock(&pit_lock);
 }
 
 void pit_on_tick(void) {
-    pit_ticks++;
+    if (tickless) {
+        pit_sync_ticks();
+    } else {
+        pit_seq++;
+        __asm__ __volatile__("" ::: "memory");
+        pit_ticks++;
+        __asm__ __volatile__("" ::: "memory");
+        pit_seq++;
+        vdso_update_ticks(pit_ticks, ~0ull);
+    }
+
+    timer_on_tick();
 }
 
 uint64_t pit_get_ticks(void) {
-    return pit_ticks;
+    if (tickless) {
+        // No periodic IRQ keeps the counter fresh; catch up on read.
+        uint32_t flags = irq_save();
+        pit_sync_ticks();
+        irq_restore(flags);
+    }
+
+    uint32_t seq;
+    uint64_t ticks;
+    do {
+        seq = pit_seq;
+        __asm__ __volatile__("" ::: "memory");
+        ticks = pit_ticks;
+        __asm__ __volatile__("" ::: "memory");
+    } while ((seq & 1u) || seq != pit_seq);
+    return ticks;
+}
+
+uint32_t pit_get_frequency(void) {
+    return pit_hz;
+}
+
+int pit_set_tickless(int enabled) {
+    if (enabled && clock_tsc_khz() == 0) {
+        // Without a calibrated TSC, ticks can only be counted, not derived.
+        return 0;
+    }
+
+    irq_disable();
+    if (enabled) {
+        tick_period_ns = 1000000000u / pit_hz;
+        next_tick_ns = clock_ns() + tick_period_ns;
+        tickless = 1;
+        pit_program_next_event(next_tick_ns);
+    } else {
+        tickless = 0;
+        event_source = PIT_EVENT_PIT;
+        pit_init(pit_hz);
+    }
+    irq_enable();
+    return 1;
 }
 
+int pit_is_tickless(void) {
+    return tickless;
+}
+
+static void lapic_program_next_event(uint64_t deadline_ns, uint64_t now) {
+    if (smp_cpu_id() != 0) {
+        // The LAPIC timer is per-CPU: interrupt the BSP, which re-arms its
+        // own from timer_reprogram().
+        armed_deadline_ns = deadline_ns;
+        smp_send_resched(0);
+        return;
+    }
+
+    uint64_t delta = (deadline_ns > now) ? deadline_ns - now : 0;
+    if (delta < LAPIC_MIN_EVENT_NS) delta = LAPIC_MIN_EVENT_NS;
+    armed_deadline_ns = deadline_ns;
+    if (delta > LAPIC_TIMER_MAX_NS) {
+        delta = LAPIC_TIMER_MAX_NS;
+        armed_deadline_ns = now + delta;
+    }
+    lapic_timer_oneshot_ns(delta);
+}
+
+void pit_program_next_event(uint64_t deadline_ns) {
+    if (!tickless) return;
+
+    uint64_t now = clock_ns();
+    if (event_source == PIT_EVENT_LAPIC) {
+        lapic_program_next_event(deadline_ns, now);
+        return;
+    }
+
+    uint32_t count = PIT_MAX_COUNT;
+    armed_deadline_ns = deadline_ns;
+    if (deadline_ns <= now) {
+        count = PIT_MIN_COUNT;
+    } else if (deadline_ns - now < 54000000ull) {
+        // count = delta * 1.193182 MHz, computed in 32 bits (delta < 54000 us).
+        uint32_t delta_us = (uint32_t)(deadline_ns - now) / 1000u;
+        count = (delta_us * 1193u) / 1000u;
+        if (count < PIT_MIN_COUNT) count = PIT_MIN_COUNT;
+        if (count > PIT_MAX_COUNT) count = PIT_MAX_COUNT;
+    } else {
+        armed_deadline_ns = now + 54000000ull;
+    }
+
+    // Command: channel 0, access mode lobyte/hibyte, mode 0 (one-shot), binary
+    outb(PIT_COMMAND, 0x30);
+    outb(PIT_CHANNEL0, (uint8_t)(count & 0xFF));
+    outb(PIT_CHANNEL0, (uint8_t)((count >> 8) & 0xFF));
+}
+
+uint64_t pit_next_event_ns(void) {
+    return armed_deadline_ns;
+}
+
+int pit_set_event_source(int source) {
+    if (source == PIT_EVENT_LAPIC && (!tickless || lapic_timer_hz() == 0)) {
+        return 0;
+    }
+
+    // Fire the new device right away; the tick handler re-arms it for the
+    // real next deadline. The old device fires at most once more.
+    uint32_t flags = irq_save();
+    event_source = source;
+    pit_program_next_event(clock_ns());
+    irq_restore(flags);
+    return 1;
+}
+
+int pit_event_source(void) {
+    return event_source;
+}
@@ -9,8 +9,31 @@ void pit_init(uint32_t frequency_hz);
 // Called from IRQ0 handler to update ticks.
 void pit_on_tick(void);
 
-// Get number of PIT ticks since init.
+// Get number of PIT ticks since init (consistent snapshot, safe outside IRQ0).
 uint64_t pit_get_ticks(void);
 
+// Programmed tick frequency in Hz.
+uint32_t pit_get_frequency(void);
+
+// Switch channel 0 between periodic and one-shot (tickless) operation.
+// Tickless needs a calibrated TSC; returns 0 if it cannot be enabled.
+int pit_set_tickless(int enabled);
+int pit_is_tickless(void);
+
+// Arm the one-shot timer for an absolute clock_ns() deadline. Deadlines
+// beyond the 16-bit counter range (~54 ms) are clamped. No-op when periodic.
+void pit_program_next_event(uint64_t deadline_ns);
+
+// Deadline the one-shot timer is currently armed for (after clamping).
+uint64_t pit_next_event_ns(void);
+
+// One-shot event device used in tickless mode: PIT channel 0 (IRQ0, ~838 ns
+// resolution, port I/O) or the BSP's LAPIC timer (LAPIC_TIMER_VECTOR, bus
+// clock resolution, MMIO). Call on the BSP; returns 0 if unavailable.
+#define PIT_EVENT_PIT   0
+#define PIT_EVENT_LAPIC 1
+int pit_set_event_source(int source);
+int pit_event_source(void);
+
 #endif
 
@@ -109,4 +109,27 @@ char* get_month_name(uint8_t month) {
         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
     };
     return (month >= 1 && month <= 12) ? months[month - 1] : "???";
-}
\ No newline at end of file
+}
+
+// Seconds since 1970-01-01 00:00 UTC
+// rtc_get_time() reports local time (UTC+5:30, day possibly one past the
+// end of the month); counting days from the fields absorbs that overflow.
+uint32_t rtc_unix_time(void) {
+    static const uint16_t days_before_month[12] = {
+        0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+    };
+    datetime_t t;
+    rtc_get_time(&t);
+
+    uint32_t days = 0;
+    for (uint32_t y = 1970; y < t.year; y++) {
+        days += ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) ? 366 : 365;
+    }
+    if (t.month >= 1 && t.month <= 12) days += days_before_month[t.month - 1];
+    int leap = (t.year % 4 == 0 && t.year % 100 != 0) || t.year % 400 == 0;
+    if (leap && t.month > 2) days++;
+    if (t.day > 0) days += t.day - 1u;
+
+    uint32_t local = days * 86400u + t.hour * 3600u + t.minute * 60u + t.second;
+    return local - (5u * 3600u + 30u * 60u);
+}
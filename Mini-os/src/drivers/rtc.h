@@ -19,5 +19,6 @@ void rtc_get_time(datetime_t *time);        // Get current date and time
 uint8_t cmos_read(uint8_t address);         // Read from CMOS register
 char* get_day_name(uint8_t day);            // Get day name from day number
 char* get_month_name(uint8_t month);        // Get month name from month number
+uint32_t rtc_unix_time(void);               // Seconds since 1970-01-01 00:00 UTC
 
 #endif
\ No newline at end of file
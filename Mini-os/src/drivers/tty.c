@@ -0,0 +1,161 @@
+#include "tty.h"
+#include "../graphic/vbe.h"
+#include "../graphic/console.h"
+#include "../sched/sched.h"
+#include "../sched/sync.h"
+
+#define TTY_MASK (TTY_RING_SIZE - 1)
+
+// Input ring, free-running indices: [tail, line_end) is readable,
+// [line_end, head) is the line still being edited (empty in raw mode).
+// Everything here is guarded by tty_wq's lock; the keyboard softirq takes
+// it too.
+static wait_queue_t tty_wq;
+static char ring[TTY_RING_SIZE];
+static uint32_t tail = 0;
+static uint32_t line_end = 0;
+static uint32_t head = 0;
+
+// Echo is drawn by the reader in task context (the console may sleep);
+// the softirq only queues it, '\b' meaning erase one character.
+static char echo_buf[TTY_ECHO_SIZE];
+static int echo_len = 0;
+
+static int tty_owner = -1;
+static uint32_t tty_mode = TTY_MODE_DEFAULT;
+
+static void echo_push(char c) {
+    if (!(tty_mode & TTY_ECHO) || echo_len >= TTY_ECHO_SIZE) return;
+    echo_buf[echo_len++] = c;
+}
+
+void tty_init(void) {
+    wait_queue_init(&tty_wq);
+    tail = line_end = head = 0;
+    echo_len = 0;
+    tty_owner = -1;
+    tty_mode = TTY_MODE_DEFAULT;
+}
+
+int tty_input(char c) {
+    uint32_t flags = wait_queue_lock(&tty_wq);
+    if (tty_owner < 0) {
+        wait_queue_unlock(&tty_wq, flags);
+        return 0;
+    }
+
+    int ready = 0;
+    if (tty_mode & TTY_RAW) {
+        if (head - tail < TTY_RING_SIZE) {
+            ring[head++ & TTY_MASK] = c;
+            line_end = head;
+            echo_push(c);
+            ready = 1;
+        }
+    } else if (c == '\b') {
+        if (head != line_end) {
+            head--;
+            echo_push('\b');
+        }
+    } else if (c == '\n') {
+        // A slot is kept free for this, so a full line can still end.
+        if (head - tail >= TTY_RING_SIZE) {
+            wait_queue_unlock(&tty_wq, flags);
+            return 1;
+        }
+        ring[head++ & TTY_MASK] = '\n';
+        line_end = head;
+        echo_push('\n');
+        ready = 1;
+    } else if (head - tail < TTY_RING_SIZE - 1) {
+        ring[head++ & TTY_MASK] = c;
+        echo_push(c);
+    }
+
+    // Readers also wake to draw the echo.
+    if (ready || echo_len) wait_queue_wake_all(&tty_wq);
+    wait_queue_unlock(&tty_wq, flags);
+    return 1;
+}
+
+static void draw_echo(const char* s, int n) {
+    int start = 0;
+    for (int i = 0; i <= n; i++) {
+        if (i < n && s[i] != '\b') continue;
+        if (i > start) console_write(s + start, i - start, vbe_rgb(255, 255, 255));
+        if (i < n) console_backspace();
+        start = i + 1;
+    }
+    console_flush();
+}
+
+int tty_read(char* buf, int len) {
+    char echo[TTY_ECHO_SIZE];
+    if (len < 0) return -1;
+    if (len == 0) return 0;
+
+    int self = sched_current_task();
+    uint32_t flags = wait_queue_lock(&tty_wq);
+    if (tty_owner < 0) tty_owner = self;
+    for (;;) {
+        if (echo_len) {
+            int n = echo_len;
+            for (int i = 0; i < n; i++) echo[i] = echo_buf[i];
+            echo_len = 0;
+            wait_queue_unlock(&tty_wq, flags);
+            draw_echo(echo, n);
+            flags = wait_queue_lock(&tty_wq);
+            continue;
+        }
+        if (line_end != tail) break;
+        wait_queue_sleep(&tty_wq);
+    }
+    wait_queue_remove(&tty_wq, self);
+
+    uint32_t n = line_end - tail;
+    if (n > (uint32_t)len) n = (uint32_t)len;
+    if (!(tty_mode & TTY_RAW)) {
+        // One line per read
+        for (uint32_t i = 0; i < n; i++) {
+            if (ring[(tail + i) & TTY_MASK] == '\n') {
+                n = i + 1;
+                break;
+            }
+        }
+    }
+
+    // Straight from the ring, in at most two pieces
+    uint32_t start = tail & TTY_MASK;
+    uint32_t first = TTY_RING_SIZE - start;
+    if (first > n) first = n;
+    for (uint32_t i = 0; i < first; i++) buf[i] = ring[start + i];
+    for (uint32_t i = first; i < n; i++) buf[i] = ring[i - first];
+    tail += n;
+    wait_queue_unlock(&tty_wq, flags);
+    return (int)n;
+}
+
+int tty_set_mode(uint32_t mode) {
+    uint32_t flags = wait_queue_lock(&tty_wq);
+    if (tty_owner < 0) tty_owner = sched_current_task();
+    int old = (int)tty_mode;
+    tty_mode = mode & (TTY_RAW | TTY_ECHO);
+    if (tty_mode & TTY_RAW) {
+        // A half-edited line becomes readable as is.
+        line_end = head;
+        if (line_end != tail) wait_queue_wake_all(&tty_wq);
+    }
+    wait_queue_unlock(&tty_wq, flags);
+    return old;
+}
+
+void tty_release(int task_id) {
+    uint32_t flags = wait_queue_lock(&tty_wq);
+    if (tty_owner == task_id) {
+        tty_owner = -1;
+        tty_mode = TTY_MODE_DEFAULT;
+        tail = line_end = head;
+        echo_len = 0;
+    }
+    wait_queue_unlock(&tty_wq, flags);
+}
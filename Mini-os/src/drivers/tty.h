@@ -0,0 +1,39 @@
+#ifndef TTY_H
+#define TTY_H
+
+#include <stdint.h>
+
+// Keyboard line discipline behind sys_read. Translated keys go into a
+// ring; a cooked read returns once a whole line ('\n') is in it, a raw
+// read as soon as any byte is. Readers block on a wait queue and data is
+// copied from the ring straight into their buffer.
+//
+// The first task to read (or set the mode) owns the keyboard: from then on
+// keys go to the tty instead of the shell until that task exits.
+
+#define TTY_RING_SIZE 256          // power of two
+#define TTY_ECHO_SIZE 64
+
+// tty_set_mode() flags
+#define TTY_RAW  0x1   // no line editing, bytes are readable at once
+#define TTY_ECHO 0x2   // echo input to the console
+
+#define TTY_MODE_DEFAULT TTY_ECHO
+
+void tty_init(void);
+
+// Keyboard softirq: take one translated key. Returns 0 if no task owns
+// the tty (the key is for the shell).
+int tty_input(char c);
+
+// Block until input is ready, then copy up to len bytes (cooked: at most
+// through the first '\n'). Task context only.
+int tty_read(char* buf, int len);
+
+// Set TTY_RAW / TTY_ECHO for the calling task; returns the previous mode.
+int tty_set_mode(uint32_t mode);
+
+// Give the keyboard back to the shell if task_id owns the tty (on exit).
+void tty_release(int task_id);
+
+#endif
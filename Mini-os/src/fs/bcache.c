@@ -0,0 +1,271 @@
+#include "bcache.h"
+#include "../drivers/ata.h"
+#include "../sched/sched.h"
+#include "../sched/timer.h"
+#include "../sched/workqueue.h"
+#include "../drivers/clock.h"
+#include "../sched/sync.h"
+#include <stdint.h>
+
+static uint8_t buffer_data[BCACHE_BUFFERS][BCACHE_BLOCK_SIZE] __attribute__((aligned(16)));
+static buf_t buffers[BCACHE_BUFFERS];
+static buf_t* hash_table[BCACHE_HASH];
+
+// Buffers nobody holds, least recently released at lru_head
+static buf_t* lru_head;
+static buf_t* lru_tail;
+
+// Guards all of the above and the busy flags; tasks waiting for a busy
+// buffer sleep here. A buffer is busy while a holder owns it (refs > 0,
+// off the LRU list) or while it is written back without a reference, which
+// leaves it at its place on the list.
+static wait_queue_t bcache_wq;
+static uint8_t busy[BCACHE_BUFFERS];
+
+static bcache_stats_t stats;
+
+static work_t flush_work;
+static int flush_armed = 0;
+
+// The helpers below run with the bcache_wq lock held.
+
+static uint32_t bcache_hash(int dev, uint32_t block) {
+    return (block * 2654435761u ^ (uint32_t)dev) & (BCACHE_HASH - 1);
+}
+
+static void lru_remove(buf_t* b) {
+    if (b->lru_prev) b->lru_prev->lru_next = b->lru_next;
+    else lru_head = b->lru_next;
+    if (b->lru_next) b->lru_next->lru_prev = b->lru_prev;
+    else lru_tail = b->lru_prev;
+    b->lru_prev = 0;
+    b->lru_next = 0;
+}
+
+static void lru_push_tail(buf_t* b) {
+    b->lru_prev = lru_tail;
+    b->lru_next = 0;
+    if (lru_tail) lru_tail->lru_next = b;
+    else lru_head = b;
+    lru_tail = b;
+}
+
+static void hash_remove(buf_t* b) {
+    buf_t** p = &hash_table[bcache_hash(b->dev, b->block)];
+    while (*p && *p != b) p = &(*p)->hash_next;
+    if (*p) *p = b->hash_next;
+    b->hash_next = 0;
+}
+
+static void hash_insert(buf_t* b) {
+    buf_t** head = &hash_table[bcache_hash(b->dev, b->block)];
+    b->hash_next = *head;
+    *head = b;
+}
+
+static buf_t* hash_find(int dev, uint32_t block) {
+    buf_t* b = hash_table[bcache_hash(dev, block)];
+    while (b && (b->dev != dev || b->block != block)) b = b->hash_next;
+    return b;
+}
+
+static void buf_wait_idle(buf_t* b) {
+    if (busy[b - buffers]) {
+        while (busy[b - buffers]) {
+            wait_queue_sleep(&bcache_wq);
+        }
+        wait_queue_remove(&bcache_wq, sched_current_task());
+    }
+}
+
+// Take a reference, then wait until the buffer is free and mark it busy
+static void buf_claim(buf_t* b) {
+    if (b->refs++ == 0) lru_remove(b);
+    buf_wait_idle(b);
+    busy[b - buffers] = 1;
+}
+
+static void buf_unclaim(buf_t* b) {
+    busy[b - buffers] = 0;
+    if (--b->refs == 0) lru_push_tail(b);
+    wait_queue_wake_all(&bcache_wq);
+}
+
+// Writeback: a write is not a use, so the buffer stays where it is in LRU
+// order. Returns 0 if the buffer turned clean while we waited.
+static int buf_writeback_begin(buf_t* b) {
+    buf_wait_idle(b);
+    if (!b->dirty) return 0;
+    busy[b - buffers] = 1;
+    return 1;
+}
+
+// Write finished with result (unlocked in between)
+static void buf_writeback_end(buf_t* b, int result) {
+    if (result == 0 && b->dirty) {
+        b->dirty = 0;
+        stats.dirty--;
+        stats.writebacks++;
+    }
+    busy[b - buffers] = 0;
+    wait_queue_wake_all(&bcache_wq);
+}
+
+static void flush_timer(void* arg) {
+    (void)arg;
+    queue_work(&flush_work);
+}
+
+static void flush_worker(void* arg) {
+    (void)arg;
+    uint32_t flags = wait_queue_lock(&bcache_wq);
+    flush_armed = 0;
+    wait_queue_unlock(&bcache_wq, flags);
+    bcache_sync();
+}
+
+static int buf_write(buf_t* b) {
+    return ata_write(b->dev, b->block * BCACHE_SECTORS, BCACHE_SECTORS, b->data);
+}
+
+void bcache_init(void) {
+    wait_queue_init(&bcache_wq);
+    work_init(&flush_work, flush_worker, 0);
+    lru_head = 0;
+    lru_tail = 0;
+    for (int i = 0; i < BCACHE_HASH; i++) hash_table[i] = 0;
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        buf_t* b = &buffers[i];
+        b->dev = -1;
+        b->block = 0;
+        b->valid = 0;
+        b->dirty = 0;
+        b->refs = 0;
+        b->hash_next = 0;
+        b->data = buffer_data[i];
+        busy[i] = 0;
+        lru_push_tail(b);
+    }
+}
+
+buf_t* bread(int dev, uint32_t block) {
+    const ata_drive_t* d = ata_drive(dev);
+    if (!d || block >= d->sectors / BCACHE_SECTORS) return 0;
+
+    uint32_t flags = wait_queue_lock(&bcache_wq);
+    buf_t* b;
+    for (;;) {
+        b = hash_find(dev, block);
+        if (b) {
+            stats.hits++;
+            buf_claim(b);
+            break;
+        }
+
+        // Recycle the least recently used buffer not being written back
+        if (!lru_head) {
+            wait_queue_unlock(&bcache_wq, flags);
+            return 0; // All buffers held
+        }
+        b = lru_head;
+        while (b && busy[b - buffers]) b = b->lru_next;
+        if (!b) {
+            wait_queue_sleep(&bcache_wq);
+            wait_queue_remove(&bcache_wq, sched_current_task());
+            continue;
+        }
+        if (!b->dirty) {
+            stats.misses++;
+            if (b->dev >= 0) stats.evictions++;
+            buf_claim(b);
+            hash_remove(b);
+            b->dev = dev;
+            b->block = block;
+            b->valid = 0;
+            hash_insert(b);
+            break;
+        }
+
+        // Dirty: write it back under its old identity, then look again
+        // (someone may have asked for our block meanwhile). It keeps its
+        // place at the cold end, so the next pass recycles it.
+        busy[b - buffers] = 1;
+        wait_queue_unlock(&bcache_wq, flags);
+        int result = buf_write(b);
+        flags = wait_queue_lock(&bcache_wq);
+        buf_writeback_end(b, result);
+        if (result < 0) {
+            wait_queue_unlock(&bcache_wq, flags);
+            return 0;
+        }
+    }
+    wait_queue_unlock(&bcache_wq, flags);
+
+    // Busy is ours: fill the buffer if no one has yet
+    if (!b->valid) {
+        if (ata_read(dev, block * BCACHE_SECTORS, BCACHE_SECTORS, b->data) < 0) {
+            brelse(b);
+            return 0;
+        }
+        b->valid = 1;
+    }
+    return b;
+}
+
+void bdirty(buf_t* b) {
+    uint32_t flags = wait_queue_lock(&bcache_wq);
+    if (!b->dirty) {
+        b->dirty = 1;
+        stats.dirty++;
+    }
+    int arm = !flush_armed;
+    flush_armed = 1;
+    wait_queue_unlock(&bcache_wq, flags);
+
+    if (arm && timer_add(clock_ns() + BCACHE_FLUSH_NS, flush_timer, 0) < 0) {
+        flags = wait_queue_lock(&bcache_wq);
+        flush_armed = 0; // No timer: the next bdirty tries again
+        wait_queue_unlock(&bcache_wq, flags);
+    }
+}
+
+void brelse(buf_t* b) {
+    uint32_t flags = wait_queue_lock(&bcache_wq);
+    buf_unclaim(b);
+    wait_queue_unlock(&bcache_wq, flags);
+}
+
+int bcache_sync(void) {
+    int result = 0;
+    int written[ATA_MAX_DRIVES] = {0};
+
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        buf_t* b = &buffers[i];
+        uint32_t flags = wait_queue_lock(&bcache_wq);
+        if (!b->dirty || !buf_writeback_begin(b)) {
+            wait_queue_unlock(&bcache_wq, flags);
+            continue;
+        }
+        int dev = b->dev;
+        wait_queue_unlock(&bcache_wq, flags);
+
+        int ok = buf_write(b) == 0;
+
+        flags = wait_queue_lock(&bcache_wq);
+        buf_writeback_end(b, ok ? 0 : -1);
+        wait_queue_unlock(&bcache_wq, flags);
+        if (ok) written[dev] = 1;
+        else result = -1;
+    }
+
+    for (int dev = 0; dev < ATA_MAX_DRIVES; dev++) {
+        if (written[dev] && ata_flush(dev) < 0) result = -1;
+    }
+    return result;
+}
+
+void bcache_get_stats(bcache_stats_t* out) {
+    uint32_t flags = wait_queue_lock(&bcache_wq);
+    *out = stats;
+    wait_queue_unlock(&bcache_wq, flags);
+}
@@ -0,0 +1,58 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+
+// Buffer cache of disk blocks (ata.h devices). Blocks are found through a
+// hash on (device, block) and recycled least recently used first, so a
+// block read again while cached never reaches the disk. Writes only mark
+// the buffer dirty; dirty buffers go to disk when they are evicted, on
+// bcache_sync(), and from a kworker flush BCACHE_FLUSH_NS after the first
+// block turns dirty.
+
+#define BCACHE_BLOCK_SIZE 4096
+#define BCACHE_SECTORS    (BCACHE_BLOCK_SIZE / 512)
+#define BCACHE_BUFFERS    64
+#define BCACHE_HASH       64            // power of two
+#define BCACHE_FLUSH_NS   5000000000ull
+
+typedef struct buf {
+    int dev;
+    uint32_t block;
+    uint8_t valid;                      // data holds the block
+    uint8_t dirty;                      // data is newer than the disk
+    uint16_t refs;                      // holders; 0 = on the LRU list
+    struct buf* hash_next;
+    struct buf* lru_prev;
+    struct buf* lru_next;
+    uint8_t* data;
+} buf_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t writebacks;                // dirty blocks written to disk
+    uint32_t dirty;                     // dirty blocks right now
+} bcache_stats_t;
+
+// Call after sched_init() and workqueue_init()
+void bcache_init(void);
+
+// The block, held exclusively by the caller until brelse(), with valid data. 0 if the block is out
+// of range, unreadable, or every buffer is in use.
+buf_t* bread(int dev, uint32_t block);
+
+// The caller changed b->data; it will be written back later
+void bdirty(buf_t* b);
+
+// Let go of the block and make the buffer eligible for reuse
+void brelse(buf_t* b);
+
+// Write every dirty block and flush the drives' caches. Returns -1 if any
+// write failed (those blocks stay dirty).
+int bcache_sync(void);
+
+void bcache_get_stats(bcache_stats_t* out);
+
+#endif
@@ -1,20 +1,20 @@
 #include "filesystem.h"
+#include "../mem/kheap.h"
+#include "../sched/sync.h"
 #include <stdint.h>
 
 // Simple string functions for filesystem
-static void fs_strcpy(char *dest, const char *src) {
-    while (*src) {
-        *dest++ = *src++;
-    }
+static void fs_strncpy(char *dest, const char *src, int len) {
+    while (len--) *dest++ = *src++;
     *dest = '\0';
 }
 
-static int fs_strcmp(const char *s1, const char *s2) {
-    while (*s1 && (*s1 == *s2)) {
-        s1++;
-        s2++;
+// name (NUL-terminated) equals the len bytes at s
+static int fs_name_eq(const char *name, const char *s, int len) {
+    for (int i = 0; i < len; i++) {
+        if (name[i] != s[i]) return 0;
     }
-    return *(unsigned char *)s1 - *(unsigned char *)s2;
+    return name[len] == '\0';
 }
 
 static int fs_strlen(const char *str) {
@@ -23,16 +23,518 @@ static int fs_strlen(const char *str) {
     return len;
 }
 
-static file_t files[MAX_FILES];
+static void fs_memcpy(char *dest, const char *src, uint32_t n) {
+    while (n--) *dest++ = *src++;
+}
+
+// Copy n bytes from src, or store n zeros if src is 0
+static void fs_fill(char *dest, const char *src, uint32_t n) {
+    if (src) fs_memcpy(dest, src, n);
+    else while (n--) *dest++ = 0;
+}
+
+// Inodes by slot (0 = free)
+static file_t* files[MAX_FILES];
+
+// Name index: file slot, or one of these. Deleted entries keep probe
+// chains intact until the next rebuild.
+#define FS_SLOT_EMPTY   (-1)
+#define FS_SLOT_DELETED (-2)
+static int16_t fs_index[FS_INDEX_SIZE];
+static int fs_index_deleted = 0;
+
+// Unused file slots, as a stack
+static int16_t free_slots[MAX_FILES];
+static int free_count = 0;
+
+// Open descriptors (file 0 = free)
+typedef struct {
+    file_t* file;
+    uint32_t offset;
+    int flags;
+    int owner;                          // task that opened it
+} fs_fd_t;
+static fs_fd_t fds[MAX_FDS];
+
+// Dentry cache entries are valid only while gen matches fs_dcache_gen.
+// Removing a name bumps the generation, which drops every entry at once;
+// creating names never invalidates (misses are not cached).
+typedef struct {
+    uint32_t gen;
+    uint32_t hash;
+    int16_t base;                       // slot the path is relative to
+    int16_t slot;                       // what it resolved to
+    uint8_t len;
+    char path[FS_DCACHE_PATH];
+} fs_dentry_t;
+static fs_dentry_t fs_dcache[FS_DCACHE_SIZE];
+static uint32_t fs_dcache_gen = 1;
+
+// Directory relative paths start from
+static int fs_cwd = FS_ROOT;
+
+// Serializes all access to the file and descriptor tables (callers may be preempted)
+static mutex_t fs_lock;
+
+// FNV-1a, one byte at a time
+#define FS_FNV_BASIS 2166136261u
+static uint32_t fs_fnv(uint32_t h, char c) {
+    return (h ^ (uint8_t)c) * 16777619u;
+}
+
+// Mix a slot number into a name or path hash
+static uint32_t fs_hash_mix(uint32_t h, int slot) {
+    h = fs_fnv(h, (char)(slot & 0xFF));
+    return fs_fnv(h, (char)(slot >> 8));
+}
+
+// Index key of the entry called name (len bytes) in directory parent
+static uint32_t fs_hash_child(int parent, const char *name, int len) {
+    uint32_t h = FS_FNV_BASIS;
+    for (int i = 0; i < len; i++) h = fs_fnv(h, name[i]);
+    return fs_hash_mix(h, parent);
+}
+
+// The helpers below run with fs_lock held.
+
+// Slot of the entry called name (len bytes) in directory parent, or -1
+static int fs_lookup(int parent, const char *name, int len, uint32_t hash) {
+    uint32_t i = hash & (FS_INDEX_SIZE - 1);
+    for (int probes = 0; probes < FS_INDEX_SIZE; probes++) {
+        int slot = fs_index[i];
+        if (slot == FS_SLOT_EMPTY) return -1;
+        if (slot >= 0 && files[slot]->hash == hash && files[slot]->parent == parent &&
+            fs_name_eq(files[slot]->name, name, len)) {
+            return slot;
+        }
+        i = (i + 1) & (FS_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+static void fs_index_insert(int slot) {
+    uint32_t i = files[slot]->hash & (FS_INDEX_SIZE - 1);
+    while (fs_index[i] >= 0) {
+        i = (i + 1) & (FS_INDEX_SIZE - 1);
+    }
+    if (fs_index[i] == FS_SLOT_DELETED) fs_index_deleted--;
+    fs_index[i] = (int16_t)slot;
+}
+
+static void fs_index_rebuild(void) {
+    for (int i = 0; i < FS_INDEX_SIZE; i++) fs_index[i] = FS_SLOT_EMPTY;
+    fs_index_deleted = 0;
+    for (int slot = 0; slot < MAX_FILES; slot++) {
+        if (slot != FS_ROOT && files[slot]) fs_index_insert(slot);
+    }
+}
+
+// Leaves a tombstone; the caller clears files[slot], then calls
+// fs_index_compact() so a rebuild cannot re-insert the removed entry.
+static void fs_index_remove(int slot) {
+    uint32_t i = files[slot]->hash & (FS_INDEX_SIZE - 1);
+    while (fs_index[i] != slot) {
+        i = (i + 1) & (FS_INDEX_SIZE - 1);
+    }
+    fs_index[i] = FS_SLOT_DELETED;
+    fs_index_deleted++;
+}
+
+// Too many tombstones make misses walk long chains; start over.
+static void fs_index_compact(void) {
+    if (fs_index_deleted > FS_INDEX_SIZE / 4) fs_index_rebuild();
+}
+
+// hash covers the len path bytes; the cache key adds the base slot
+static int fs_dcache_lookup(int base, const char *path, int len, uint32_t hash) {
+    uint32_t key = fs_hash_mix(hash, base);
+    fs_dentry_t* d = &fs_dcache[key & (FS_DCACHE_SIZE - 1)];
+    if (d->gen != fs_dcache_gen || d->hash != key || d->base != base || d->len != len) return -1;
+    for (int i = 0; i < len; i++) {
+        if (d->path[i] != path[i]) return -1;
+    }
+    return d->slot;
+}
+
+static void fs_dcache_insert(int base, const char *path, int len, uint32_t hash, int slot) {
+    if (len > FS_DCACHE_PATH) return;
+    uint32_t key = fs_hash_mix(hash, base);
+    fs_dentry_t* d = &fs_dcache[key & (FS_DCACHE_SIZE - 1)];
+    d->gen = fs_dcache_gen;
+    d->hash = key;
+    d->base = (int16_t)base;
+    d->slot = (int16_t)slot;
+    d->len = (uint8_t)len;
+    for (int i = 0; i < len; i++) d->path[i] = path[i];
+}
+
+// Resolve the first len bytes of path to a slot, or -1. Misses walk one
+// component at a time and cache every directory prefix on the way, so
+// siblings deep in the tree hit on their parent's prefix next time.
+static int fs_walk(const char *path, int len) {
+    int base = fs_cwd;
+    if (len > 0 && path[0] == '/') {
+        base = FS_ROOT;
+    } else if (len > 0 && path[0] == '~' && (len == 1 || path[1] == '/')) {
+        base = FS_ROOT;
+        path++;
+        len--;
+    }
+    if (len == 0) return base;
+
+    uint32_t hash = FS_FNV_BASIS;
+    for (int i = 0; i < len; i++) hash = fs_fnv(hash, path[i]);
+    int slot = fs_dcache_lookup(base, path, len, hash);
+    if (slot >= 0) return slot;
+
+    // Start from the longest cached directory prefix
+    int cur = base;
+    int i = 0;
+    hash = FS_FNV_BASIS;
+    for (int j = 0; j < len; j++) {
+        hash = fs_fnv(hash, path[j]);
+        if (path[j] == '/' && j + 1 < len) {
+            slot = fs_dcache_lookup(base, path, j + 1, hash);
+            if (slot >= 0) {
+                cur = slot;
+                i = j + 1;
+            }
+        }
+    }
+
+    hash = FS_FNV_BASIS;
+    for (int j = 0; j < i; j++) hash = fs_fnv(hash, path[j]);
+    while (i < len) {
+        int start = i;
+        while (i < len && path[i] != '/') hash = fs_fnv(hash, path[i++]);
+        int n = i - start;
+        const char *name = path + start;
+
+        if (n > 0) {
+            if (files[cur]->type != FS_TYPE_DIR) return -1;
+            if (n == 1 && name[0] == '.') {
+                // Stays put
+            } else if (n == 2 && name[0] == '.' && name[1] == '.') {
+                cur = files[cur]->parent;
+            } else {
+                cur = fs_lookup(cur, name, n, fs_hash_child(cur, name, n));
+                if (cur < 0) return -1;
+            }
+        }
+        if (i < len) {
+            hash = fs_fnv(hash, path[i++]); // The '/'
+            if (files[cur]->type == FS_TYPE_DIR) fs_dcache_insert(base, path, i, hash, cur);
+        }
+    }
+    if (path[len - 1] == '/' && files[cur]->type != FS_TYPE_DIR) return -1;
+    fs_dcache_insert(base, path, len, hash, cur);
+    return cur;
+}
+
+static int fs_resolve(const char *path) {
+    return fs_walk(path, fs_strlen(path));
+}
+
+// Directory that would contain path, with the last component in name and
+// len. -1 if that directory does not exist or the component is not a
+// usable name.
+static int fs_resolve_parent(const char *path, const char **name, int *len) {
+    int end = fs_strlen(path);
+    while (end > 1 && path[end - 1] == '/') end--;
+    int start = end;
+    while (start > 0 && path[start - 1] != '/') start--;
+
+    int n = end - start;
+    *name = path + start;
+    *len = n;
+    if (n == 0 || n >= MAX_FILENAME) return -1;
+    if (path[start] == '.' && (n == 1 || (n == 2 && path[start + 1] == '.'))) return -1;
+    if (start == 0 && n == 1 && path[0] == '~') return -1;
+
+    int dir = fs_walk(path, start);
+    if (dir < 0 || files[dir]->type != FS_TYPE_DIR) return -1;
+    return dir;
+}
+
+static char* extent_data(fs_extent_t* e) {
+    return (char*)(e + 1);
+}
+
+static fs_extent_t* fs_extent_alloc(uint32_t want) {
+    uint32_t cap = want;
+    if (cap < FS_EXTENT_MIN) cap = FS_EXTENT_MIN;
+    if (cap > FS_EXTENT_MAX) cap = FS_EXTENT_MAX;
+    fs_extent_t* e = (fs_extent_t*)kmalloc(sizeof(fs_extent_t) + cap);
+    if (!e) return 0;
+    e->next = 0;
+    e->len = 0;
+    e->cap = cap;
+    return e;
+}
+
+static void fs_free_data(file_t* f) {
+    fs_extent_t* e = f->first;
+    while (e) {
+        fs_extent_t* next = e->next;
+        kfree(e);
+        e = next;
+    }
+    f->first = 0;
+    f->last = 0;
+    f->size = 0;
+}
+
+// Add len bytes at the end of the file (zeros if data is 0). Returns the
+// bytes added, short only if the heap ran out.
+static uint32_t fs_append(file_t* f, const char* data, uint32_t len) {
+    if (!f->first) {
+        if (f->size + len <= FS_INLINE_SIZE) {
+            fs_fill(f->inline_data + f->size, data, len);
+            f->size += len;
+            return len;
+        }
+        // Outgrowing the inode: the inline bytes start the first extent.
+        fs_extent_t* e = fs_extent_alloc(f->size + len);
+        if (!e) return 0;
+        fs_memcpy(extent_data(e), f->inline_data, f->size);
+        e->len = f->size;
+        f->first = e;
+        f->last = e;
+    }
+
+    uint32_t done = 0;
+    while (done < len) {
+        fs_extent_t* e = f->last;
+        uint32_t room = e->cap - e->len;
+        if (room == 0) {
+            uint32_t want = f->size > len - done ? f->size : len - done;
+
+            // Grow the last extent in place while it is under the cap
+            if (e->cap < FS_EXTENT_MAX) {
+                uint32_t cap = e->cap + want;
+                if (cap > FS_EXTENT_MAX) cap = FS_EXTENT_MAX;
+                size_t usable = kmalloc_extend(e, sizeof(fs_extent_t) + cap);
+                if (usable > sizeof(fs_extent_t) + e->cap) {
+                    e->cap = (uint32_t)(usable - sizeof(fs_extent_t));
+                    continue;
+                }
+            }
+
+            e = fs_extent_alloc(want);
+            if (!e) break;
+            f->last->next = e;
+            f->last = e;
+            continue;
+        }
+        uint32_t n = (len - done < room) ? len - done : room;
+        fs_fill(extent_data(e) + e->len, data ? data + done : 0, n);
+        e->len += n;
+        f->size += n;
+        done += n;
+    }
+    return done;
+}
+
+// Extent holding byte offset of an extent-backed file; offset becomes the
+// position within it. Files have few extents (each doubles the file up to
+// FS_EXTENT_MAX), so this walk is short next to the copy itself.
+static fs_extent_t* fs_extent_at(file_t* f, uint32_t* offset) {
+    fs_extent_t* e = f->first;
+    while (*offset >= e->len) {
+        *offset -= e->len;
+        e = e->next;
+    }
+    return e;
+}
+
+// Copy n bytes starting at offset (both within the file) to dest
+static void fs_copy_out(file_t* f, uint32_t offset, char* dest, uint32_t n) {
+    if (n == 0) return;
+    if (f->rodata) {
+        fs_memcpy(dest, f->rodata + offset, n);
+        return;
+    }
+    if (!f->first) {
+        fs_memcpy(dest, f->inline_data + offset, n);
+        return;
+    }
+    fs_extent_t* e = fs_extent_at(f, &offset);
+    while (n > 0) {
+        uint32_t chunk = e->len - offset;
+        if (chunk > n) chunk = n;
+        fs_memcpy(dest, extent_data(e) + offset, chunk);
+        dest += chunk;
+        n -= chunk;
+        offset = 0;
+        e = e->next;
+    }
+}
+
+// Overwrite n bytes starting at offset (both within the file) from src
+static void fs_copy_in(file_t* f, uint32_t offset, const char* src, uint32_t n) {
+    if (n == 0) return;
+    if (!f->first) {
+        fs_memcpy(f->inline_data + offset, src, n);
+        return;
+    }
+    fs_extent_t* e = fs_extent_at(f, &offset);
+    while (n > 0) {
+        uint32_t chunk = e->len - offset;
+        if (chunk > n) chunk = n;
+        fs_memcpy(extent_data(e) + offset, src, chunk);
+        src += chunk;
+        n -= chunk;
+        offset = 0;
+        e = e->next;
+    }
+}
+
+// Cut the file back to size bytes (at most its size), freeing the extents
+// past it. Files that fit move back inline, as if never grown.
+static void fs_shrink(file_t* f, uint32_t size) {
+    if (!f->first) {
+        f->size = size;
+        return;
+    }
+    if (size <= FS_INLINE_SIZE) {
+        fs_copy_out(f, 0, f->inline_data, size);
+        fs_free_data(f);
+        f->size = size;
+        return;
+    }
+
+    fs_extent_t* e = f->first;
+    uint32_t keep = size;
+    while (keep > e->len) {
+        keep -= e->len;
+        e = e->next;
+    }
+    e->len = keep;
+    fs_extent_t* rest = e->next;
+    while (rest) {
+        fs_extent_t* next = rest->next;
+        kfree(rest);
+        rest = next;
+    }
+    e->next = 0;
+    f->last = e;
+    f->size = size;
+}
+
+// Write len bytes at offset, overwriting what is there and appending the
+// rest. A gap past the end is zero-filled first, an extent at a time.
+// Returns bytes written (short if the heap ran out), or -1 with the file
+// unchanged if nothing could be written or the file would pass FS_FILE_MAX.
+static int fs_write_at(file_t* f, uint32_t offset, const char* data, uint32_t len) {
+    if (len == 0) return 0;
+    if (offset > FS_FILE_MAX || len > FS_FILE_MAX - offset) return -1;
+
+    uint32_t old_size = f->size;
+    if (f->size < offset) {
+        uint32_t gap = offset - f->size;
+        if (fs_append(f, 0, gap) != gap) {
+            fs_shrink(f, old_size);
+            return -1;
+        }
+    }
+
+    uint32_t over = f->size - offset;
+    if (over > len) over = len;
+    fs_copy_in(f, offset, data, over);
+    uint32_t done = over + fs_append(f, data + over, len - over);
+    if (done == 0) {
+        fs_shrink(f, old_size); // Drop the gap; nothing else changed
+        return -1;
+    }
+    return (int)done;
+}
+
+static void fs_free_inode(file_t* f) {
+    fs_free_data(f);
+    kfree(f);
+}
+
+// Descriptor entry for fd if task owns it, or 0
+static fs_fd_t* fs_fd_get(int fd, int task) {
+    if (fd < 0 || fd >= MAX_FDS || !fds[fd].file || fds[fd].owner != task) return 0;
+    return &fds[fd];
+}
+
+static void fs_fd_close(fs_fd_t* d) {
+    file_t* f = d->file;
+    d->file = 0;
+    if (--f->refs == 0 && f->unlinked) fs_free_inode(f);
+}
+
+// Allocate an inode called name (len bytes) in directory parent
+static int fs_new_node(int parent, const char *name, int len, int type) {
+    if (free_count == 0) return -1;
+    file_t* f = (file_t*)kmalloc(sizeof(file_t));
+    if (!f) return -1;
+
+    int i = free_slots[--free_count];
+    fs_strncpy(f->name, name, len);
+    f->hash = fs_hash_child(parent, name, len);
+    f->type = (uint8_t)type;
+    f->parent = (int16_t)parent;
+    f->first_child = -1;
+    f->last_child = -1;
+    f->prev_sibling = -1;
+    f->next_sibling = -1;
+    f->size = 0;
+    f->refs = 0;
+    f->unlinked = 0;
+    f->rodata = 0;
+    f->first = 0;
+    f->last = 0;
+    files[i] = f;
+
+    if (i != parent) {
+        // Keep children in creation order for listings
+        file_t* dir = files[parent];
+        f->prev_sibling = dir->last_child;
+        if (dir->last_child >= 0) files[dir->last_child]->next_sibling = (int16_t)i;
+        else dir->first_child = (int16_t)i;
+        dir->last_child = (int16_t)i;
+        fs_index_insert(i);
+    }
+    return i;
+}
+
+// rodata (size bytes) makes a read-only file
+static int fs_create(const char *path, int type, const char *rodata, uint32_t size) {
+    const char *name;
+    int len;
+    int result = -1; // No such directory, no space, or the name is taken
+    mutex_lock(&fs_lock);
+    int dir = fs_resolve_parent(path, &name, &len);
+    if (dir >= 0 && fs_lookup(dir, name, len, fs_hash_child(dir, name, len)) < 0) {
+        result = fs_new_node(dir, name, len, type);
+        if (result >= 0 && rodata) {
+            files[result]->rodata = rodata;
+            files[result]->size = size;
+        }
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
 
 // Initialize filesystem with default files
 void fs_init(void) {
+    mutex_init(&fs_lock, "fs");
     for(int i = 0; i < MAX_FILES; i++) {
-        files[i].used = 0;
-        files[i].size = 0;
-        files[i].name[0] = '\0';
+        files[i] = 0;
     }
-    
+    for (int i = 0; i < MAX_FDS; i++) fds[i].file = 0;
+    for (int i = 0; i < FS_DCACHE_SIZE; i++) fs_dcache[i].gen = 0;
+    free_count = 0;
+    for (int i = MAX_FILES - 1; i >= 0; i--) free_slots[free_count++] = (int16_t)i;
+    fs_index_rebuild();
+
+    // The root is its own parent and is not in the index
+    fs_new_node(FS_ROOT, "", 0, FS_TYPE_DIR);
+    fs_cwd = FS_ROOT;
+
     // Create some default files
     fs_create_file("readme.txt");
     fs_write_file("readme.txt", "Welcome to MyOS!\nType 'help' for commands.");
@@ -40,107 +542,296 @@ void fs_init(void) {
 
 // Create new file with given name
 int fs_create_file(const char *name) {
-    for(int i = 0; i < MAX_FILES; i++) {
-        if(!files[i].used) {
-            fs_strcpy(files[i].name, name);
-            files[i].used = 1;
-            files[i].size = 0;
-            files[i].content[0] = '\0';
-            return i;
-        }
-    }
-    return -1; // No space
+    return fs_create(name, FS_TYPE_FILE, 0, 0);
+}
+
+// Create a read-only file backed by memory outside the heap
+int fs_create_static(const char *name, const void *data, uint32_t size) {
+    return fs_create(name, FS_TYPE_FILE, (const char*)data, size);
+}
+
+// Create new directory with given name
+int fs_mkdir(const char *name) {
+    return fs_create(name, FS_TYPE_DIR, 0, 0);
 }
 
-// Write content to existing file
+// Replace the content of an existing file
 int fs_write_file(const char *name, const char *content) {
-    for(int i = 0; i < MAX_FILES; i++) {
-        if(files[i].used && fs_strcmp(files[i].name, name) == 0) {
-            fs_strcpy(files[i].content, content);
-            files[i].size = fs_strlen(content);
-            return i;
-        }
+    mutex_lock(&fs_lock);
+    int i = fs_resolve(name); // -1: file not found
+    if (i >= 0 && (files[i]->type != FS_TYPE_FILE || files[i]->rodata)) i = -1;
+    if (i >= 0) {
+        uint32_t len = (uint32_t)fs_strlen(content);
+        fs_free_data(files[i]);
+        if (fs_append(files[i], content, len) != len) i = -1; // Out of memory
+    }
+    mutex_unlock(&fs_lock);
+    return i;
+}
+
+// Add content at the end of an existing file
+int fs_append_file(const char *name, const char *content) {
+    mutex_lock(&fs_lock);
+    int i = fs_resolve(name); // -1: file not found
+    if (i >= 0 && (files[i]->type != FS_TYPE_FILE || files[i]->rodata)) i = -1;
+    if (i >= 0) {
+        uint32_t len = (uint32_t)fs_strlen(content);
+        if (fs_append(files[i], content, len) != len) i = -1; // Out of memory
     }
-    return -1; // File not found
+    mutex_unlock(&fs_lock);
+    return i;
 }
 
 // Read content from file into buffer
-int fs_read_file(const char *name, char *buffer) {
-    for(int i = 0; i < MAX_FILES; i++) {
-        if(files[i].used && fs_strcmp(files[i].name, name) == 0) {
-            fs_strcpy(buffer, files[i].content);
-            return files[i].size;
-        }
+int fs_read_file(const char *name, char *buffer, int size) {
+    int result = -1; // File not found
+    if (size <= 0) return -1;
+    mutex_lock(&fs_lock);
+    int i = fs_resolve(name);
+    if (i >= 0 && files[i]->type == FS_TYPE_FILE) {
+        file_t* f = files[i];
+        uint32_t n = f->size < (uint32_t)size - 1 ? f->size : (uint32_t)size - 1;
+        fs_copy_out(f, 0, buffer, n);
+        buffer[n] = '\0';
+        result = (int)f->size;
     }
-    return -1; // File not found
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+// Append a string, stopping short of the last byte of the buffer
+static int list_append(char *buffer, int pos, int size, const char *s) {
+    while (*s && pos < size - 1) buffer[pos++] = *s++;
+    return pos;
 }
 
-// List all files with their sizes
-int fs_list_files(char *buffer) {
+// List a directory's entries with their sizes
+int fs_list_files(const char *path, char *buffer, int size) {
     int pos = 0;
-    
-    // Add header
-    const char *header = "Files:\n";
-    while (*header) {
-        buffer[pos++] = *header++;
+    if (size <= 0) return -1;
+
+    mutex_lock(&fs_lock);
+    int dir = (path && path[0]) ? fs_resolve(path) : fs_cwd;
+    if (dir < 0 || files[dir]->type != FS_TYPE_DIR) {
+        mutex_unlock(&fs_lock);
+        buffer[0] = '\0';
+        return -1;
     }
-    
-    // List each file with size
-    for(int i = 0; i < MAX_FILES; i++) {
-        if(files[i].used) {
-            buffer[pos++] = '-';
-            buffer[pos++] = ' ';
-            
-            const char *name = files[i].name;
-            while (*name) {
-                buffer[pos++] = *name++;
-            }
-            
-            buffer[pos++] = ' ';
-            buffer[pos++] = '(';
-            
-            // Convert size to string
-            int size = files[i].size;
-            char size_str[16];
-            int size_len = 0;
-            int temp = size;
-            
-            if (temp == 0) {
-                size_str[size_len++] = '0';
-            } else {
-                while (temp > 0) {
-                    size_len++;
-                    temp /= 10;
-                }
-                temp = size;
-                for (int j = size_len - 1; j >= 0; j--) {
-                    size_str[j] = '0' + (temp % 10);
-                    temp /= 10;
-                }
-            }
-            size_str[size_len] = '\0';
-            
-            for (int j = 0; j < size_len; j++) {
-                buffer[pos++] = size_str[j];
-            }
-            
-            const char *footer = " bytes)\n";
-            while (*footer) {
-                buffer[pos++] = *footer++;
-            }
+
+    // Add header
+    pos = list_append(buffer, pos, size, "Files:\n");
+
+    // List each entry, directories with a trailing slash
+    for (int i = files[dir]->first_child; i >= 0; i = files[i]->next_sibling) {
+        pos = list_append(buffer, pos, size, "- ");
+        pos = list_append(buffer, pos, size, files[i]->name);
+        if (files[i]->type == FS_TYPE_DIR) {
+            pos = list_append(buffer, pos, size, "/\n");
+            continue;
         }
+        pos = list_append(buffer, pos, size, " (");
+
+        // Convert size to string
+        uint32_t temp = files[i]->size;
+        char size_str[12];
+        int size_len = sizeof(size_str) - 1;
+        size_str[size_len] = '\0';
+        do {
+            size_str[--size_len] = (char)('0' + temp % 10);
+            temp /= 10;
+        } while (temp > 0);
+        pos = list_append(buffer, pos, size, size_str + size_len);
+
+        pos = list_append(buffer, pos, size, files[i]->rodata ? " bytes, ro)\n" : " bytes)\n");
     }
+    mutex_unlock(&fs_lock);
     buffer[pos] = '\0';
     return pos;
 }
 
-// Delete file by name
+// Delete a file, or a directory that is empty and not the current one
 int fs_delete_file(const char *name) {
-    for(int i = 0; i < MAX_FILES; i++) {
-        if(files[i].used && fs_strcmp(files[i].name, name) == 0) {
-            files[i].used = 0;
-            return 0;
+    int result = -1; // Not found, or not removable
+    mutex_lock(&fs_lock);
+    int i = fs_resolve(name);
+    if (i >= 0 && i != FS_ROOT && i != fs_cwd && files[i]->first_child < 0) {
+        file_t* f = files[i];
+        file_t* dir = files[f->parent];
+        if (f->prev_sibling >= 0) files[f->prev_sibling]->next_sibling = f->next_sibling;
+        else dir->first_child = f->next_sibling;
+        if (f->next_sibling >= 0) files[f->next_sibling]->prev_sibling = f->prev_sibling;
+        else dir->last_child = f->prev_sibling;
+
+        fs_index_remove(i);
+        fs_dcache_gen++;
+        files[i] = 0;
+        fs_index_compact();
+        free_slots[free_count++] = (int16_t)i;
+        // Open descriptors keep reading and writing the nameless inode.
+        if (f->refs) f->unlinked = 1;
+        else fs_free_inode(f);
+        result = 0;
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+int fs_chdir(const char *path) {
+    int result = -1;
+    mutex_lock(&fs_lock);
+    int dir = fs_resolve(path);
+    if (dir >= 0 && files[dir]->type == FS_TYPE_DIR) {
+        fs_cwd = dir;
+        result = 0;
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+int fs_getcwd(char *buffer, int size) {
+    mutex_lock(&fs_lock);
+
+    // Measure first, then fill from the end while walking up again
+    int len = 0;
+    for (int i = fs_cwd; i != FS_ROOT; i = files[i]->parent) {
+        len += 1 + fs_strlen(files[i]->name);
+    }
+    if (len == 0) len = 1; // "/"
+
+    int result = -1;
+    if (len < size) {
+        buffer[0] = '/';
+        buffer[len] = '\0';
+        int pos = len;
+        for (int i = fs_cwd; i != FS_ROOT; i = files[i]->parent) {
+            int n = fs_strlen(files[i]->name);
+            pos -= n;
+            fs_memcpy(buffer + pos, files[i]->name, (uint32_t)n);
+            buffer[--pos] = '/';
+        }
+        result = len;
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+// Open (and optionally create or truncate) a file
+int fs_open(const char *name, int flags, int task) {
+    int access = flags & FS_O_ACCMODE;
+    if (access == FS_O_ACCMODE) return -1;
+    if ((flags & FS_O_TRUNC) && access == FS_O_RDONLY) return -1;
+
+    if (flags & FS_O_CREAT) fs_create_file(name); // Fails harmlessly if it exists
+
+    int result = -1; // Not found, or no free descriptor
+    mutex_lock(&fs_lock);
+    int i = fs_resolve(name);
+    if (i >= 0 && files[i]->rodata && access != FS_O_RDONLY) i = -1; // Read-only file
+    if (i >= 0 && files[i]->type == FS_TYPE_FILE) {
+        for (int fd = 0; fd < MAX_FDS; fd++) {
+            if (!fds[fd].file) {
+                file_t* f = files[i];
+                if (flags & FS_O_TRUNC) fs_free_data(f);
+                f->refs++;
+                fds[fd].file = f;
+                fds[fd].offset = 0;
+                fds[fd].flags = flags;
+                fds[fd].owner = task;
+                result = fd;
+                break;
+            }
+        }
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+// Read up to len bytes at the descriptor's offset
+int fs_read(int fd, void *buf, uint32_t len, int task) {
+    int result = -1;
+    mutex_lock(&fs_lock);
+    fs_fd_t* d = fs_fd_get(fd, task);
+    if (d && (d->flags & FS_O_ACCMODE) != FS_O_WRONLY) {
+        file_t* f = d->file;
+        uint32_t n = 0;
+        if (d->offset < f->size) {
+            n = f->size - d->offset;
+            if (n > len) n = len;
+            fs_copy_out(f, d->offset, (char*)buf, n);
+            d->offset += n;
+        }
+        result = (int)n;
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+// Write len bytes at the descriptor's offset
+int fs_write(int fd, const void *buf, uint32_t len, int task) {
+    int result = -1;
+    mutex_lock(&fs_lock);
+    fs_fd_t* d = fs_fd_get(fd, task);
+    if (d && (d->flags & FS_O_ACCMODE) != FS_O_RDONLY) {
+        if (d->flags & FS_O_APPEND) d->offset = d->file->size;
+        result = fs_write_at(d->file, d->offset, (const char*)buf, len);
+        if (result > 0) d->offset += (uint32_t)result;
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+// Move the descriptor's offset; seeking past the end is allowed, up to
+// FS_FILE_MAX
+int fs_lseek(int fd, int32_t offset, int whence, int task) {
+    int result = -1;
+    mutex_lock(&fs_lock);
+    fs_fd_t* d = fs_fd_get(fd, task);
+    if (d) {
+        int64_t base = -1;
+        if (whence == FS_SEEK_SET) base = 0;
+        else if (whence == FS_SEEK_CUR) base = d->offset;
+        else if (whence == FS_SEEK_END) base = d->file->size;
+
+        int64_t pos = base + offset;
+        if (base >= 0 && pos >= 0 && pos <= FS_FILE_MAX) {
+            d->offset = (uint32_t)pos;
+            result = (int)pos;
         }
     }
-    return -1; // File not found
-}
\ No newline at end of file
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+int fs_close(int fd, int task) {
+    int result = -1;
+    mutex_lock(&fs_lock);
+    fs_fd_t* d = fs_fd_get(fd, task);
+    if (d) {
+        fs_fd_close(d);
+        result = 0;
+    }
+    mutex_unlock(&fs_lock);
+    return result;
+}
+
+// Pointer to the whole file, for files that never change (no copy needed)
+const void *fs_map(int fd, uint32_t *size, int task) {
+    const void* data = 0;
+    mutex_lock(&fs_lock);
+    fs_fd_t* d = fs_fd_get(fd, task);
+    if (d && d->file->rodata) {
+        data = d->file->rodata;
+        *size = d->file->size;
+    }
+    mutex_unlock(&fs_lock);
+    return data;
+}
+
+// Close everything a task left open (called on exit)
+void fs_release(int task) {
+    mutex_lock(&fs_lock);
+    for (int fd = 0; fd < MAX_FDS; fd++) {
+        if (fds[fd].file && fds[fd].owner == task) fs_fd_close(&fds[fd]);
+    }
+    mutex_unlock(&fs_lock);
+}
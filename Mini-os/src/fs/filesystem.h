@@ -1,23 +1,116 @@
 #ifndef FILESYSTEM_H
 #define FILESYSTEM_H
 
-#define MAX_FILES 32
-#define MAX_FILENAME 32
-#define FILE_CONTENT_SIZE 1024
+#include <stdint.h>
 
+#define MAX_FILES 2048                  // power of two; files and directories
+#define MAX_FILENAME 32                 // one path component
+#define FS_PATH_MAX 256
+
+// Name index: open addressing over twice as many slots as files, so a
+// probe sequence stays short even with the table full. Entries are keyed
+// by (parent directory, name), which makes it every directory's child
+// lookup table at once.
+#define FS_INDEX_SIZE (MAX_FILES * 2)
+
+// Dentry cache: whole paths (relative to the root or the current
+// directory) that resolved recently, so a deep path costs one hash and
+// compare instead of a lookup per component. Paths longer than
+// FS_DCACHE_PATH are resolved but not cached.
+#define FS_DCACHE_SIZE 256              // power of two
+#define FS_DCACHE_PATH 64
+
+#define FS_ROOT 0                       // inode slot of "/"
+
+#define FS_TYPE_FILE 0
+#define FS_TYPE_DIR  1
+
+// File data: up to FS_INLINE_SIZE bytes live in the inode itself; larger
+// files move to a chain of kheap extents. A full last extent first tries
+// to grow in place in the heap; otherwise a new extent is sized to double
+// the file (clamped to FS_EXTENT_MIN..FS_EXTENT_MAX), so a file of n bytes
+// has O(log n) extents while small and wastes at most half. Appending
+// touches only the last extent and costs O(bytes written).
+#define FS_INLINE_SIZE 64
+#define FS_EXTENT_MIN  256u
+#define FS_EXTENT_MAX  65536u
+
+// Largest file the descriptor API will grow (a quarter of the kernel heap),
+// so one write past the end cannot zero-fill the heap away.
+#define FS_FILE_MAX    (4u * 1024u * 1024u)
+
+typedef struct fs_extent {
+    struct fs_extent* next;
+    uint32_t len;                       // bytes in use
+    uint32_t cap;                       // bytes allocated; data follows the header
+} fs_extent_t;
+
+// Inodes are allocated from the kernel heap on create. A directory's
+// children form a list threaded through the child inodes.
 typedef struct {
     char name[MAX_FILENAME];
-    char content[FILE_CONTENT_SIZE];
-    int size;
-    int used;
+    uint32_t hash;                      // hash of (parent, name), cached for the index
+    uint8_t type;                       // FS_TYPE_*
+    int16_t parent;                     // slot of the containing directory
+    int16_t first_child;                // directories only; -1 when empty
+    int16_t last_child;
+    int16_t prev_sibling;
+    int16_t next_sibling;
+    uint32_t size;
+    uint16_t refs;                      // open descriptors
+    uint8_t unlinked;                   // deleted while open; freed on last close
+    const char* rodata;                 // read-only data kept elsewhere (initrd), or 0
+    fs_extent_t* first;                 // 0 while the data is inline
+    fs_extent_t* last;
+    char inline_data[FS_INLINE_SIZE];
 } file_t;
 
-// Filesystem functions
+// Descriptors live in one kernel-wide table and remember their owner task:
+// only that task can use one, and sys_exit closes whatever it left open.
+#define MAX_FDS 64
+
+// fs_open flags: one access mode plus any of the modifiers
+#define FS_O_RDONLY 0x0
+#define FS_O_WRONLY 0x1
+#define FS_O_RDWR   0x2
+#define FS_O_ACCMODE 0x3
+#define FS_O_CREAT  0x100               // create the file if it is missing
+#define FS_O_TRUNC  0x200               // drop existing data (needs write access)
+#define FS_O_APPEND 0x400               // every write goes to the current end
+
+// fs_lseek whence
+#define FS_SEEK_SET 0
+#define FS_SEEK_CUR 1
+#define FS_SEEK_END 2
+
+// Filesystem functions. Names are paths: absolute ("/a/b"), relative to
+// the current directory, or under "~" (the root). "." and ".." work.
 void fs_init(void);                              // Initialize filesystem
-int fs_create_file(const char *name);           // Create new file
+int fs_create_file(const char *name);           // Create new file (-1 if it exists)
+int fs_mkdir(const char *name);                 // Create a directory (-1 if it exists)
 int fs_write_file(const char *name, const char *content);  // Write to file
-int fs_read_file(const char *name, char *buffer);         // Read from file
-int fs_list_files(char *buffer);                // List all files
-int fs_delete_file(const char *name);           // Delete file
+int fs_append_file(const char *name, const char *content); // Append to file
+int fs_read_file(const char *name, char *buffer, int size); // Read up to size - 1 bytes, NUL-terminated; returns file size
+int fs_list_files(const char *path, char *buffer, int size); // List a directory (0 or "" = current; truncated to size)
+int fs_delete_file(const char *name);           // Delete a file or an empty directory
+int fs_chdir(const char *path);                 // Change the current directory
+int fs_getcwd(char *buffer, int size);          // Absolute path of the current directory (-1 if it does not fit)
+
+// Add a read-only file whose size bytes stay at data (which must outlive
+// the file). It cannot be written or truncated, only deleted.
+int fs_create_static(const char *name, const void *data, uint32_t size);
+
+// Descriptor API. Data is binary; reads and writes move at most len bytes
+// at the descriptor's offset and advance it. Writing past the end zero-fills
+// the gap. task is the caller (the submitting task for ring calls); a
+// descriptor opened by another task counts as bad. All return -1 on a bad
+// descriptor or access mode.
+int fs_open(const char *name, int flags, int task); // Returns a descriptor owned by task
+int fs_read(int fd, void *buf, uint32_t len, int task); // Bytes read, 0 at end of file
+int fs_write(int fd, const void *buf, uint32_t len, int task); // Bytes written (short if out of memory)
+int fs_lseek(int fd, int32_t offset, int whence, int task); // Returns the new offset
+int fs_close(int fd, int task);
+const void *fs_map(int fd, uint32_t *size, int task); // Whole contents in place (read-only files only, else 0)
+void fs_release(int task);                      // Close all of a task's descriptors
 
 #endif
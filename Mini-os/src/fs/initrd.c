@@ -0,0 +1,47 @@
+#include "initrd.h"
+#include "filesystem.h"
+#include <stdint.h>
+
+// Bounds of the .initrd section (linker.ld)
+extern uint8_t _initrd_start[];
+extern uint8_t _initrd_end[];
+
+// Create every directory on the way to path (existing ones are fine)
+static void initrd_make_dirs(const char *path) {
+    char dir[FS_PATH_MAX];
+    for (int i = 0; path[i] && i < FS_PATH_MAX - 1; i++) {
+        if (path[i] == '/' && i > 0) {
+            dir[i] = '\0';
+            fs_mkdir(dir);
+        }
+        dir[i] = path[i];
+    }
+}
+
+int initrd_init(void) {
+    const uint8_t* base = _initrd_start;
+    uint32_t avail = (uint32_t)(_initrd_end - _initrd_start);
+    const initrd_header_t* h = (const initrd_header_t*)base;
+
+    if (avail < sizeof(initrd_header_t) || h->magic != INITRD_MAGIC || h->size > avail) return -1;
+    if (h->count > (h->size - sizeof(initrd_header_t)) / sizeof(initrd_entry_t)) return -1;
+
+    const initrd_entry_t* e = (const initrd_entry_t*)(h + 1);
+    int added = 0;
+    for (uint32_t i = 0; i < h->count; i++) {
+        if (e[i].path_offset >= h->size || e[i].data_offset > h->size ||
+            e[i].size > h->size - e[i].data_offset) {
+            continue;
+        }
+
+        // The path must end inside the image
+        const char* path = (const char*)base + e[i].path_offset;
+        uint32_t len = 0;
+        while (e[i].path_offset + len < h->size && path[len]) len++;
+        if (e[i].path_offset + len == h->size || len == 0 || len >= FS_PATH_MAX) continue;
+
+        initrd_make_dirs(path);
+        if (fs_create_static(path, (const char*)base + e[i].data_offset, e[i].size) >= 0) added++;
+    }
+    return added;
+}
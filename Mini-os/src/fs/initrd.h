@@ -0,0 +1,39 @@
+#ifndef INITRD_H
+#define INITRD_H
+
+#include <stdint.h>
+
+// Read-only initial ramdisk. tools/mkinitrd packs the files under initrd/
+// into one image at build time. initrd_data.asm links it into the kernel
+// image, so the bootloader loads it together with the kernel. At boot the
+// files are added to the filesystem by path, and their data stays where it
+// is: reads copy straight out of the archive and fs_map() hands out
+// pointers into it.
+//
+// Layout (little endian, offsets from the start of the image):
+//   initrd_header_t
+//   initrd_entry_t[count]
+//   paths, each NUL-terminated
+//   file data, each aligned to INITRD_ALIGN
+
+#define INITRD_MAGIC 0x44524E49u        // "INRD"
+#define INITRD_ALIGN 16
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;                     // entries
+    uint32_t size;                      // whole image, in bytes
+} initrd_header_t;
+
+typedef struct {
+    uint32_t path_offset;               // relative path, e.g. "docs/fs.txt"
+    uint32_t data_offset;
+    uint32_t size;
+} initrd_entry_t;
+
+// Check the linked-in image and add its files (and their directories)
+// under the root. Call after fs_init(). Returns the number of files added,
+// or -1 if the image is missing or malformed.
+int initrd_init(void);
+
+#endif
@@ -0,0 +1,4 @@
+; Initial ramdisk image built by tools/mkinitrd (see initrd.h). The makefile
+; puts the build directory on the include path so incbin finds it.
+section .initrd progbits alloc noexec nowrite align=16
+    incbin "initrd.img"
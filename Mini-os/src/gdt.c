@@ -0,0 +1,83 @@
+#include "gdt.h"
+#include "kernel/smp.h"
+
+#define GDT_FIXED_ENTRIES 5
+#define GDT_ENTRIES (GDT_FIXED_ENTRIES + MAX_CPUS)
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) gdtr_t;
+
+static uint64_t gdt_entries[GDT_ENTRIES];
+static gdtr_t gdtr;
+static tss_t tss[MAX_CPUS];
+
+// Encode a segment descriptor (limit in 4 KiB units when flags has G set)
+static uint64_t gdt_descriptor(uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+    uint64_t d = 0;
+    d |= limit & 0xFFFFu;
+    d |= (uint64_t)(base & 0xFFFFFFu) << 16;
+    d |= (uint64_t)access << 40;
+    d |= (uint64_t)((limit >> 16) & 0xFu) << 48;
+    d |= (uint64_t)(flags & 0xFu) << 52;
+    d |= (uint64_t)((base >> 24) & 0xFFu) << 56;
+    return d;
+}
+
+static void gdt_load_cpu(int cpu) {
+    __asm__ __volatile__("lgdt (%0)" : : "r"(&gdtr) : "memory");
+
+    // Reload CS with a far return, then the data segments.
+    __asm__ __volatile__(
+        "pushl %0\n\t"
+        "pushl $1f\n\t"
+        "lret\n"
+        "1:\n\t"
+        "movw %w1, %%ds\n\t"
+        "movw %w1, %%es\n\t"
+        "movw %w1, %%fs\n\t"
+        "movw %w1, %%gs\n\t"
+        "movw %w1, %%ss"
+        : : "i"(GDT_KERNEL_CS), "r"(GDT_KERNEL_DS) : "memory");
+
+    uint16_t sel = (uint16_t)(GDT_TSS_BASE + 8 * cpu);
+    __asm__ __volatile__("ltr %0" : : "r"(sel));
+}
+
+void gdt_init(void) {
+    gdt_entries[0] = 0;
+    gdt_entries[1] = gdt_descriptor(0, 0xFFFFF, 0x9A, 0xC);  // ring 0 code
+    gdt_entries[2] = gdt_descriptor(0, 0xFFFFF, 0x92, 0xC);  // ring 0 data
+    gdt_entries[3] = gdt_descriptor(0, 0xFFFFF, 0xFA, 0xC);  // ring 3 code
+    gdt_entries[4] = gdt_descriptor(0, 0xFFFFF, 0xF2, 0xC);  // ring 3 data
+
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        tss_t* t = &tss[cpu];
+        uint8_t* p = (uint8_t*)t;
+        for (uint32_t i = 0; i < sizeof(tss_t); i++) p[i] = 0;
+        t->ss0 = GDT_KERNEL_DS;
+        t->iomap_base = sizeof(tss_t);   // no I/O permission bitmap
+
+        // Available 32-bit TSS, byte granular
+        gdt_entries[GDT_FIXED_ENTRIES + cpu] =
+            gdt_descriptor((uint32_t)(uintptr_t)t, sizeof(tss_t) - 1, 0x89, 0x0);
+    }
+
+    gdtr.limit = sizeof(gdt_entries) - 1;
+    gdtr.base = (uint32_t)(uintptr_t)gdt_entries;
+    gdt_load_cpu(0);
+}
+
+void gdt_init_ap(int cpu) {
+    if (cpu <= 0 || cpu >= MAX_CPUS) return;
+    gdt_load_cpu(cpu);
+}
+
+void tss_set_kernel_stack(uint32_t esp0) {
+    tss[smp_cpu_id()].esp0 = esp0;
+}
+
+tss_t* tss_for_cpu(int cpu) {
+    return &tss[cpu];
+}
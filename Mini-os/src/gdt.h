@@ -0,0 +1,45 @@
+// gdt.h
+#ifndef GDT_H
+#define GDT_H
+
+#include <stdint.h>
+
+// Kernel GDT: flat ring 0 and ring 3 segments plus one TSS per CPU.
+// The order of the first four is fixed by SYSENTER/SYSEXIT, which derive
+// the kernel SS and the user CS/SS from IA32_SYSENTER_CS.
+#define GDT_KERNEL_CS 0x08
+#define GDT_KERNEL_DS 0x10
+#define GDT_USER_CS   0x1B   // 0x18 | RPL 3
+#define GDT_USER_DS   0x23   // 0x20 | RPL 3
+#define GDT_TSS_BASE  0x28   // CPU n's TSS is GDT_TSS_BASE + 8 * n
+
+// 32-bit task state segment. Only ss0:esp0 is used: the stack the CPU
+// switches to when an interrupt or exception arrives in ring 3.
+typedef struct {
+    uint32_t prev_task;
+    uint32_t esp0;
+    uint32_t ss0;
+    uint32_t esp1, ss1, esp2, ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint16_t trap;
+    uint16_t iomap_base;
+} __attribute__((packed)) tss_t;
+
+// Build the GDT, load it on the BSP and reload every segment register.
+// Replaces the bootloader's GDT; call before init_idt().
+void gdt_init(void);
+
+// Load the GDT and this CPU's TSS on an application processor.
+void gdt_init_ap(int cpu);
+
+// Ring 0 stack for interrupts taken in ring 3 on the calling CPU. The
+// scheduler sets it to the kernel stack of each user task it switches to.
+void tss_set_kernel_stack(uint32_t esp0);
+
+// This CPU's TSS (SYSENTER loads its stack pointer from esp0).
+tss_t* tss_for_cpu(int cpu);
+
+#endif
@@ -0,0 +1,146 @@
+#include "console.h"
+#include "vbe.h"
+#include "../drivers/clock.h"
+#include "../sched/sync.h"
+#include "../sched/timer.h"
+
+// Cursor is (col, y): col in cells, y in pixels. Pending bytes start at
+// col and all share pend_color.
+static mutex_t console_lock;
+static int col = 0;
+static int y = CONSOLE_ORIGIN_Y;
+static char pend[CONSOLE_MAX_COLS];
+static int pend_len = 0;
+static uint32_t pend_color = 0;
+
+static int timer_ready = 0;
+static volatile int timer_armed = 0;
+
+static int console_cols(void) {
+    extern struct vbe_mode_info* vbe_info;
+    int width = (vbe_info && vbe_info->framebuffer) ? vbe_info->width : 800;
+    int cols = (width - CONSOLE_ORIGIN_X) / CONSOLE_CELL_W;
+    return cols > CONSOLE_MAX_COLS ? CONSOLE_MAX_COLS : cols;
+}
+
+static int console_height(void) {
+    extern struct vbe_mode_info* vbe_info;
+    return (vbe_info && vbe_info->framebuffer) ? vbe_info->height : 600;
+}
+
+// The rest of the helpers run with console_lock held.
+
+static void flush_locked(void) {
+    if (pend_len == 0) return;
+    vbe_draw_span(CONSOLE_ORIGIN_X + col * CONSOLE_CELL_W, y, pend, pend_len,
+                  pend_color, vbe_rgb(0, 0, 0), CONSOLE_SCALE);
+    col += pend_len;
+    pend_len = 0;
+}
+
+static void scroll_locked(void) {
+    vbe_scroll_up(CONSOLE_ORIGIN_Y, CONSOLE_LINE_H, vbe_rgb(0, 0, 0));
+    y -= CONSOLE_LINE_H;
+}
+
+static void newline_locked(void) {
+    flush_locked();
+    col = 0;
+    y += CONSOLE_LINE_H;
+    if (y + CONSOLE_LINE_H > console_height()) {
+        scroll_locked();
+    }
+}
+
+// SOFTIRQ_TIMER: draw what is pending. If a writer holds the console it
+// may already have seen timer_armed set and skipped arming, so stay armed
+// and try again one interval later.
+static void console_timer_fn(void* arg) {
+    (void)arg;
+    if (mutex_trylock(&console_lock)) {
+        timer_armed = 0;
+        flush_locked();
+        mutex_unlock(&console_lock);
+    } else if (timer_add(clock_ns() + CONSOLE_FLUSH_NS, console_timer_fn, 0) < 0) {
+        timer_armed = 0; // No timer: the next write flushes or re-arms
+    }
+}
+
+static void console_unlock(void) {
+    if (pend_len) {
+        if (!timer_ready) {
+            flush_locked();
+        } else if (!timer_armed) {
+            timer_armed = 1;
+            if (timer_add(clock_ns() + CONSOLE_FLUSH_NS, console_timer_fn, 0) < 0) {
+                timer_armed = 0;
+                flush_locked();
+            }
+        }
+    }
+    mutex_unlock(&console_lock);
+}
+
+void console_init(void) {
+    mutex_init(&console_lock, "console");
+    timer_ready = 1;
+}
+
+void console_write(const char* s, int len, uint32_t color) {
+    mutex_lock(&console_lock);
+    int cols = console_cols();
+    for (int i = 0; i < len; i++) {
+        char c = s[i];
+        if (c == '\n') {
+            newline_locked();
+            continue;
+        }
+        if (pend_len && color != pend_color) flush_locked();
+        if (col + pend_len >= cols) newline_locked();
+        pend[pend_len++] = c;
+        pend_color = color;
+    }
+    console_unlock();
+}
+
+void console_flush(void) {
+    mutex_lock(&console_lock);
+    flush_locked();
+    console_unlock();
+}
+
+void console_backspace(void) {
+    mutex_lock(&console_lock);
+    flush_locked();
+    if (col > 0) {
+        col--;
+    } else if (y > CONSOLE_ORIGIN_Y) {
+        col = console_cols() - 1;
+        y -= CONSOLE_LINE_H;
+    }
+    vbe_fill_rect(CONSOLE_ORIGIN_X + col * CONSOLE_CELL_W, y, CONSOLE_CELL_W, CONSOLE_LINE_H, vbe_rgb(0, 0, 0));
+    console_unlock();
+}
+
+void console_clear(void) {
+    mutex_lock(&console_lock);
+    vbe_clear_screen(vbe_rgb(0, 0, 0));
+    pend_len = 0;
+    col = 0;
+    y = CONSOLE_ORIGIN_Y;
+    console_unlock();
+}
+
+void console_scroll(void) {
+    mutex_lock(&console_lock);
+    flush_locked();
+    scroll_locked();
+    console_unlock();
+}
+
+void console_get_cursor(int* x_out, int* y_out) {
+    mutex_lock(&console_lock);
+    *x_out = CONSOLE_ORIGIN_X + (col + pend_len) * CONSOLE_CELL_W;
+    *y_out = y;
+    console_unlock();
+}
@@ -0,0 +1,41 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+
+// Text console on the VBE framebuffer, shared by the shell (shell_print)
+// and sys_write. Bytes are buffered and drawn a span at a time with
+// vbe_draw_span(): on newline, when the line fills up (wrap), when the
+// color changes, and otherwise CONSOLE_FLUSH_NS after the first pending
+// byte. Writing past the bottom row scrolls.
+
+#define CONSOLE_ORIGIN_X 5
+#define CONSOLE_ORIGIN_Y 5
+#define CONSOLE_SCALE    2
+#define CONSOLE_CELL_W   (8 * CONSOLE_SCALE)
+#define CONSOLE_LINE_H   20                // same as the shell's LINE_HEIGHT
+#define CONSOLE_MAX_COLS 128
+
+#define CONSOLE_FLUSH_NS 10000000ull       // 10 ms
+
+// Enable the flush timer. Call after timer_init(); until then every write
+// is drawn before it returns.
+void console_init(void);
+
+// Task context only (the console is guarded by a mutex).
+void console_write(const char* s, int len, uint32_t color);
+void console_flush(void);
+
+// Erase the character before the cursor (moving back over a wrap).
+void console_backspace(void);
+
+// Clear the screen and move the cursor to the top left.
+void console_clear(void);
+
+// Scroll up one line; the cursor moves up with the text.
+void console_scroll(void);
+
+// Pixel position where the next character goes (pending bytes included)
+void console_get_cursor(int* x, int* y);
+
+#endif
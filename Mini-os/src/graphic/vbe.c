@@ -1,4 +1,5 @@
 #include "vbe.h"
+#include "../drivers/clock.h"
 #include <stdint.h>
 
 // Simple 8x8 font - contains 95 ASCII characters 
@@ -198,11 +199,102 @@ void vbe_draw_string(int x, int y, const char* str, uint32_t color, int scale) {
     }
 }
 
+// Store one pixel at p in the framebuffer's format
+static inline void vbe_store(uint8_t* p, int bpp, uint32_t color) {
+    if (bpp == 2) {
+        *(uint16_t*)p = (uint16_t)color;
+    } else if (bpp == 3) {
+        p[0] = color & 0xFF;
+        p[1] = (color >> 8) & 0xFF;
+        p[2] = (color >> 16) & 0xFF;
+    } else if (bpp == 4) {
+        *(uint32_t*)p = color;
+    }
+}
+
+// Copy n bytes forward (rows never overlap in the direction we copy)
+static void vbe_copy(uint8_t* dst, const uint8_t* src, uint32_t n) {
+    uint32_t words = n / 4;
+    __asm__ __volatile__("rep movsl" : "+D"(dst), "+S"(src), "+c"(words) : : "memory");
+    for (uint32_t i = 0; i < (n & 3); i++) dst[i] = src[i];
+}
+
+void vbe_fill_rect(int x, int y, int w, int h, uint32_t color) {
+    if (vbe_info->framebuffer == 0) return;
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > vbe_info->width) w = vbe_info->width - x;
+    if (y + h > vbe_info->height) h = vbe_info->height - y;
+    if (w <= 0 || h <= 0) return;
+
+    uint8_t* fb = (uint8_t*)vbe_info->framebuffer;
+    int pitch = vbe_info->pitch;
+    int bpp = vbe_info->bpp / 8;
+
+    // Fill the first row, then copy it down.
+    uint8_t* first = fb + (y * pitch) + (x * bpp);
+    for (int col = 0; col < w; col++) {
+        vbe_store(first + col * bpp, bpp, color);
+    }
+    for (int row = 1; row < h; row++) {
+        vbe_copy(first + row * pitch, first, (uint32_t)(w * bpp));
+    }
+}
+
+void vbe_draw_span(int x, int y, const char* str, int len, uint32_t color, uint32_t bg, int scale) {
+    if (vbe_info->framebuffer == 0 || x < 0 || y < 0) return;
+    int cell = 8 * scale;
+    if (x + len * cell > vbe_info->width) len = (vbe_info->width - x) / cell;
+    if (y + cell > vbe_info->height || len <= 0) return;
+
+    uint8_t* fb = (uint8_t*)vbe_info->framebuffer;
+    int pitch = vbe_info->pitch;
+    int bpp = vbe_info->bpp / 8;
+
+    // Each font row is drawn once across the whole span, then copied to
+    // the other scale - 1 scanlines it covers.
+    for (int row = 0; row < 8; row++) {
+        uint8_t* line = fb + ((y + row * scale) * pitch) + (x * bpp);
+        uint8_t* p = line;
+        for (int i = 0; i < len; i++) {
+            char c = str[i];
+            if (c < 32 || c > 126) c = '?';
+            uint8_t font_row = simple_font[c - 32][row];
+            for (int col = 0; col < 8; col++) {
+                uint32_t pixel = (font_row & (1 << (7 - col))) ? color : bg;
+                for (int sx = 0; sx < scale; sx++) {
+                    vbe_store(p, bpp, pixel);
+                    p += bpp;
+                }
+            }
+        }
+        for (int sy = 1; sy < scale; sy++) {
+            vbe_copy(line + sy * pitch, line, (uint32_t)(len * cell * bpp));
+        }
+    }
+}
+
+void vbe_scroll_up(int top, int dy, uint32_t bg) {
+    if (vbe_info->framebuffer == 0 || dy <= 0) return;
+    int height = vbe_info->height;
+    if (top < 0) top = 0;
+    if (top + dy > height) dy = height - top;
+
+    uint8_t* fb = (uint8_t*)vbe_info->framebuffer;
+    int pitch = vbe_info->pitch;
+    uint32_t row_bytes = (uint32_t)vbe_info->width * (vbe_info->bpp / 8);
+
+    for (int y = top; y < height - dy; y++) {
+        vbe_copy(fb + (y * pitch), fb + ((y + dy) * pitch), row_bytes);
+    }
+    vbe_fill_rect(0, height - dy, vbe_info->width, dy, bg);
+}
+
 void vbe_safe_clear_screen(uint32_t color) {
     // Clear the entire screen
     vbe_clear_screen(color);
     
     // Add a small delay to ensure the clear operation completes
     // This prevents race conditions with shell redraw
-    for (volatile int i = 0; i < 100000; i++);
+    udelay(1000);
 }
\ No newline at end of file
@@ -50,6 +50,17 @@ void vbe_draw_char(int x, int y, char c, uint32_t color, int scale);
 // Draw a string at specified position with scaling
 void vbe_draw_string(int x, int y, const char* str, uint32_t color, int scale);
 
+// Fill a rectangle, clipped to the screen
+void vbe_fill_rect(int x, int y, int w, int h, uint32_t color);
+
+// Draw len characters in one pass, opaque (bg behind the glyphs). Clipped
+// at the right edge; cheaper than vbe_draw_char per character.
+void vbe_draw_span(int x, int y, const char* str, int len, uint32_t color, uint32_t bg, int scale);
+
+// Move everything from scanline top + dy up by dy scanlines and fill the
+// bottom dy scanlines with bg
+void vbe_scroll_up(int top, int dy, uint32_t bg);
+
 void vbe_safe_clear_screen(uint32_t color) ;
 
 #endif
\ No newline at end of file
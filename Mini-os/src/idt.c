@@ -1,15 +1,86 @@
 #include "idt.h"
 #include "graphic/vbe.h"
 #include "io.h"
-#include "drivers/keyboard.h"
 #include "syscall/syscall.h" 
 #include "drivers/pit.h"
+#include "drivers/clock.h"
+#include "drivers/lapic.h"
+#include "drivers/ioapic.h"
+#include "kernel/acpi.h"
+#include "kernel/smp.h"
 #include "sched/sched.h"
+#include "sched/timer.h"
+#include "sched/softirq.h"
+#include "sched/fpu.h"
+#include "sched/sync.h"
 
 // IDT with 256 entries and IDT Register
 idt_entry_t idt_entries[256];
 idtr_t idtr;
 
+// Device IRQ delivery (see irqchip_select)
+static int irqchip = IRQCHIP_PIC;
+static int ioapic_routed = 0;
+
+// IRQ lines with a registered handler; the rest stay masked on whichever
+// controller is active. Deferred lines are masked until their handler runs.
+static uint16_t irq_enabled_mask = 0;
+static uint16_t irq_deferred_mask = 0;
+
+typedef struct {
+    irq_fn_t fn;
+    void* ctx;
+    const char* name;
+    uint8_t prio;              // 0 = highest (see irq_line_prio)
+    volatile uint8_t running;  // handler active: a repeat is deferred to it
+    volatile uint8_t pending;  // fired while running or while outranked
+} irq_desc_t;
+
+static irq_desc_t irq_descs[IRQ_LINES];
+
+// 8259 fixed priority order (IRQ0 highest, slave lines ranked at IRQ2).
+// Lines below IRQ0 run their handler with interrupts enabled, so a slow
+// handler can be preempted by the tick and by any higher-ranked line.
+static const uint8_t irq_line_prio[IRQ_LINES] = {
+    0, 1, 2, 10, 11, 12, 13, 14, 2, 3, 4, 5, 6, 7, 8, 9,
+};
+#define IRQ_PRIO_TICK 0
+#define IRQ_PRIO_NONE 0xFF
+
+// Per-CPU nesting state: depth of irq_handler frames and the priority of
+// the innermost running device handler.
+static int irq_depth[MAX_CPUS];
+static uint8_t irq_cur_prio[MAX_CPUS];
+static volatile uint8_t irq_tick_missed[MAX_CPUS];
+static uint32_t irq_max_depth = 0;
+static uint32_t irq_deferred_count = 0;
+
+// Guards irq_descs, the enable mask and controller programming
+static spinlock_t irq_lock;
+
+// Per-CPU counters for every vector irq_handler sees (see irq_stat_slot)
+typedef struct {
+    uint32_t count;
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+    uint32_t hist[IRQ_HIST_BUCKETS];
+} irq_counters_t;
+
+static irq_counters_t irq_counters[MAX_CPUS][IRQ_STAT_SLOTS];
+static const char* const local_vector_names[IRQ_STAT_SLOTS - IRQ_LINES] = {
+    "lapictmr", "resched", "yield",
+};
+static const uint8_t local_vectors[IRQ_STAT_SLOTS - IRQ_LINES] = {
+    LAPIC_TIMER_VECTOR, RESCHED_IPI_VECTOR, SCHED_YIELD_VECTOR,
+};
+
+// Histogram upper bounds in cycles; the last bucket is open.
+static const uint32_t irq_hist_bounds[IRQ_HIST_BUCKETS - 1] = {
+    1000u, 4000u, 16000u, 64000u,
+};
+
+static irq_cycle_stats_t irq_cycles[2];
+
 // Configure an IDT gate entry for interrupt handler
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags) {
     idt_entries[num].offset_low = base & 0xFFFF;
@@ -57,6 +128,18 @@ void debug_interrupt(registers_t *regs, const char* type, int y_offset) {
 
 // CPU Exception Handler (Interrupts 0-31)
 void isr_handler(registers_t *regs) {
+    // The gate cleared IF; the tracer sees that section only if the
+    // interrupted code had interrupts on.
+    int irqs_were_on = (regs->eflags & EFLAGS_IF) != 0;
+    if (irqs_were_on) trace_irqs_off();
+
+    // Device Not Available: lazy FPU switch, not an error
+    if (regs->int_no == 7) {
+        fpu_handle_nm();
+        if (irqs_were_on) trace_irqs_on();
+        return;
+    }
+
     debug_interrupt(regs, "ISR:", 10);
     
     // Handle specific CPU exceptions
@@ -65,18 +148,32 @@ void isr_handler(registers_t *regs) {
     } else if (regs->int_no == 14) { // Page Fault
         vbe_draw_string(50, 150, "PAGE FAULT!", vbe_rgb(255, 0, 0), 3);
     }
-}
 
-// System Call Handler (Interrupt 0x80)
-void syscall_handler(registers_t *regs) {
-    // Call the system call dispatcher
-    syscall_dispatcher(regs);
+    // A fault in ring 3 ends the task instead of returning to the faulting
+    // instruction.
+    if ((regs->cs & 3) == 3) {
+        vbe_draw_string(50, 180, "USER TASK KILLED", vbe_rgb(255, 0, 0), 2);
+        sys_exit(-1);
+    }
+    if (irqs_were_on) trace_irqs_on();
 }
 
 
 
 
 
+
+// Program the 8259 masks from irq_enabled_mask (cascade line open when any
+// slave IRQ is enabled).
+static void pic_apply_mask(void) {
+    uint16_t mask = irq_enabled_mask & (uint16_t)~irq_deferred_mask;
+    uint8_t master = (uint8_t)~(mask & 0xFFu);
+    uint8_t slave = (uint8_t)~(mask >> 8);
+    if (slave != 0xFF) master &= (uint8_t)~(1u << 2);
+    outb(0x21, master);
+    outb(0xA1, slave);
+}
+
 // Initialize Programmable Interrupt Controller
 void init_pic(void) {
     // Initialize PICs with ICW1-4 sequence
@@ -92,9 +189,253 @@ void init_pic(void) {
     outb(0x21, 0x01);  // ICW4: 8086 mode
     outb(0xA1, 0x01);
     
-    // Mask all interrupts except timer (IRQ0) and keyboard (IRQ1)
-    outb(0x21, 0xFC);  // 11111100 - enable IRQ0 and IRQ1
-    outb(0xA1, 0xFF);  // 11111111 - disable all slave PIC interrupts
+    // Mask every line without a registered handler
+    pic_apply_mask();
+}
+
+// Unmask the enabled IRQ lines at whichever controller is active and mask
+// them at the other one. Caller must have interrupts disabled.
+static void irqchip_apply_masks(void) {
+    const acpi_platform_t* p = acpi_platform();
+    if (ioapic_routed) {
+        uint16_t mask = irq_enabled_mask & (uint16_t)~irq_deferred_mask;
+        for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+            if (irq == 2) continue;
+            int enabled = (mask >> irq) & 1u;
+            ioapic_set_masked(p->isa_gsi[irq], !(irqchip == IRQCHIP_APIC && enabled));
+        }
+    }
+    if (irqchip == IRQCHIP_APIC) {
+        outb(0x21, 0xFF);
+        outb(0xA1, 0xFF);
+    } else {
+        pic_apply_mask();
+    }
+}
+
+// Route every ISA IRQ to vector 32+irq on the BSP, honouring the firmware's
+// GSI overrides and polarity/trigger flags. Pins start masked.
+static void ioapic_route_isa(void) {
+    const acpi_platform_t* p = acpi_platform();
+    ioapic_init(p->ioapic_base, p->ioapic_gsi_base);
+    uint8_t bsp = lapic_id();
+    for (int irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        if (irq == 2) continue; // 8259 cascade; IRQ0 usually overrides to GSI 2
+        ioapic_route(p->isa_gsi[irq], (uint8_t)(32 + irq), bsp, p->isa_flags[irq]);
+    }
+    ioapic_routed = 1;
+}
+
+int irqchip_available(int chip) {
+    if (chip == IRQCHIP_PIC) return 1;
+    return chip == IRQCHIP_APIC && lapic_is_enabled() && acpi_platform()->ioapic_base != 0;
+}
+
+int irqchip_select(int chip) {
+    if (!irqchip_available(chip)) return 0;
+
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    if (chip == IRQCHIP_APIC && !ioapic_routed) {
+        ioapic_route_isa();
+    }
+    irqchip = chip;
+    irqchip_apply_masks();
+    spin_unlock_irqrestore(&irq_lock, flags);
+    return 1;
+}
+
+int irq_register(int irq, irq_fn_t handler, void* ctx, const char* name) {
+    if (irq < 0 || irq >= IRQ_LINES || irq == 2 || !handler) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    irq_desc_t* d = &irq_descs[irq];
+    if (d->fn && (d->fn != handler || d->ctx != ctx)) {
+        spin_unlock_irqrestore(&irq_lock, flags);
+        return -1;
+    }
+    d->ctx = ctx;
+    d->name = name;
+    d->prio = irq_line_prio[irq];
+    d->fn = handler;
+    irq_enabled_mask |= (uint16_t)(1u << irq);
+    irqchip_apply_masks();
+    spin_unlock_irqrestore(&irq_lock, flags);
+    return 0;
+}
+
+void irq_unregister(int irq) {
+    if (irq < 0 || irq >= IRQ_LINES) return;
+
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    irq_enabled_mask &= (uint16_t)~(1u << irq);
+    irqchip_apply_masks();
+    irq_descs[irq].fn = 0;
+    irq_descs[irq].ctx = 0;
+    irq_descs[irq].name = 0;
+    spin_unlock_irqrestore(&irq_lock, flags);
+}
+
+// Counter slot for a vector: IRQ lines first, then local APIC/software ones.
+static int irq_stat_slot(uint32_t vector) {
+    if (vector >= 32 && vector < 32 + IRQ_LINES) return (int)(vector - 32);
+    for (int i = 0; i < IRQ_STAT_SLOTS - IRQ_LINES; i++) {
+        if (local_vectors[i] == vector) return IRQ_LINES + i;
+    }
+    return -1;
+}
+
+static void irq_account(int cpu, int slot, uint64_t cycles) {
+    irq_counters_t* s = &irq_counters[cpu][slot];
+    uint32_t c = (cycles > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)cycles;
+    int b = 0;
+    while (b < IRQ_HIST_BUCKETS - 1 && c >= irq_hist_bounds[b]) b++;
+    s->count++;
+    s->total_cycles += c;
+    if (c > s->max_cycles) s->max_cycles = c;
+    s->hist[b]++;
+}
+
+int irq_stats_get(int slot, irq_stats_t* out) {
+    if (slot < 0 || slot >= IRQ_STAT_SLOTS) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&irq_lock);
+    if (slot < IRQ_LINES) {
+        out->name = irq_descs[slot].name;
+        out->vector = 32 + slot;
+    } else {
+        out->name = local_vector_names[slot - IRQ_LINES];
+        out->vector = local_vectors[slot - IRQ_LINES];
+    }
+    spin_unlock_irqrestore(&irq_lock, flags);
+
+    // Counters are summed without stopping other CPUs: a snapshot may be
+    // off by the interrupts that land while it is taken.
+    out->count = 0;
+    out->total_cycles = 0;
+    out->max_cycles = 0;
+    for (int b = 0; b < IRQ_HIST_BUCKETS; b++) out->hist[b] = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        const irq_counters_t* s = &irq_counters[cpu][slot];
+        out->count += s->count;
+        out->total_cycles += s->total_cycles;
+        if (s->max_cycles > out->max_cycles) out->max_cycles = s->max_cycles;
+        for (int b = 0; b < IRQ_HIST_BUCKETS; b++) out->hist[b] += s->hist[b];
+    }
+    return 0;
+}
+
+int irqchip_current(void) {
+    return irqchip;
+}
+
+void irq_cycle_stats_reset(void) {
+    uint32_t flags = irq_save();
+    for (int c = 0; c < 2; c++) {
+        irq_cycles[c].count = 0;
+        irq_cycles[c].total_cycles = 0;
+        irq_cycles[c].min_cycles = 0;
+        irq_cycles[c].max_cycles = 0;
+    }
+    irq_restore(flags);
+}
+
+void irq_cycle_stats_get(int chip, irq_cycle_stats_t* out) {
+    uint32_t flags = irq_save();
+    *out = irq_cycles[chip == IRQCHIP_APIC ? IRQCHIP_APIC : IRQCHIP_PIC];
+    irq_restore(flags);
+}
+
+static void irq_cycle_account(uint64_t cycles) {
+    irq_cycle_stats_t* s = &irq_cycles[irqchip];
+    uint32_t c = (cycles > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)cycles;
+    if (s->count == 0 || c < s->min_cycles) s->min_cycles = c;
+    s->count++;
+    s->total_cycles += c;
+    if (c > s->max_cycles) s->max_cycles = c;
+}
+
+// Mask or unmask a line for deferral without touching its registration.
+static void irq_set_deferred(int irq, int deferred) {
+    spin_lock(&irq_lock);
+    if (deferred) {
+        irq_deferred_mask |= (uint16_t)(1u << irq);
+    } else {
+        irq_deferred_mask &= (uint16_t)~(1u << irq);
+    }
+    irqchip_apply_masks();
+    spin_unlock(&irq_lock);
+}
+
+// Run a line's handler until it stops being re-triggered. Lines ranked
+// below the tick run with interrupts enabled; anything that fires meanwhile
+// at the same or lower rank is deferred back to us. Interrupts are off on
+// entry and on return.
+static void irq_run_line(int cpu, int irq) {
+    irq_desc_t* d = &irq_descs[irq];
+    uint8_t saved_prio = irq_cur_prio[cpu];
+    irq_cur_prio[cpu] = d->prio;
+    d->running = 1;
+    do {
+        if (d->pending) {
+            d->pending = 0;
+            irq_set_deferred(irq, 0);
+        }
+        if (d->prio > IRQ_PRIO_TICK) irq_enable();
+        if (d->fn) d->fn(d->ctx);
+        if (d->prio > IRQ_PRIO_TICK) irq_disable();
+    } while (d->pending);
+    d->running = 0;
+    irq_cur_prio[cpu] = saved_prio;
+}
+
+// Dispatch a device IRQ, or defer it if this CPU is already running that
+// line or one that outranks it. After the handler, run whatever was
+// deferred and now outranks the interrupted context.
+static void irq_dispatch(int cpu, int irq) {
+    irq_desc_t* d = &irq_descs[irq];
+    if (d->running || d->prio >= irq_cur_prio[cpu]) {
+        // Masked until it runs, so a level-triggered line cannot storm.
+        d->pending = 1;
+        irq_deferred_count++;
+        irq_set_deferred(irq, 1);
+        return;
+    }
+
+    irq_run_line(cpu, irq);
+
+    for (;;) {
+        int best = -1;
+        for (int i = 0; i < IRQ_LINES; i++) {
+            irq_desc_t* p = &irq_descs[i];
+            if (!p->pending || p->running || p->prio >= irq_cur_prio[cpu]) continue;
+            if (best < 0 || p->prio < irq_descs[best].prio) best = i;
+        }
+        if (best < 0) break;
+        irq_run_line(cpu, best);
+    }
+}
+
+void irq_nesting_stats(uint32_t* max_depth, uint32_t* deferred) {
+    *max_depth = irq_max_depth;
+    *deferred = irq_deferred_count;
+}
+
+// Acknowledge an interrupt at the controller that delivered it. Slave PIC
+// (vectors 40-47) must be acknowledged first; the software yield vector needs
+// no EOI at all.
+static inline void irq_eoi(uint32_t vector) {
+    if (vector >= LAPIC_TIMER_VECTOR) {
+        lapic_eoi();
+    } else if (vector >= 32 && vector <= 47) {
+        if (irqchip == IRQCHIP_APIC) {
+            lapic_eoi();
+            return;
+        }
+        if (vector >= 40) {
+            outb(0xA0, 0x20);
+        }
+        outb(0x20, 0x20);
+    }
 }
 
 // Initialize Interrupt Descriptor Table
@@ -108,58 +449,130 @@ void init_idt(void) {
         idt_set_gate(i, 0, 0x08, 0x8E);
     }
 
-    // Set up CPU exception handlers (0-31)
-    extern void isr0(), isr1(), isr2(), isr3(), isr13();
-    idt_set_gate(0, (uint32_t)isr0, 0x08, 0x8E);   // Divide Error
-    idt_set_gate(1, (uint32_t)isr1, 0x08, 0x8E);   // Debug
-    idt_set_gate(2, (uint32_t)isr2, 0x08, 0x8E);   // NMI
-    idt_set_gate(3, (uint32_t)isr3, 0x08, 0x8E);   // Breakpoint
-    idt_set_gate(13, (uint32_t)isr13, 0x08, 0x8E); // General Protection Fault
+    // Set up CPU exception handlers (0-31). Every vector gets its stub so
+    // anything ring 3 can raise (#BR, #SS, #MF with CR0.NE, #AC, #XM with
+    // CR4.OSXMMEXCPT, ...) reaches isr_handler; 7 is the lazy FPU switch.
+    extern void isr0(), isr1(), isr2(), isr3(), isr4(), isr5(), isr6(), isr7();
+    extern void isr8(), isr9(), isr10(), isr11(), isr12(), isr13(), isr14(), isr15();
+    extern void isr16(), isr17(), isr18(), isr19(), isr20(), isr21(), isr22(), isr23();
+    extern void isr24(), isr25(), isr26(), isr27(), isr28(), isr29(), isr30(), isr31();
+    static void (* const isr_stubs[32])() = {
+        isr0, isr1, isr2, isr3, isr4, isr5, isr6, isr7,
+        isr8, isr9, isr10, isr11, isr12, isr13, isr14, isr15,
+        isr16, isr17, isr18, isr19, isr20, isr21, isr22, isr23,
+        isr24, isr25, isr26, isr27, isr28, isr29, isr30, isr31,
+    };
+    for (int vector = 0; vector < 32; vector++) {
+        idt_set_gate((uint8_t)vector, (uint32_t)isr_stubs[vector], 0x08, 0x8E);
+    }
     
-    // Set up hardware interrupt handlers (32-47)
-    extern void irq0(), irq1();
-    idt_set_gate(32, (uint32_t)irq0, 0x08, 0x8E);  // Timer (IRQ0)
-    idt_set_gate(33, (uint32_t)irq1, 0x08, 0x8E);  // Keyboard (IRQ1)
+    // Set up hardware interrupt handlers (32-47); lines stay masked until a
+    // driver calls irq_register()
+    extern void irq0(), irq1(), irq2(), irq3(), irq4(), irq5(), irq6(), irq7();
+    extern void irq8(), irq9(), irq10(), irq11(), irq12(), irq13(), irq14(), irq15();
+    static void (* const irq_stubs[IRQ_LINES])() = {
+        irq0, irq1, irq2, irq3, irq4, irq5, irq6, irq7,
+        irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15,
+    };
+    for (int irq = 0; irq < IRQ_LINES; irq++) {
+        idt_set_gate((uint8_t)(32 + irq), (uint32_t)irq_stubs[irq], 0x08, 0x8E);
+    }
     
-    // Set up system call interrupt (0x80 = 128)
+    // Set up system call interrupt (0x80 = 128): DPL 3 trap gate, so ring 3
+    // may raise it and it runs with interrupts enabled
     extern void isr128();
-    idt_set_gate(128, (uint32_t)isr128, 0x08, 0x8E);  
+    idt_set_gate(128, (uint32_t)isr128, 0x08, 0xEF);
+
+    // Scheduler yield (0x81), routed through the IRQ stub so it can switch stacks
+    extern void isr129();
+    idt_set_gate(SCHED_YIELD_VECTOR, (uint32_t)isr129, 0x08, 0x8E);
+
+    // Local APIC vectors: AP tick, reschedule IPI, spurious
+    extern void isr240(), isr241(), isr255();
+    idt_set_gate(LAPIC_TIMER_VECTOR, (uint32_t)isr240, 0x08, 0x8E);
+    idt_set_gate(RESCHED_IPI_VECTOR, (uint32_t)isr241, 0x08, 0x8E);
+    idt_set_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t)isr255, 0x08, 0x8E);
     
     // Load IDT into CPU
     idt_load();
 
-    // Initialize PIC controller
+    // Initialize PIC controller (all lines masked)
+    spin_lock_init(&irq_lock, "irq");
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        irq_depth[cpu] = 0;
+        irq_cur_prio[cpu] = IRQ_PRIO_NONE;
+    }
     init_pic();
     
     // Enable interrupts (STI instruction)
-    asm volatile("sti");
+    irq_enable();
 }
 
 // Hardware Interrupt Handler (Interrupts 32-47)
 registers_t* irq_handler(registers_t *regs) {
     registers_t* original_regs = regs;
-    // Send EOI to PIC(s). Slave PIC (vectors 40-47) must be acknowledged first.
-    if (regs->int_no >= 40 && regs->int_no <= 47) {
-        outb(0xA0, 0x20);
+    uint32_t vector = regs->int_no;
+    uint64_t entry_cycles = clock_cycles();
+    int cpu = smp_cpu_id();
+    int is_tick = (vector == 32 || vector == LAPIC_TIMER_VECTOR);
+    int irqs_were_on = (regs->eflags & EFLAGS_IF) != 0;
+    if (irqs_were_on) trace_irqs_off();
+
+    // EOI first: the handler may run with interrupts enabled, and the
+    // controller must be free to deliver higher-priority lines meanwhile.
+    irq_eoi(vector);
+
+    int depth = ++irq_depth[cpu];
+    if ((uint32_t)depth > irq_max_depth) irq_max_depth = (uint32_t)depth;
+
+    // Device IRQs go to their registered handler; local vectors are fixed.
+    if (vector >= 32 && vector < 32 + IRQ_LINES) {
+        irq_dispatch(cpu, (int)vector - 32);
+        if (vector == 32) irq_cycle_account(clock_cycles() - entry_cycles);
+    } else if (vector == LAPIC_TIMER_VECTOR && cpu == 0) {
+        // On the BSP this is the tickless event device (PIT_EVENT_LAPIC);
+        // on APs only the scheduler tick below.
+        pit_on_tick();
     }
-    outb(0x20, 0x20);
+    int slot = irq_stat_slot(vector);
+    if (slot >= 0) irq_account(cpu, slot, clock_cycles() - entry_cycles);
+    irq_depth[cpu]--;
 
-    // Dispatch hardware IRQs by vector.
-    switch (regs->int_no) {
-        case 32: // IRQ0 - PIT timer
-            pit_on_tick();
+    // Bottom halves run after EOI with interrupts enabled. An IRQ nesting on
+    // top of a device handler or a softirq skips both softirqs and
+    // scheduling, so the outer invocation always finishes on the stack it
+    // started on; a tick skipped that way is replayed when the outer one
+    // exits. Device IRQs and softirqs stay on the BSP.
+    int may_schedule = 0;
+    if (depth == 1) {
+        may_schedule = (cpu == 0) ? softirq_run() : 1;
+    }
+    if (!may_schedule) {
+        if (is_tick) irq_tick_missed[cpu] = 1;
+    } else {
+        if (irq_tick_missed[cpu]) {
+            irq_tick_missed[cpu] = 0;
+            is_tick = 1;
+        }
+        if (vector == SCHED_YIELD_VECTOR) {
+            regs = sched_on_yield(regs);
+        } else if (is_tick || sched_need_resched()) {
             regs = sched_on_tick(regs);
-            break;
-        case 33: // IRQ1 - keyboard
-            handle_keyboard();
-            break;
-        default:
-            break;
+        }
+    }
+
+    // Re-arm the BSP's event device; APs ask for that with a resched IPI
+    // when they add an earlier timer.
+    if (cpu == 0 && (vector == 32 || vector == LAPIC_TIMER_VECTOR || vector == RESCHED_IPI_VECTOR)) {
+        timer_reprogram();
     }
 
     // Return 0 to indicate "no stack switch"; otherwise return a new regs pointer.
+    // iret restores IF from the frame; tell the tracer which state follows.
     if (regs == original_regs) {
+        if (irqs_were_on) trace_irqs_on();
         return 0;
     }
+    trace_irqs_switch((regs->eflags & EFLAGS_IF) != 0);
     return regs;
 }
\ No newline at end of file
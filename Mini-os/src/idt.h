@@ -3,6 +3,7 @@
 #define IDT_H
 
 #include <stdint.h>
+#include "sched/irqsoff.h"
 
 // Interrupt register structure - MUST MATCH ASSEMBLY STACK LAYOUT
 typedef struct {
@@ -29,6 +30,47 @@ typedef struct {
     uint32_t base;
 } __attribute__((packed)) idtr_t;
 
+// Software interrupt used by sched_yield(); handled by irq_handler
+#define SCHED_YIELD_VECTOR 0x81
+
+// Local APIC vectors (acknowledged with lapic_eoi, not the 8259)
+#define LAPIC_TIMER_VECTOR    0xF0
+#define RESCHED_IPI_VECTOR    0xF1
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// Interrupt controller that delivers device IRQs 0-15 (vectors 32-47)
+#define IRQCHIP_PIC  0   // legacy 8259 pair, EOI by port I/O
+#define IRQCHIP_APIC 1   // IO-APIC routed to the BSP's LAPIC, EOI by MMIO
+
+// IRQ0 cost in irq_handler, from entry through EOI and the tick handler
+// (softirqs and scheduling excluded), accumulated per controller.
+typedef struct {
+    uint32_t count;
+    uint64_t total_cycles;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+} irq_cycle_stats_t;
+
+// Device IRQ lines (8259 / ISA numbering), delivered on vectors 32-47
+#define IRQ_LINES 16
+
+// Counter slots: the 16 IRQ lines, then LAPIC timer, resched IPI and yield
+#define IRQ_STAT_SLOTS (IRQ_LINES + 3)
+
+// Handler cost histogram buckets in cycles: <1k, <4k, <16k, <64k, >=64k
+#define IRQ_HIST_BUCKETS 5
+
+typedef void (*irq_fn_t)(void* ctx);
+
+typedef struct {
+    const char* name;        // 0 for a line without a handler
+    int vector;
+    uint32_t count;
+    uint64_t total_cycles;   // entry through EOI and the handler
+    uint32_t max_cycles;
+    uint32_t hist[IRQ_HIST_BUCKETS];
+} irq_stats_t;
+
 // Function declarations
 void init_idt(void);                                // Initialize Interrupt Descriptor Table
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags); // Set IDT gate entry
@@ -36,4 +78,72 @@ void idt_load(void);                               // Load IDT register
 void isr_handler(registers_t *regs);               // CPU exception handler (interrupts 0-31)
 registers_t* irq_handler(registers_t *regs);       // Hardware interrupt handler (interrupts 32-47)
 
+// Switch device IRQ delivery between the 8259 and the IO-APIC. The APIC
+// path needs an IO-APIC and the BSP's LAPIC (after smp_init()). Returns 0 if
+// the controller is unavailable.
+int irqchip_select(int chip);
+int irqchip_current(void);
+int irqchip_available(int chip);
+
+// Attach a handler to a device IRQ line (0-15, not the cascade line 2) and
+// unmask it on the active controller. The handler runs in hard-IRQ context
+// after EOI. Lines rank in 8259 order (IRQ0 highest); every line below IRQ0
+// runs its handler with interrupts enabled and may be preempted by higher
+// ones, so it must take locks with spin_lock_irqsave(). A line that fires
+// while it is running or outranked is masked and replayed later, never
+// re-entered. Re-registering the same handler is a no-op; returns -1 if the
+// line is invalid or taken.
+int irq_register(int irq, irq_fn_t handler, void* ctx, const char* name);
+void irq_unregister(int irq);
+
+// Counters for one slot, summed over CPUs. Returns -1 past the last slot.
+int irq_stats_get(int slot, irq_stats_t* out);
+
+// Deepest irq_handler nesting seen on any CPU, and IRQs deferred because
+// their line was running or outranked.
+void irq_nesting_stats(uint32_t* max_depth, uint32_t* deferred);
+
+void irq_cycle_stats_reset(void);
+void irq_cycle_stats_get(int chip, irq_cycle_stats_t* out);
+
+#define EFLAGS_IF 0x200u
+
+// irq_save()/irq_restore() without the irqs-off tracer hooks (for the
+// tracer itself and for wrappers that report their own caller).
+static inline uint32_t irq_save_notrace(void) {
+    uint32_t flags;
+    __asm__ __volatile__("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore_notrace(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ __volatile__("sti" : : : "memory");
+    }
+}
+
+// Disable interrupts, returning the previous EFLAGS for irq_restore()
+static inline uint32_t irq_save(void) {
+    uint32_t flags = irq_save_notrace();
+    if (flags & EFLAGS_IF) trace_irqs_off();
+    return flags;
+}
+
+// Re-enable interrupts only if they were enabled at the matching irq_save()
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) trace_irqs_on();
+    irq_restore_notrace(flags);
+}
+
+// Unconditional cli/sti, reported to the irqs-off tracer
+static inline void irq_disable(void) {
+    __asm__ __volatile__("cli" : : : "memory");
+    trace_irqs_off();
+}
+
+static inline void irq_enable(void) {
+    trace_irqs_on();
+    __asm__ __volatile__("sti" : : : "memory");
+}
+
 #endif
\ No newline at end of file
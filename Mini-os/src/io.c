@@ -14,8 +14,60 @@ uint8_t inb(uint16_t port) {
     return ret;
 }
 
+void outw(uint16_t port, uint16_t value) {
+    __asm__ __volatile__("outw %0, %1" : : "a"(value), "Nd"(port));
+}
+
+uint16_t inw(uint16_t port) {
+    uint16_t ret;
+    __asm__ __volatile__("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+// String I/O: one instruction moves the whole buffer (e.g. an ATA sector)
+void insw(uint16_t port, void* buf, uint32_t count) {
+    __asm__ __volatile__("cld; rep insw" : "+D"(buf), "+c"(count) : "d"(port) : "memory");
+}
+
+void outsw(uint16_t port, const void* buf, uint32_t count) {
+    __asm__ __volatile__("cld; rep outsw" : "+S"(buf), "+c"(count) : "d"(port) : "memory");
+}
+
 // Create small I/O delay by writing to unused port 0x80
 // Used for timing-sensitive hardware operations
 void io_wait(void) {
     outb(0x80, 0);  // Write to unused port to create a small delay
-}
\ No newline at end of file
+}
+
+// Execute CPUID if the CPU supports it
+// CPUID is present if EFLAGS.ID (bit 21) can be toggled
+int cpu_cpuid(uint32_t leaf, uint32_t out[4]) {
+    uint32_t before, after;
+    __asm__ __volatile__(
+        "pushfl\n\t"
+        "popl %0\n\t"
+        "movl %0, %1\n\t"
+        "xorl $0x200000, %1\n\t"
+        "pushl %1\n\t"
+        "popfl\n\t"
+        "pushfl\n\t"
+        "popl %1\n\t"
+        "pushl %0\n\t"
+        "popfl"
+        : "=&r"(before), "=&r"(after));
+    if (((before ^ after) & 0x200000u) == 0) {
+        out[0] = out[1] = out[2] = out[3] = 0;
+        return 0;
+    }
+
+    __asm__ __volatile__("cpuid"
+                         : "=a"(out[0]), "=b"(out[1]), "=c"(out[2]), "=d"(out[3])
+                         : "a"(leaf), "c"(0));
+    return 1;
+}
+
+// Write a model-specific register: EDX:EAX -> MSR[ECX]
+void cpu_wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ __volatile__("wrmsr"
+                         : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
@@ -9,7 +9,22 @@ void outb(uint16_t port, uint8_t value);
 // Input byte from specified I/O port
 uint8_t inb(uint16_t port);
 
+// Output/input a 16-bit word
+void outw(uint16_t port, uint16_t value);
+uint16_t inw(uint16_t port);
+
+// Move count 16-bit words between memory and one port (rep insw/outsw)
+void insw(uint16_t port, void* buf, uint32_t count);
+void outsw(uint16_t port, const void* buf, uint32_t count);
+
 // Create small delay using I/O wait (writes to unused port 0x80)
 void io_wait(void);
 
+// Execute CPUID for the given leaf into out[] = {eax, ebx, ecx, edx}.
+// Returns 0 (and zeroes out[]) if the CPU has no CPUID instruction.
+int cpu_cpuid(uint32_t leaf, uint32_t out[4]);
+
+// Write a model-specific register (ring 0 only)
+void cpu_wrmsr(uint32_t msr, uint64_t value);
+
 #endif
\ No newline at end of file
@@ -56,12 +56,42 @@ ISR_NOERRCODE 30  ; Security exception
 ISR_NOERRCODE 31  ; Reserved
 
 ; System Call Interrupt (0x80 = 128)
+; Trap gate callable from ring 3: interrupts stay enabled while it runs
 global isr128
 isr128:
+    push byte 0             ; Push dummy error code
+    push dword 128          ; Push interrupt number (dword: 128 does not fit a signed byte)
+    jmp syscall_common_stub ; Jump to system call handler
+
+; Scheduler yield (0x81 = 129)
+; Goes through irq_common_stub so irq_handler can return another task's stack
+global isr129
+isr129:
     cli                     ; Disable interrupts
     push byte 0             ; Push dummy error code
-    push byte 128           ; Push interrupt number (128 = 0x80)
-    jmp isr_common_stub     ; Jump to common handler
+    push dword 129          ; Push interrupt number (dword: 129 does not fit a signed byte)
+    jmp irq_common_stub     ; Jump to common handler
+
+; Local APIC timer (0xF0 = 240), the periodic tick on application processors
+global isr240
+isr240:
+    cli                     ; Disable interrupts
+    push byte 0             ; Push dummy error code
+    push dword 240          ; Push interrupt number
+    jmp irq_common_stub     ; Jump to common handler
+
+; Reschedule IPI (0xF1 = 241), sent by sched_wake() to another CPU
+global isr241
+isr241:
+    cli                     ; Disable interrupts
+    push byte 0             ; Push dummy error code
+    push dword 241          ; Push interrupt number
+    jmp irq_common_stub     ; Jump to common handler
+
+; Local APIC spurious interrupt (0xFF = 255): must not be acknowledged
+global isr255
+isr255:
+    iret
 
 ; Macro for Hardware Interrupts (IRQs)
 ; Maps IRQ numbers to interrupt vectors 32-47
@@ -172,13 +202,14 @@ irq_common_stub:
     test eax, eax
     jz .no_switch
     mov esp, eax
-.no_switch:
 
-    ; Clean up stack pointer parameter (only needed if we stayed on same stack)
-    ; When switching stacks, the new stack does not include the argument.
-    ; So only pop argument when no switch occurred.
-    cmp eax, 0
-    jne .arg_done
+    ; Off the previous task's stack now: let other CPUs run it.
+    ; The new stack does not include the argument, so nothing to pop.
+    extern sched_finish_switch
+    call sched_finish_switch
+    jmp .arg_done
+.no_switch:
+    ; Clean up stack pointer parameter (we stayed on the same stack)
     add esp, 4
 .arg_done:
     
@@ -196,4 +227,83 @@ irq_common_stub:
     
     ; Re-enable interrupts and return from interrupt
     sti
-    iret
\ No newline at end of file
+    iret
+
+; External C function for system calls (int 0x80 and SYSENTER)
+extern syscall_handler
+
+; Common stub for int 0x80
+; Same frame as isr_common_stub; the handler returns its result in regs->eax
+syscall_common_stub:
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    push esp
+    call syscall_handler
+    add esp, 4
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popa
+    add esp, 8
+    iret
+
+; SYSENTER entry (IA32_SYSENTER_EIP). Ring 3 callers pass the system call
+; number in EAX, arguments in EBX, ESI, EDI, their stack pointer in ECX and
+; the return address in EDX; ECX and EDX are clobbered. The CPU arrives here
+; with CS=0x08, SS=0x10, interrupts disabled and ESP = IA32_SYSENTER_ESP,
+; which points at this CPU's TSS, so the task's kernel stack is tss.esp0.
+; The stub builds the same registers_t frame as int 0x80, with the
+; arguments moved into EBX, ECX, EDX, so syscall_handler serves both.
+global sysenter_entry
+sysenter_entry:
+    mov esp, [esp + 4]      ; tss.esp0
+    push dword 0x23         ; ss (user data)
+    push ecx                ; useresp
+    push dword 0x202        ; eflags (ring 3 always runs with IF set)
+    push dword 0x1B         ; cs (user code)
+    push edx                ; eip
+    push byte 0             ; Push dummy error code
+    push dword 128          ; Same vector number as int 0x80
+    mov ecx, esi            ; Second and third arguments where int 0x80 has them
+    mov edx, edi
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    sti                     ; Handler runs preemptible, as with int 0x80
+    push esp
+    call syscall_handler
+    add esp, 4
+    cli
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popa
+    add esp, 8
+
+    mov edx, [esp]          ; return address
+    mov ecx, [esp + 12]     ; user stack pointer
+    sti                     ; Takes effect after SYSEXIT: no interrupt in between
+    sysexit
@@ -0,0 +1,164 @@
+#include "acpi.h"
+
+// MADT entry types
+#define MADT_LAPIC          0
+#define MADT_IOAPIC         1
+#define MADT_ISO            2
+
+// MP configuration table entry types and sizes
+#define MP_ENTRY_CPU        0
+#define MP_ENTRY_IOAPIC     2
+#define MP_CPU_ENTRY_SIZE   20
+#define MP_OTHER_ENTRY_SIZE 8
+
+#define BDA_EBDA_SEGMENT    0x40E
+
+static acpi_platform_t platform;
+
+static int mem_eq(const void* a, const char* sig, int n) {
+    const uint8_t* p = (const uint8_t*)a;
+    for (int i = 0; i < n; i++) {
+        if (p[i] != (uint8_t)sig[i]) return 0;
+    }
+    return 1;
+}
+
+static int checksum_ok(const void* p, uint32_t len) {
+    const uint8_t* b = (const uint8_t*)p;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) sum = (uint8_t)(sum + b[i]);
+    return sum == 0;
+}
+
+static inline uint16_t rd16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t rd32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Scan [start, start+len) on 16-byte boundaries for a signature whose
+// structure of check_len bytes checksums to zero.
+static const uint8_t* scan(uint32_t start, uint32_t len, const char* sig, int sig_len, uint32_t check_len) {
+    for (uint32_t addr = start; addr + check_len <= start + len; addr += 16) {
+        const uint8_t* p = (const uint8_t*)addr;
+        if (mem_eq(p, sig, sig_len) && checksum_ok(p, check_len)) return p;
+    }
+    return 0;
+}
+
+static const uint8_t* find_in_bios_areas(const char* sig, int sig_len, uint32_t check_len) {
+    // Hide the constant from GCC, which treats page-zero pointers as null.
+    const volatile uint16_t* bda = (const volatile uint16_t*)BDA_EBDA_SEGMENT;
+    __asm__("" : "+r"(bda));
+    uint32_t ebda = (uint32_t)(*bda) << 4;
+    const uint8_t* p = 0;
+    if (ebda >= 0x80000u && ebda < 0xA0000u) p = scan(ebda, 1024, sig, sig_len, check_len);
+    if (!p) p = scan(0x9FC00u, 1024, sig, sig_len, check_len);
+    if (!p) p = scan(0xE0000u, 0x20000u, sig, sig_len, check_len);
+    return p;
+}
+
+static void add_cpu(uint8_t apic_id) {
+    if (platform.cpu_count < ACPI_MAX_CPUS) {
+        platform.cpu_apic_ids[platform.cpu_count++] = apic_id;
+    }
+}
+
+static void parse_madt(const uint8_t* madt) {
+    uint32_t len = rd32(madt + 4);
+    platform.lapic_base = rd32(madt + 36);
+
+    for (uint32_t off = 44; off + 2 <= len;) {
+        const uint8_t* e = madt + off;
+        uint8_t type = e[0];
+        uint8_t elen = e[1];
+        if (elen < 2) break;
+
+        if (type == MADT_LAPIC && elen >= 8) {
+            if (rd32(e + 4) & 1u) add_cpu(e[3]);
+        } else if (type == MADT_IOAPIC && elen >= 12 && platform.ioapic_base == 0) {
+            platform.ioapic_id = e[2];
+            platform.ioapic_base = rd32(e + 4);
+            platform.ioapic_gsi_base = rd32(e + 8);
+        } else if (type == MADT_ISO && elen >= 10) {
+            uint8_t irq = e[3];
+            if (irq < ACPI_ISA_IRQS) {
+                platform.isa_gsi[irq] = rd32(e + 4);
+                platform.isa_flags[irq] = rd16(e + 8);
+            }
+        }
+        off += elen;
+    }
+}
+
+static int parse_acpi(void) {
+    const uint8_t* rsdp = find_in_bios_areas("RSD PTR ", 8, 20);
+    if (!rsdp) return 0;
+
+    const uint8_t* rsdt = (const uint8_t*)rd32(rsdp + 16);
+    if (!rsdt || !mem_eq(rsdt, "RSDT", 4) || !checksum_ok(rsdt, rd32(rsdt + 4))) return 0;
+
+    uint32_t entries = (rd32(rsdt + 4) - 36) / 4;
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t* sdt = (const uint8_t*)rd32(rsdt + 36 + i * 4);
+        if (sdt && mem_eq(sdt, "APIC", 4) && checksum_ok(sdt, rd32(sdt + 4))) {
+            parse_madt(sdt);
+            return platform.cpu_count > 0;
+        }
+    }
+    return 0;
+}
+
+static int parse_mp(void) {
+    const uint8_t* fps = find_in_bios_areas("_MP_", 4, 16);
+    if (!fps) return 0;
+
+    const uint8_t* cfg = (const uint8_t*)rd32(fps + 4);
+    if (!cfg || !mem_eq(cfg, "PCMP", 4) || !checksum_ok(cfg, rd16(cfg + 4))) return 0;
+
+    platform.lapic_base = rd32(cfg + 36);
+    uint16_t count = rd16(cfg + 34);
+    const uint8_t* e = cfg + 44;
+    for (uint16_t i = 0; i < count; i++) {
+        if (e[0] == MP_ENTRY_CPU) {
+            if (e[3] & 1u) add_cpu(e[1]);
+            e += MP_CPU_ENTRY_SIZE;
+        } else {
+            if (e[0] == MP_ENTRY_IOAPIC && platform.ioapic_base == 0 && (e[3] & 1u)) {
+                platform.ioapic_id = e[1];
+                platform.ioapic_base = rd32(e + 4);
+            }
+            e += MP_OTHER_ENTRY_SIZE;
+        }
+    }
+    return platform.cpu_count > 0;
+}
+
+int acpi_init(void) {
+    platform.source = 0;
+    platform.lapic_base = 0;
+    platform.cpu_count = 0;
+    platform.ioapic_base = 0;
+    platform.ioapic_id = 0;
+    platform.ioapic_gsi_base = 0;
+    for (int i = 0; i < ACPI_ISA_IRQS; i++) {
+        platform.isa_gsi[i] = (uint32_t)i;  // identity unless overridden
+        platform.isa_flags[i] = 0;
+    }
+
+    if (parse_acpi()) {
+        platform.source = 1;
+    } else {
+        platform.cpu_count = 0;
+        platform.ioapic_base = 0;
+        if (parse_mp()) platform.source = 2;
+    }
+    if (!platform.source) platform.cpu_count = 0;
+    return platform.source != 0;
+}
+
+const acpi_platform_t* acpi_platform(void) {
+    return &platform;
+}
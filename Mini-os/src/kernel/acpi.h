@@ -0,0 +1,34 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+// Platform interrupt topology from the ACPI MADT, or the Intel MP
+// configuration table when there is no ACPI. Tables are read through the
+// physical identity mapping, so call acpi_init() before paging_init().
+
+#define ACPI_MAX_CPUS 8
+#define ACPI_ISA_IRQS 16
+
+typedef struct {
+    int source;                          // 0 none, 1 ACPI MADT, 2 MP table
+    uint32_t lapic_base;
+    int cpu_count;
+    uint8_t cpu_apic_ids[ACPI_MAX_CPUS]; // enabled processors, firmware order
+
+    // First IO-APIC (0 if none reported)
+    uint32_t ioapic_base;
+    uint8_t ioapic_id;
+    uint32_t ioapic_gsi_base;
+
+    // ISA IRQ -> global system interrupt, with MPS INTI polarity/trigger flags
+    uint32_t isa_gsi[ACPI_ISA_IRQS];
+    uint16_t isa_flags[ACPI_ISA_IRQS];
+} acpi_platform_t;
+
+// Parse the firmware tables. Returns 1 if a LAPIC-capable platform was found.
+int acpi_init(void);
+
+const acpi_platform_t* acpi_platform(void);
+
+#endif
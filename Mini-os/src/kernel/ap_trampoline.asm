@@ -0,0 +1,78 @@
+; Application processor startup trampoline
+; smp.c copies this blob to AP_TRAMPOLINE_ADDR (page 0x8000, SIPI vector 0x08)
+; and patches ap_tramp_cr3/stack/entry before each STARTUP IPI. The code runs
+; at the copy's address, so absolute references go through TRAMP().
+
+AP_TRAMPOLINE_ADDR equ 0x8000
+%define TRAMP(label) (AP_TRAMPOLINE_ADDR + ((label) - ap_trampoline_start))
+
+section .text
+
+global ap_trampoline_start
+global ap_trampoline_end
+global ap_tramp_cr3
+global ap_tramp_stack
+global ap_tramp_entry
+
+[BITS 16]
+ap_trampoline_start:
+    cli                     ; Disable interrupts
+    cld
+    xor ax, ax              ; Real-mode data segment 0 (CS is 0x0800)
+    mov ds, ax
+
+    ; Load the trampoline GDT (same flat layout as the bootloader's)
+    lgdt [TRAMP(ap_gdt_descriptor)]
+
+    ; Switch to protected mode by setting CR0 bit 0
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    ; Far jump to flush pipeline and load CS with code segment
+    jmp dword 0x08:TRAMP(ap_pm)
+
+[BITS 32]
+ap_pm:
+    ; Initialize all segment registers to data segment
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; Enable paging with the kernel page directory
+    mov eax, [TRAMP(ap_tramp_cr3)]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000
+    mov cr0, eax
+
+    ; Switch to this CPU's boot stack and enter C (never returns)
+    mov esp, [TRAMP(ap_tramp_stack)]
+    mov eax, [TRAMP(ap_tramp_entry)]
+    call eax
+
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; === Trampoline Global Descriptor Table ===
+align 8
+ap_gdt:
+    dq 0                    ; Null descriptor
+    dq 0x00CF9A000000FFFF   ; 0x08: ring 0 code, flat 4GiB
+    dq 0x00CF92000000FFFF   ; 0x10: ring 0 data, flat 4GiB
+ap_gdt_descriptor:
+    dw 3 * 8 - 1            ; GDT limit (size-1)
+    dd TRAMP(ap_gdt)        ; GDT base address
+
+; === Parameters patched by smp.c ===
+align 4
+ap_tramp_cr3:   dd 0        ; kernel page directory (physical)
+ap_tramp_stack: dd 0        ; initial ESP for the AP
+ap_tramp_entry: dd 0        ; C entry point, void (*)(void)
+
+ap_trampoline_end:
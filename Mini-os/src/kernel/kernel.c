@@ -1,22 +1,47 @@
 #include "../graphic/vbe.h"
+#include "../graphic/console.h"
 #include "../idt.h"
+#include "../gdt.h"
+#include "../syscall/syscall.h"
+#include "../syscall/uring.h"
 #include "../drivers/keyboard.h"
 #include "../drivers/pit.h"
+#include "../drivers/clock.h"
 #include "../sched/sched.h"
+#include "../sched/timer.h"
+#include "../sched/softirq.h"
+#include "../sched/workqueue.h"
+#include "../sched/fpu.h"
 #include "../mem/pmm.h"
 #include "../mem/paging.h"
 #include "../mem/kheap.h"
+#include "../fs/filesystem.h"
+#include "../fs/initrd.h"
+#include "../syscall/systrace.h"
+#include "../fs/bcache.h"
+#include "../drivers/ata.h"
+#include "acpi.h"
+#include "smp.h"
+#include "usermode.h"
+#include "vdso.h"
 #include "../boot_menu.h"
 
-// Exposed for on-screen demo overlay (see `src/sched/sched.c`)
+// Heap smoke-test result (reported by the `top` shell command)
 int g_heap_ok = 0;
 
 void kernel_main(void) {
     // Clear screen immediately
     vbe_clear_screen(vbe_rgb(0, 0, 0));
     
+    // Kernel GDT with ring 3 segments and per-CPU TSSs, SYSENTER entry
+    gdt_init();
+    syscall_init_cpu(0);
+
     // Initialize IDT and interrupts
     init_idt();
+
+    // Bottom-half layer (must exist before drivers register softirqs)
+    softirq_init();
     
     // Initialize keyboard driver
     init_keyboard();
@@ -24,17 +49,48 @@ void kernel_main(void) {
     // Initialize PIT timer (drives IRQ0 ticks)
     pit_init(100);
 
+    // Calibrate TSC against the PIT (ns clock, udelay/ndelay)
+    clock_init();
+
+    // Publish the clock on the shared data page for zero-syscall time reads
+    vdso_init();
+
+    // Timer wheel for kernel timeouts (driven from IRQ0)
+    timer_init();
+
+    // Buffered text console: from here on partial lines flush on a timer
+    console_init();
+
+    // Switch IRQ0 to one-shot: fire only for slice expiry and deadlines
+    pit_set_tickless(1);
+
+    // Enable FPU/SSE with lazy per-task save/restore (#NM on first use)
+    fpu_init();
+
     // Initialize scheduler (preemptive RR via IRQ0)
     sched_init();
 
+    // Kernel worker thread for deferred work that needs task context
+    workqueue_init();
+
+    // System call accounting, then the kernel thread that runs batched
+    // system calls from submission rings
+    systrace_init();
+    uring_init();
+
     // Initialize physical memory manager (assume 64MiB for now)
     pmm_init(64u * 1024u * 1024u);
 
+    // Find CPUs and interrupt controllers (MADT or MP table; reads
+    // firmware memory directly, so before paging)
+    acpi_init();
+
     // Enable paging (kernel-only, identity + framebuffer mapping)
-    asm volatile("cli");
+    irq_disable();
     paging_init();
     kheap_init();
-    asm volatile("sti");
+    user_init();
+    irq_enable();
 
     // Quick heap smoke-test (paging+PMM+kheap path)
     void* a = kmalloc(256);
@@ -42,6 +98,23 @@ void kernel_main(void) {
     g_heap_ok = (a && b) ? 1 : 0;
     kfree(b);
     kfree(a);
+
+    // Start the application processors (needs paging for the LAPIC window)
+    smp_init();
+
+    // Deliver device IRQs through the IO-APIC (MMIO EOI) and take tickless
+    // events from the BSP's LAPIC timer. Each falls back to the 8259 / PIT.
+    irqchip_select(IRQCHIP_APIC);
+    pit_set_event_source(PIT_EVENT_LAPIC);
+
+    // In-memory filesystem (file table and its lock), seeded from the
+    // initrd linked into the kernel image
+    fs_init();
+    initrd_init();
+
+    // ATA disks (polled PIO) and the block cache in front of them
+    ata_init();
+    bcache_init();
     
     // Main kernel loop - always returns to boot menu
     while(1) {
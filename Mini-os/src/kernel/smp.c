@@ -0,0 +1,131 @@
+#include "smp.h"
+#include "../idt.h"
+#include "../gdt.h"
+#include "../syscall/syscall.h"
+#include "../drivers/lapic.h"
+#include "../drivers/clock.h"
+#include "../sched/sched.h"
+#include "../sched/fpu.h"
+
+// APs start in real mode at a 4 KiB page below 1 MiB given by the SIPI
+// vector. The trampoline (ap_trampoline.asm) enters protected mode with
+// paging on and calls ap_main() on a per-CPU boot stack, which becomes that
+// CPU's idle task.
+
+#define AP_TRAMPOLINE_ADDR 0x8000u
+#define AP_STACK_DWORDS    2048     // 8 KiB boot/idle stack per AP
+#define AP_START_TIMEOUT_US 100000u
+
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+extern uint8_t ap_tramp_cr3[];
+extern uint8_t ap_tramp_stack[];
+extern uint8_t ap_tramp_entry[];
+
+static uint32_t ap_stacks[MAX_CPUS][AP_STACK_DWORDS];
+static uint8_t cpu_apic_id[MAX_CPUS];
+static uint8_t apic_to_cpu[256];
+static volatile uint8_t cpu_online[MAX_CPUS] = {1};
+static volatile int cpus_online = 1;
+static volatile int ap_booting_cpu = -1;
+static volatile int ap_started = 0;
+
+static void set_tramp_param(uint8_t* sym, uint32_t value) {
+    uint32_t offset = (uint32_t)(sym - ap_trampoline_start);
+    *(volatile uint32_t*)(AP_TRAMPOLINE_ADDR + offset) = value;
+}
+
+__attribute__((noreturn)) static void ap_main(void) {
+    int cpu = ap_booting_cpu;
+
+    gdt_init_ap(cpu);
+    syscall_init_cpu(cpu);
+    idt_load();
+    lapic_enable_ap();
+    fpu_init_ap();
+    sched_start_ap(cpu);
+
+    __asm__ __volatile__("" ::: "memory");
+    cpu_online[cpu] = 1;
+    cpus_online++;
+    ap_started = 1;
+
+    lapic_timer_start_periodic(SMP_AP_TICK_HZ);
+    for (;;) {
+        __asm__ __volatile__("sti; hlt");
+    }
+}
+
+static int boot_ap(int cpu) {
+    uint32_t cr3;
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    set_tramp_param(ap_tramp_cr3, cr3);
+    set_tramp_param(ap_tramp_stack, (uint32_t)(uintptr_t)&ap_stacks[cpu][AP_STACK_DWORDS]);
+    set_tramp_param(ap_tramp_entry, (uint32_t)(uintptr_t)ap_main);
+
+    ap_booting_cpu = cpu;
+    ap_started = 0;
+    uint8_t apic = cpu_apic_id[cpu];
+    uint32_t sipi = LAPIC_ICR_STARTUP | (AP_TRAMPOLINE_ADDR >> 12);
+
+    // INIT, wait 10ms, then up to two STARTUP IPIs (Intel MP spec B.4).
+    lapic_send_ipi(apic, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT | LAPIC_ICR_LEVEL);
+    udelay(10000);
+    lapic_send_ipi(apic, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+    for (int attempt = 0; attempt < 2 && !ap_started; attempt++) {
+        lapic_send_ipi(apic, sipi);
+        udelay(200);
+    }
+
+    for (uint32_t waited = 0; !ap_started && waited < AP_START_TIMEOUT_US; waited += 100) {
+        udelay(100);
+    }
+    return ap_started;
+}
+
+void smp_init(void) {
+    const acpi_platform_t* p = acpi_platform();
+    if (!p->source || !p->lapic_base) return;
+
+    lapic_init(p->lapic_base);
+    lapic_timer_calibrate();
+
+    uint8_t bsp = lapic_id();
+    for (int i = 0; i < 256; i++) apic_to_cpu[i] = 0;
+    cpu_apic_id[0] = bsp;
+
+    // Number APs after the BSP in firmware order.
+    int ncpus = 1;
+    for (int i = 0; i < p->cpu_count && ncpus < MAX_CPUS; i++) {
+        if (p->cpu_apic_ids[i] == bsp) continue;
+        cpu_apic_id[ncpus] = p->cpu_apic_ids[i];
+        apic_to_cpu[p->cpu_apic_ids[i]] = (uint8_t)ncpus;
+        ncpus++;
+    }
+    if (ncpus == 1) return;
+
+    // Install the trampoline in reserved low memory.
+    uint32_t size = (uint32_t)(ap_trampoline_end - ap_trampoline_start);
+    uint8_t* dst = (uint8_t*)AP_TRAMPOLINE_ADDR;
+    for (uint32_t i = 0; i < size; i++) dst[i] = ap_trampoline_start[i];
+
+    // Bring the APs up one at a time; each waits on ap_booting_cpu.
+    for (int cpu = 1; cpu < ncpus; cpu++) {
+        boot_ap(cpu);
+    }
+    ap_booting_cpu = -1;
+}
+
+int smp_cpu_id(void) {
+    if (!lapic_is_enabled()) return 0;
+    return apic_to_cpu[lapic_id()];
+}
+
+int smp_cpu_count(void) {
+    return cpus_online;
+}
+
+void smp_send_resched(int cpu) {
+    if (cpu < 0 || cpu >= MAX_CPUS || !cpu_online[cpu]) return;
+    lapic_send_ipi(cpu_apic_id[cpu], LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | RESCHED_IPI_VECTOR);
+}
@@ -0,0 +1,28 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include "acpi.h"
+
+// Symmetric multiprocessing bring-up. CPU 0 is always the bootstrap
+// processor; application processors are numbered in firmware order.
+
+#define MAX_CPUS ACPI_MAX_CPUS
+
+// LAPIC timer rate that drives scheduling on the APs (the BSP keeps the PIT).
+#define SMP_AP_TICK_HZ 100
+
+// Enable the BSP's LAPIC and start every other enabled CPU with
+// INIT-SIPI-SIPI. Call after paging_init() and sched_init().
+void smp_init(void);
+
+// Index of the calling CPU (0 before the LAPIC is up).
+int smp_cpu_id(void);
+
+// Number of CPUs online (1 without SMP).
+int smp_cpu_count(void);
+
+// Ask another CPU to reschedule (RESCHED_IPI_VECTOR).
+void smp_send_resched(int cpu);
+
+#endif
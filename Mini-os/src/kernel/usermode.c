@@ -0,0 +1,318 @@
+#include "usermode.h"
+#include "../mem/paging.h"
+#include "../mem/pmm.h"
+#include "../sched/sched.h"
+#include "../sched/timer.h"
+#include "../drivers/clock.h"
+#include "../syscall/syscall.h"
+#include "../syscall/uring.h"
+#include "../drivers/tty.h"
+#include "vdso.h"
+
+// User stack: fixed virtual range below USER_STACK_TOP, backed by PMM frames
+#define USER_STACK_PAGES   2
+#define USER_PAGE_SIZE     4096u
+
+// Ring 0 stack of the benchmark tasks (interrupts and system calls)
+#define BENCH_KSTACK_DWORDS 2048 // 8 KiB
+
+extern uint8_t _user_start[];
+extern uint8_t _user_end[];
+
+static int user_ready = 0;
+static uint32_t bench_kstack[BENCH_KSTACK_DWORDS];
+static int bench_task = -1;
+
+// Written by the ring 3 side
+USER_DATA static volatile user_sysbench_t bench;
+USER_DATA static volatile user_uringbench_t ubench;
+USER_DATA static volatile uint32_t bench_done;
+USER_DATA static uring_t bench_ring;
+USER_DATA static volatile uint32_t ttyecho_raw;
+USER_DATA static char ttyecho_buf[128];
+USER_DATA static char ttyecho_prefix[] = "> ";
+
+void user_init(void) {
+    uint32_t start = (uint32_t)(uintptr_t)_user_start;
+    uint32_t end = (uint32_t)(uintptr_t)_user_end;
+    for (uint32_t addr = start; addr < end; addr += USER_PAGE_SIZE) {
+        paging_map_page(addr, addr, PAGE_RW | PAGE_USER);
+    }
+
+    for (uint32_t i = 1; i <= USER_STACK_PAGES; i++) {
+        uint32_t frame = pmm_alloc_frame();
+        if (!frame) return;
+        paging_map_page(USER_STACK_TOP - i * USER_PAGE_SIZE, frame, PAGE_RW | PAGE_USER);
+    }
+    vdso_map(USER_VDSO_ADDR);
+    user_ready = 1;
+}
+
+static int range_within(uint32_t addr, uint32_t len, uint32_t start, uint32_t end) {
+    return addr >= start && addr <= end && len <= end - addr;
+}
+
+int user_range_ok(uint32_t addr, uint32_t len, int writable) {
+    if (!user_ready) return 0;
+    if (range_within(addr, len, (uint32_t)(uintptr_t)_user_start, (uint32_t)(uintptr_t)_user_end)) return 1;
+    if (range_within(addr, len, USER_STACK_TOP - USER_STACK_PAGES * USER_PAGE_SIZE, USER_STACK_TOP)) return 1;
+    return !writable && range_within(addr, len, USER_VDSO_ADDR, USER_VDSO_ADDR + USER_PAGE_SIZE);
+}
+
+// ---------------------------------------------------------------------------
+// Ring 3 side. Everything it touches must live in .user or on the user
+// stack, so the helpers are forced inline and nothing calls kernel code.
+
+static inline __attribute__((always_inline)) uint32_t user_rdtsc_lo(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    (void)hi;
+    return lo;
+}
+
+static inline __attribute__((always_inline)) uint64_t user_rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline __attribute__((always_inline)) int user_int80(uint32_t nr, uint32_t arg) {
+    int ret;
+    __asm__ __volatile__("int $0x80" : "=a"(ret) : "a"(nr), "b"(arg) : "memory");
+    return ret;
+}
+
+static inline __attribute__((always_inline)) int user_int80_2(uint32_t nr, uint32_t arg1, uint32_t arg2) {
+    int ret;
+    __asm__ __volatile__("int $0x80" : "=a"(ret) : "a"(nr), "b"(arg1), "c"(arg2) : "memory");
+    return ret;
+}
+
+// SYSENTER convention (see sysenter_entry): ECX = stack, EDX = return address
+static inline __attribute__((always_inline)) int user_sysenter(uint32_t nr, uint32_t arg) {
+    int ret;
+    __asm__ __volatile__("movl %%esp, %%ecx\n\t"
+                         "movl $1f, %%edx\n\t"
+                         "sysenter\n"
+                         "1:"
+                         : "=a"(ret) : "a"(nr), "b"(arg) : "ecx", "edx", "memory");
+    return ret;
+}
+
+USER_TEXT static void user_sysbench_main(void) {
+    uint32_t n = bench.iterations;
+    uint64_t total = 0;
+    uint32_t min = ~0u;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t t0 = user_rdtsc_lo();
+        user_int80(SYSCALL_NOP, 0);
+        uint32_t d = user_rdtsc_lo() - t0;
+        total += d;
+        if (d < min) min = d;
+    }
+    bench.int80_total = total;
+    bench.int80_min = min;
+
+    if (bench.sysenter_ok) {
+        total = 0;
+        min = ~0u;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t t0 = user_rdtsc_lo();
+            user_sysenter(SYSCALL_NOP, 0);
+            uint32_t d = user_rdtsc_lo() - t0;
+            total += d;
+            if (d < min) min = d;
+        }
+        bench.sysenter_total = total;
+        bench.sysenter_min = min;
+    }
+
+    total = 0;
+    min = ~0u;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t t0 = user_rdtsc_lo();
+        vdso_clock_ns();
+        uint32_t d = user_rdtsc_lo() - t0;
+        total += d;
+        if (d < min) min = d;
+    }
+    bench.vdso_total = total;
+    bench.vdso_min = min;
+
+    bench_done = 1;
+    user_int80(SYSCALL_EXIT, 0);
+    for (;;) {
+    }
+}
+
+// The same null calls, once as one trap each and once through the
+// submission ring with at most one SYSCALL_URING_ENTER per batch.
+USER_TEXT static void user_uringbench_main(void) {
+    uint32_t n = ubench.iterations;
+    uint32_t batch = ubench.batch;
+
+    uint64_t t0 = user_rdtsc();
+    for (uint32_t i = 0; i < n; i++) {
+        user_int80(SYSCALL_NOP, 0);
+    }
+    ubench.sync_total = user_rdtsc() - t0;
+    ubench.sync_traps = n;
+
+    uint32_t traps = 1;
+    if (user_int80(SYSCALL_URING_SETUP, (uint32_t)(uintptr_t)&bench_ring) != 0) {
+        ubench.ring_ok = 0;
+        bench_done = 1;
+        user_int80(SYSCALL_EXIT, 0);
+    }
+
+    uint32_t errors = 0;
+    t0 = user_rdtsc();
+    for (uint32_t done = 0; done < n;) {
+        uint32_t k = n - done < batch ? n - done : batch;
+        for (uint32_t j = 0; j < k; j++) {
+            uring_sqe_t* sqe = uring_get_sqe(&bench_ring);
+            sqe->opcode = SYSCALL_NOP;
+            sqe->user_data = done + j;
+            sqe->args[0] = 0;
+            sqe->args[1] = 0;
+            sqe->args[2] = 0;
+            uring_submit(&bench_ring);
+        }
+        // A polling uringd may already have run the batch.
+        if (uring_need_enter(&bench_ring) || bench_ring.cq_tail - bench_ring.cq_head < k) {
+            user_int80(SYSCALL_URING_ENTER, k);
+            traps++;
+        }
+        uring_cqe_t cqe;
+        while (uring_peek_cqe(&bench_ring, &cqe)) {
+            if (cqe.result != 0) errors++;
+        }
+        done += k;
+    }
+    ubench.ring_total = user_rdtsc() - t0;
+    ubench.ring_traps = traps;
+    ubench.ring_errors = errors;
+    ubench.ring_ok = 1;
+
+    bench_done = 1;
+    user_int80(SYSCALL_EXIT, 0);
+    for (;;) {
+    }
+}
+
+// Cooked: read lines and write each back until an empty one. Raw: write
+// back every key until 'q'.
+USER_TEXT static void user_ttyecho_main(void) {
+    uint32_t buf = (uint32_t)(uintptr_t)ttyecho_buf;
+    if (ttyecho_raw) {
+        user_int80(SYSCALL_TTY_MODE, TTY_RAW);
+        for (;;) {
+            if (user_int80_2(SYSCALL_READ, buf, 1) != 1 || ttyecho_buf[0] == 'q') break;
+            user_int80_2(SYSCALL_WRITE, (uint32_t)(uintptr_t)ttyecho_prefix, 2);
+            user_int80_2(SYSCALL_WRITE, buf, 1);
+        }
+    } else {
+        for (;;) {
+            int n = user_int80_2(SYSCALL_READ, buf, sizeof(ttyecho_buf));
+            if (n <= 1) break;
+            user_int80_2(SYSCALL_WRITE, (uint32_t)(uintptr_t)ttyecho_prefix, 2);
+            user_int80_2(SYSCALL_WRITE, buf, (uint32_t)n);
+        }
+    }
+
+    bench_done = 1;
+    user_int80(SYSCALL_EXIT, 0);
+    for (;;) {
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+// Start a benchmark task at entry (ring 3) and wait until it reported and
+// is gone or timeout_ns passed (0: no limit). The caller has reset
+// bench_done.
+static int run_user_bench(const char* name, void (*entry)(void), uint64_t timeout_ns) {
+    sched_task_stats_t st;
+    bench_task = sched_create_user_task(name, (uint32_t)(uintptr_t)entry,
+                                        USER_STACK_TOP, bench_kstack, BENCH_KSTACK_DWORDS);
+    if (bench_task < 0) return -1;
+
+    uint64_t deadline = timeout_ns ? clock_ns() + timeout_ns : ~0ull;
+    while ((!bench_done || sched_get_stats(bench_task, &st) == 0) && clock_ns() < deadline) {
+        timer_sleep_ns(1000000ull);
+    }
+    return bench_done ? 0 : -1;
+}
+
+// The kernel stack is shared: a previous run that timed out may still be
+// using it.
+static int bench_busy(void) {
+    sched_task_stats_t st;
+    return bench_task >= 0 && sched_get_stats(bench_task, &st) == 0;
+}
+
+int user_sysbench(uint32_t iterations, user_sysbench_t* out) {
+    if (!user_ready || clock_tsc_khz() == 0 || iterations == 0 || bench_busy()) return -1;
+
+    bench.iterations = iterations;
+    bench.int80_total = 0;
+    bench.int80_min = 0;
+    bench.sysenter_total = 0;
+    bench.sysenter_min = 0;
+    bench.sysenter_ok = syscall_fast_available();
+    bench.vdso_total = 0;
+    bench.vdso_min = 0;
+    bench_done = 0;
+
+    // A round trip is well under 20 us even on slow emulation.
+    if (run_user_bench("sysbench", user_sysbench_main, 1000000000ull + (uint64_t)iterations * 20000u) != 0) return -1;
+
+    out->iterations = bench.iterations;
+    out->int80_total = bench.int80_total;
+    out->int80_min = bench.int80_min;
+    out->sysenter_total = bench.sysenter_total;
+    out->sysenter_min = bench.sysenter_min;
+    out->sysenter_ok = bench.sysenter_ok;
+    out->vdso_total = bench.vdso_total;
+    out->vdso_min = bench.vdso_min;
+    return 0;
+}
+
+int user_uringbench(uint32_t iterations, uint32_t batch, user_uringbench_t* out) {
+    if (!user_ready || clock_tsc_khz() == 0 || iterations == 0 || bench_busy()) return -1;
+    if (batch == 0) batch = 1;
+    if (batch > URING_ENTRIES) batch = URING_ENTRIES;
+
+    ubench.iterations = iterations;
+    ubench.batch = batch;
+    ubench.sync_total = 0;
+    ubench.sync_traps = 0;
+    ubench.ring_total = 0;
+    ubench.ring_traps = 0;
+    ubench.ring_errors = 0;
+    ubench.ring_ok = 0;
+    bench_done = 0;
+
+    // Each call is handled twice; waking uringd adds a scheduler round trip.
+    if (run_user_bench("uringbench", user_uringbench_main, 1000000000ull + (uint64_t)iterations * 60000u) != 0) return -1;
+
+    out->iterations = ubench.iterations;
+    out->batch = ubench.batch;
+    out->sync_total = ubench.sync_total;
+    out->sync_traps = ubench.sync_traps;
+    out->ring_total = ubench.ring_total;
+    out->ring_traps = ubench.ring_traps;
+    out->ring_errors = ubench.ring_errors;
+    out->ring_ok = ubench.ring_ok;
+    return 0;
+}
+
+int user_ttyecho(int raw) {
+    if (!user_ready || bench_busy()) return -1;
+    ttyecho_raw = raw ? 1 : 0;
+    bench_done = 0;
+
+    // Runs until the user ends it from the keyboard.
+    return run_user_bench("ttyecho", user_ttyecho_main, 0);
+}
@@ -0,0 +1,65 @@
+#ifndef USERMODE_H
+#define USERMODE_H
+
+#include <stdint.h>
+
+// Ring 3 support. Code and data meant to run in user mode are linked into
+// the page-aligned .user section (USER_TEXT / USER_DATA), which user_init()
+// maps user-accessible along with a user stack.
+
+#define USER_TEXT __attribute__((section(".user.text"), noinline))
+#define USER_DATA __attribute__((section(".user.data")))
+
+// Fixed user addresses: the stack grows down from USER_STACK_TOP and the
+// read-only kernel data page (vdso.h) sits right above it.
+#define USER_STACK_TOP 0x40000000u
+#define USER_VDSO_ADDR 0x40000000u
+
+// Map the .user section and the user stack. Call after paging_init() and
+// before smp_init(), so no CPU holds a stale supervisor-only TLB entry.
+void user_init(void);
+
+// A ring 3 buffer of len bytes at addr lies in user-accessible memory
+// (writable: excluding read-only pages). For system call arguments.
+int user_range_ok(uint32_t addr, uint32_t len, int writable);
+
+// Null system call round trips from ring 3 (SYSCALL_NOP), in cycles, and
+// for comparison a clock read from the shared data page (vdso_clock_ns).
+typedef struct {
+    uint32_t iterations;
+    uint64_t int80_total;
+    uint32_t int80_min;
+    uint64_t sysenter_total;
+    uint32_t sysenter_min;
+    int sysenter_ok;         // 0 if the CPU has no SYSENTER/SYSEXIT
+    uint64_t vdso_total;
+    uint32_t vdso_min;
+} user_sysbench_t;
+
+// Run the benchmark in a ring 3 task and wait for it (task context only).
+// Returns 0 on success, -1 if user mode, the TSC or a task slot is
+// unavailable or the task did not finish.
+int user_sysbench(uint32_t iterations, user_sysbench_t* out);
+
+// The same SYSCALL_NOP run as one trap per call and through the submission
+// ring (uring.h) in batches. Cycle totals cover the whole loop.
+typedef struct {
+    uint32_t iterations;
+    uint32_t batch;
+    uint64_t sync_total;
+    uint32_t sync_traps;
+    uint64_t ring_total;
+    uint32_t ring_traps;     // SYSCALL_URING_SETUP and _ENTER calls
+    uint32_t ring_errors;    // completions with a nonzero result
+    int ring_ok;             // 0 if the ring could not be set up
+} user_uringbench_t;
+
+// As user_sysbench(); batch is clamped to 1..URING_ENTRIES.
+int user_uringbench(uint32_t iterations, uint32_t batch, user_uringbench_t* out);
+
+// Ring 3 task that reads the keyboard with sys_read and writes it back:
+// whole lines until an empty one, or in raw mode single keys until 'q'.
+// Waits for the task; -1 if it could not be started.
+int user_ttyecho(int raw);
+
+#endif
@@ -0,0 +1,120 @@
+#include "vdso.h"
+#include "usermode.h"
+#include "../mem/paging.h"
+#include "../drivers/clock.h"
+#include "../drivers/pit.h"
+#include "../drivers/rtc.h"
+
+// One whole page, so mapping it into ring 3 exposes nothing else.
+static union {
+    vdso_data_t data;
+    uint8_t page[4096];
+} vdso_page __attribute__((aligned(4096)));
+
+static int vdso_ready = 0;
+
+void vdso_init(void) {
+    vdso_data_t* d = &vdso_page.data;
+
+    d->seq++;
+    __asm__ __volatile__("" ::: "memory");
+    d->tsc_ok = (uint32_t)clock_tsc_params(&d->tsc_base, &d->ns_mult, &d->ns_shift);
+    d->tick_hz = pit_get_frequency();
+    d->tick_period_ns = 1000000000u / d->tick_hz;
+    d->ticks = pit_get_ticks();
+    d->next_tick_ns = ~0ull;
+    d->wall_base_ns = (uint64_t)rtc_unix_time() * 1000000000ull - clock_ns();
+    __asm__ __volatile__("" ::: "memory");
+    d->seq++;
+    vdso_ready = 1;
+}
+
+void vdso_map(uint32_t virt) {
+    // Present and user, but not writable from ring 3.
+    paging_map_page(virt, (uint32_t)(uintptr_t)&vdso_page, PAGE_USER);
+}
+
+void vdso_update_ticks(uint64_t ticks, uint64_t next_tick_ns) {
+    if (!vdso_ready) return;
+
+    vdso_data_t* d = &vdso_page.data;
+    d->seq++;
+    __asm__ __volatile__("" ::: "memory");
+    d->ticks = ticks;
+    d->next_tick_ns = next_tick_ns;
+    __asm__ __volatile__("" ::: "memory");
+    d->seq++;
+}
+
+// ---------------------------------------------------------------------------
+// Ring 3 side: reads the page through its user mapping only.
+
+#define VDSO ((const volatile vdso_data_t*)USER_VDSO_ADDR)
+
+static inline __attribute__((always_inline)) uint64_t vdso_rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// (a * mul) >> shift, as in clock.c
+static inline __attribute__((always_inline)) uint64_t vdso_mul_shr(uint64_t a, uint32_t mul, uint32_t shift) {
+    uint64_t lo = (uint64_t)(uint32_t)a * mul;
+    uint64_t hi = (uint64_t)(uint32_t)(a >> 32) * mul;
+    return (lo >> shift) + (hi << (32u - shift));
+}
+
+USER_TEXT uint64_t vdso_clock_ns(void) {
+    uint32_t seq;
+    uint64_t ns;
+    do {
+        seq = VDSO->seq;
+        __asm__ __volatile__("" ::: "memory");
+        if (VDSO->tsc_ok) {
+            ns = vdso_mul_shr(vdso_rdtsc() - VDSO->tsc_base, VDSO->ns_mult, VDSO->ns_shift);
+        } else {
+            ns = VDSO->ticks * VDSO->tick_period_ns;
+        }
+        __asm__ __volatile__("" ::: "memory");
+    } while ((seq & 1u) || seq != VDSO->seq);
+    return ns;
+}
+
+USER_TEXT uint64_t vdso_ticks(void) {
+    uint32_t seq, period;
+    uint64_t ticks, next;
+    do {
+        seq = VDSO->seq;
+        __asm__ __volatile__("" ::: "memory");
+        ticks = VDSO->ticks;
+        next = VDSO->next_tick_ns;
+        period = VDSO->tick_period_ns;
+        __asm__ __volatile__("" ::: "memory");
+    } while ((seq & 1u) || seq != VDSO->seq);
+
+    // Tickless: the kernel only counts ticks when it wakes up, so add the
+    // periods that have elapsed since (32-bit divides only).
+    if (next != ~0ull) {
+        uint64_t now = vdso_clock_ns();
+        if (now >= next) {
+            uint64_t late = now - next;
+            uint32_t chunk = 0x80000000u / period;
+            while (late >> 32) {
+                late -= (uint64_t)chunk * period;
+                ticks += chunk;
+            }
+            ticks += 1u + (uint32_t)late / period;
+        }
+    }
+    return ticks;
+}
+
+USER_TEXT void vdso_wall_time(uint32_t* sec, uint32_t* nsec) {
+    uint64_t ns = VDSO->wall_base_ns + vdso_clock_ns();
+
+    // The quotient fits in 32 bits until 2106, so one divl does it.
+    uint32_t q, r;
+    __asm__("divl %4" : "=a"(q), "=d"(r) : "a"((uint32_t)ns), "d"((uint32_t)(ns >> 32)), "rm"(1000000000u));
+    *sec = q;
+    *nsec = r;
+}
@@ -0,0 +1,39 @@
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <stdint.h>
+
+// Shared kernel data page. The kernel publishes the tick counter and the
+// TSC-to-ns conversion here; ring 3 maps it read-only at USER_VDSO_ADDR
+// and reads the time without a system call. Writers bump seq to odd
+// before and back to even after an update (same scheme as pit_ticks).
+
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t tsc_ok;          // 0: no TSC, ns advance with ticks only
+    uint64_t tsc_base;        // ns = ((tsc - tsc_base) * ns_mult) >> ns_shift
+    uint32_t ns_mult;
+    uint32_t ns_shift;
+    uint32_t tick_hz;
+    uint32_t tick_period_ns;
+    uint64_t ticks;           // tick counter at the last update
+    uint64_t next_tick_ns;    // tickless: when ticks next advances (~0 if periodic)
+    uint64_t wall_base_ns;    // Unix time in ns at clock_ns() == 0
+} vdso_data_t;
+
+// Fill the page from the calibrated clock and the RTC. Call after
+// clock_init() and pit_init().
+void vdso_init(void);
+
+// Map the page read-only for ring 3 at virt (done by user_init()).
+void vdso_map(uint32_t virt);
+
+// Publish a new tick count. Callers serialize (IRQ0 or pit_lock).
+void vdso_update_ticks(uint64_t ticks, uint64_t next_tick_ns);
+
+// Ring 3 readers (in .user): no system call, no kernel memory access.
+uint64_t vdso_clock_ns(void);
+uint64_t vdso_ticks(void);
+void vdso_wall_time(uint32_t* sec, uint32_t* nsec);
+
+#endif
@@ -1,6 +1,7 @@
 #include "kheap.h"
 #include "pmm.h"
 #include "paging.h"
+#include "../sched/sync.h"
 #include <stdint.h>
 
 #define PAGE_SIZE 4096u
@@ -15,6 +16,7 @@ typedef struct block_header {
 
 static uint32_t heap_end = HEAP_BASE;
 static block_header_t* heap_head = 0;
+static spinlock_t heap_lock;
 
 static uint32_t align_up(uint32_t v, uint32_t a) {
     return (v + a - 1u) & ~(a - 1u);
@@ -41,6 +43,7 @@ static int heap_grow_pages(uint32_t pages) {
 }
 
 void kheap_init(void) {
+    spin_lock_init(&heap_lock, "kheap");
     heap_end = HEAP_BASE;
     heap_head = 0;
 
@@ -70,11 +73,7 @@ static void split_block(block_header_t* blk, uint32_t needed) {
     blk->next = next;
 }
 
-void* kmalloc(size_t size) {
-    if (size == 0) return 0;
-
-    uint32_t needed = align_up((uint32_t)size, 8u);
-
+static void* find_free_block(uint32_t needed) {
     block_header_t* cur = heap_head;
     while (cur) {
         if (cur->free && cur->size >= needed) {
@@ -84,11 +83,28 @@ void* kmalloc(size_t size) {
         }
         cur = cur->next;
     }
+    return 0;
+}
+
+void* kmalloc(size_t size) {
+    if (size == 0) return 0;
+
+    uint32_t needed = align_up((uint32_t)size, 8u);
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* p = find_free_block(needed);
+    if (p) {
+        spin_unlock_irqrestore(&heap_lock, flags);
+        return p;
+    }
 
     // No block found: grow heap by enough pages and retry once.
     uint32_t total_needed = needed + (uint32_t)sizeof(block_header_t);
     uint32_t pages = align_up(total_needed, PAGE_SIZE) / PAGE_SIZE;
-    if (!heap_grow_pages(pages)) return 0;
+    if (!heap_grow_pages(pages)) {
+        spin_unlock_irqrestore(&heap_lock, flags);
+        return 0;
+    }
 
     // Append a new free block at the previous end.
     block_header_t* tail = heap_head;
@@ -103,7 +119,35 @@ void* kmalloc(size_t size) {
     else heap_head = new_blk;
 
     // Retry allocation.
-    return kmalloc(size);
+    p = find_free_block(needed);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return p;
+}
+
+size_t kmalloc_extend(void* ptr, size_t size) {
+    block_header_t* blk = (block_header_t*)((uint8_t*)ptr - sizeof(block_header_t));
+    uint32_t needed = align_up((uint32_t)size, 8u);
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    if (blk->size < needed) {
+        uint8_t* blk_end = (uint8_t*)blk + sizeof(block_header_t) + blk->size;
+        block_header_t* next = blk->next;
+        if (next && next->free && (uint8_t*)next == blk_end &&
+            blk->size + (uint32_t)sizeof(block_header_t) + next->size >= needed) {
+            blk->size += (uint32_t)sizeof(block_header_t) + next->size;
+            blk->next = next->next;
+            split_block(blk, needed);
+        } else if (!next && (uint32_t)blk_end == heap_end) {
+            uint32_t pages = align_up(needed - blk->size, PAGE_SIZE) / PAGE_SIZE;
+            if (heap_grow_pages(pages)) {
+                blk->size += pages * PAGE_SIZE;
+                split_block(blk, needed);
+            }
+        }
+    }
+    size_t usable = blk->size;
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return usable;
 }
 
 static void coalesce(void) {
@@ -122,7 +166,9 @@ static void coalesce(void) {
 void kfree(void* ptr) {
     if (!ptr) return;
     block_header_t* blk = (block_header_t*)((uint8_t*)ptr - sizeof(block_header_t));
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
     blk->free = 1;
     coalesce();
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
 
@@ -8,5 +8,10 @@ void kheap_init(void);
 void* kmalloc(size_t size);
 void kfree(void* ptr);
 
+// Grow an allocation in place to at least size bytes by taking over the
+// free block after it (or new pages, at the end of the heap). Returns the
+// usable size, unchanged if the block could not grow.
+size_t kmalloc_extend(void* ptr, size_t size);
+
 #endif
 
@@ -4,10 +4,6 @@
 
 #define PAGE_SIZE 4096u
 
-// Page directory/table entry flags
-#define PAGE_PRESENT 0x001u
-#define PAGE_RW      0x002u
-
 static uint32_t align_down(uint32_t val, uint32_t align) {
     return val & ~(align - 1u);
 }
@@ -60,8 +56,10 @@ void paging_map_page(uint32_t virt, uint32_t phys, uint32_t flags) {
 
     uint32_t* pt = get_page_table(pd_index, 1);
     if (!pt) return;
+    if (flags & PAGE_USER) page_directory[pd_index] |= PAGE_USER;
 
     pt[pt_index] = (phys & 0xFFFFF000u) | (flags & 0xFFFu) | PAGE_PRESENT;
+    __asm__ __volatile__("invlpg (%0)" : : "r"(virt) : "memory");
 }
 
 void paging_init(void) {
@@ -6,7 +6,13 @@
 // Enable kernel paging with identity mapping for low memory and VBE framebuffer.
 void paging_init(void);
 
-// Map a single 4KiB page (virt -> phys) with RW by default.
+// Page table entry flags for paging_map_page()
+#define PAGE_PRESENT 0x001u
+#define PAGE_RW      0x002u
+#define PAGE_USER    0x004u   // reachable from ring 3
+
+// Map a single 4KiB page (virt -> phys) with RW by default. PAGE_USER also
+// opens the covering page directory entry to ring 3.
 void paging_map_page(uint32_t virt, uint32_t phys, uint32_t flags);
 
 #endif
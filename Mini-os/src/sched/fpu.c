@@ -0,0 +1,180 @@
+#include "fpu.h"
+#include "sched.h"
+#include "../io.h"
+#include "../kernel/smp.h"
+
+#define CR0_MP (1u << 1)
+#define CR0_EM (1u << 2)
+#define CR0_TS (1u << 3)
+#define CR0_NE (1u << 5)
+#define CR4_OSFXSR     (1u << 9)
+#define CR4_OSXMMEXCPT (1u << 10)
+
+#define CPUID_EDX_FPU  (1u << 0)
+#define CPUID_EDX_FXSR (1u << 24)
+#define CPUID_EDX_SSE  (1u << 25)
+
+// FXSAVE needs 512 bytes, 16-byte aligned; FNSAVE uses the first 108.
+typedef struct {
+    uint8_t data[512];
+} __attribute__((aligned(16))) fpu_area_t;
+
+static fpu_area_t task_fpu[MAX_TASKS];
+static uint8_t task_fpu_valid[MAX_TASKS];  // saved state exists in task_fpu[]
+static fpu_area_t initial_fpu;             // clean state for a task's first use
+
+static int fpu_present = 0;
+static int use_fxsr = 0;
+static int use_sse = 0;
+static int fpu_owner[MAX_CPUS];  // task whose state is live in each CPU's FPU
+static int ts_set[MAX_CPUS];     // mirrors CR0.TS to skip redundant CR0 writes
+
+static inline uint32_t read_cr0(void) {
+    uint32_t v;
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint32_t v) {
+    __asm__ __volatile__("mov %0, %%cr0" : : "r"(v) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t v;
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr4(uint32_t v) {
+    __asm__ __volatile__("mov %0, %%cr4" : : "r"(v) : "memory");
+}
+
+static inline void clts(int cpu) {
+    __asm__ __volatile__("clts" : : : "memory");
+    ts_set[cpu] = 0;
+}
+
+static inline void stts(int cpu) {
+    write_cr0(read_cr0() | CR0_TS);
+    ts_set[cpu] = 1;
+}
+
+static void save_state(fpu_area_t* area) {
+    if (use_fxsr) {
+        __asm__ __volatile__("fxsave (%0)" : : "r"(area->data) : "memory");
+    } else {
+        // FNSAVE also reinitializes the FPU, which is fine: a load follows.
+        __asm__ __volatile__("fnsave (%0)" : : "r"(area->data) : "memory");
+    }
+}
+
+static void load_state(const fpu_area_t* area) {
+    if (use_fxsr) {
+        __asm__ __volatile__("fxrstor (%0)" : : "r"(area->data) : "memory");
+    } else {
+        __asm__ __volatile__("frstor (%0)" : : "r"(area->data) : "memory");
+    }
+}
+
+// Per-CPU control register setup; leaves TS clear.
+static void fpu_setup_cpu(int cpu) {
+    // Native error reporting, WAIT honours TS, no emulation.
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    write_cr0(cr0);
+    ts_set[cpu] = 0;
+    fpu_owner[cpu] = -1;
+
+    if (use_fxsr) {
+        uint32_t cr4 = read_cr4() | CR4_OSFXSR;
+        if (use_sse) cr4 |= CR4_OSXMMEXCPT;
+        write_cr4(cr4);
+    }
+    __asm__ __volatile__("fninit");
+}
+
+void fpu_init(void) {
+    uint32_t regs[4];
+    cpu_cpuid(1, regs);
+    uint32_t edx = regs[3];
+
+    fpu_present = (edx & CPUID_EDX_FPU) != 0;
+    use_fxsr = (edx & CPUID_EDX_FXSR) != 0;
+    use_sse = use_fxsr && (edx & CPUID_EDX_SSE) != 0;
+    for (int c = 0; c < MAX_CPUS; c++) {
+        fpu_owner[c] = -1;
+        ts_set[c] = 0;
+    }
+    for (int i = 0; i < MAX_TASKS; i++) task_fpu_valid[i] = 0;
+    if (!fpu_present) return;
+
+    fpu_setup_cpu(0);
+
+    // Capture a clean state (FNINIT defaults, all SSE exceptions masked).
+    if (use_sse) {
+        uint32_t mxcsr = 0x1F80;
+        __asm__ __volatile__("ldmxcsr %0" : : "m"(mxcsr));
+    }
+    save_state(&initial_fpu);
+
+    // Nobody owns the FPU yet: the first user traps.
+    stts(0);
+}
+
+void fpu_init_ap(void) {
+    if (!fpu_present) return;
+    int cpu = smp_cpu_id();
+    fpu_setup_cpu(cpu);
+    stts(cpu);
+}
+
+int fpu_has_sse(void) {
+    return use_sse;
+}
+
+void fpu_switch(int task_id) {
+    if (!fpu_present) return;
+    int cpu = smp_cpu_id();
+
+    // Only the owner may run with TS clear; everyone else traps on first use.
+    if (task_id == fpu_owner[cpu]) {
+        if (ts_set[cpu]) clts(cpu);
+    } else if (!ts_set[cpu]) {
+        stts(cpu);
+    }
+}
+
+int fpu_task_live_on(int cpu, int task_id) {
+    return cpu >= 0 && cpu < MAX_CPUS && fpu_owner[cpu] == task_id;
+}
+
+void fpu_task_reset(int task_id) {
+    if (task_id < 0 || task_id >= MAX_TASKS) return;
+    task_fpu_valid[task_id] = 0;
+    // A reused slot's old owner entry is stale; drop it so the next user
+    // of that CPU's FPU does not save into the new task's area.
+    for (int c = 0; c < MAX_CPUS; c++) {
+        if (fpu_owner[c] == task_id) fpu_owner[c] = -1;
+    }
+}
+
+void fpu_handle_nm(void) {
+    // Runs from the exception stub with interrupts disabled.
+    int cpu = smp_cpu_id();
+    int cur = sched_current_task();
+    clts(cpu);
+    if (cur == fpu_owner[cpu]) return;
+
+    int owner = fpu_owner[cpu];
+    if (owner >= 0) {
+        save_state(&task_fpu[owner]);
+        task_fpu_valid[owner] = 1;
+    }
+    if (cur >= 0 && task_fpu_valid[cur]) {
+        load_state(&task_fpu[cur]);
+    } else {
+        load_state(&initial_fpu);
+    }
+    fpu_owner[cpu] = cur;
+}
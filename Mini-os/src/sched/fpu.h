@@ -0,0 +1,36 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+// Lazy x87/SSE context switching.
+// CR0.TS is set whenever the running task does not own the FPU registers;
+// its first FPU/SSE instruction then raises #NM (vector 7), which saves the
+// previous owner's state and loads the current task's. Tasks that never
+// touch the FPU never fault and are never saved or restored.
+// Ownership is tracked per CPU; a task whose registers are live on one CPU
+// must not be migrated to another (see fpu_task_live_on).
+// Kernel code running in interrupt context must not use the FPU.
+
+// Enable the FPU (and SSE with FXSR when available). Call before sched_init().
+void fpu_init(void);
+
+// Apply the same CR0/CR4 setup on an application processor.
+void fpu_init_ap(void);
+
+// Non-zero if SSE is enabled (CR4.OSFXSR set).
+int fpu_has_sse(void);
+
+// Called by the scheduler when task_id is about to run on this CPU.
+void fpu_switch(int task_id);
+
+// Non-zero if task_id's FPU state is held in the registers of that CPU.
+int fpu_task_live_on(int cpu, int task_id);
+
+// Forget a task's FPU state (its slot is being reused).
+void fpu_task_reset(int task_id);
+
+// #NM (device not available) handler.
+void fpu_handle_nm(void);
+
+#endif
@@ -0,0 +1,132 @@
+#include "irqsoff.h"
+#include "../drivers/clock.h"
+#include "../kernel/smp.h"
+#include "../idt.h"
+
+// Per-CPU state of the section in progress. All hooks run with interrupts
+// disabled, so only the shared worst-case table needs a lock; it is a raw
+// xchg lock because spinlock_t itself calls back into the tracer.
+typedef struct {
+    int off;
+    uint64_t start;
+    uint32_t ip;
+} irqsoff_cpu_t;
+
+static irqsoff_cpu_t cpu_state[MAX_CPUS];
+static irqsoff_record_t worst[IRQSOFF_WORST];
+static int worst_count = 0;
+static volatile uint32_t worst_lock = 0;
+static volatile int tracing = 0;
+
+static void worst_lock_acquire(void) {
+    while (__sync_lock_test_and_set(&worst_lock, 1u)) {
+        __asm__ __volatile__("pause");
+    }
+}
+
+static void worst_lock_release(void) {
+    __sync_lock_release(&worst_lock);
+}
+
+#if IRQSOFF_TRACE
+static void section_begin(irqsoff_cpu_t* s, uint32_t ip) {
+    s->off = 1;
+    s->start = clock_cycles();
+    s->ip = ip;
+}
+
+static void section_end(irqsoff_cpu_t* s, uint32_t ip, int cpu) {
+    uint64_t cycles = clock_cycles() - s->start;
+    s->off = 0;
+
+    // Cheap reject before taking the lock: shorter than the current minimum.
+    if (worst_count == IRQSOFF_WORST && cycles <= worst[IRQSOFF_WORST - 1].cycles) {
+        return;
+    }
+
+    worst_lock_acquire();
+    int i;
+    if (worst_count < IRQSOFF_WORST) {
+        i = worst_count++;
+    } else if (cycles > worst[IRQSOFF_WORST - 1].cycles) {
+        i = IRQSOFF_WORST - 1;
+    } else {
+        worst_lock_release();
+        return;
+    }
+    // Insertion sort, longest first.
+    while (i > 0 && worst[i - 1].cycles < cycles) {
+        worst[i] = worst[i - 1];
+        i--;
+    }
+    worst[i].cycles = cycles;
+    worst[i].off_ip = s->ip;
+    worst[i].on_ip = ip;
+    worst[i].cpu = cpu;
+    worst_lock_release();
+}
+
+void trace_irqs_off_ip(uint32_t ip) {
+    if (!tracing) return;
+    irqsoff_cpu_t* s = &cpu_state[smp_cpu_id()];
+    if (!s->off) section_begin(s, ip);
+}
+
+void trace_irqs_on_ip(uint32_t ip) {
+    if (!tracing) return;
+    int cpu = smp_cpu_id();
+    irqsoff_cpu_t* s = &cpu_state[cpu];
+    if (s->off) section_end(s, ip, cpu);
+}
+
+__attribute__((noinline)) void trace_irqs_off(void) {
+    trace_irqs_off_ip((uint32_t)(uintptr_t)__builtin_return_address(0));
+}
+
+__attribute__((noinline)) void trace_irqs_on(void) {
+    trace_irqs_on_ip((uint32_t)(uintptr_t)__builtin_return_address(0));
+}
+
+void trace_irqs_switch(int irqs_on) {
+    if (!tracing) return;
+    uint32_t ip = (uint32_t)(uintptr_t)__builtin_return_address(0);
+    int cpu = smp_cpu_id();
+    irqsoff_cpu_t* s = &cpu_state[cpu];
+    if (s->off) section_end(s, ip, cpu);
+    if (!irqs_on) section_begin(s, ip);
+}
+#endif
+
+int irqsoff_set_enabled(int enabled) {
+    if (enabled && (!IRQSOFF_TRACE || clock_tsc_khz() == 0)) return 0;
+    if (enabled && !tracing) {
+        // Sections already in progress are unknown; start clean.
+        for (int cpu = 0; cpu < MAX_CPUS; cpu++) cpu_state[cpu].off = 0;
+    }
+    tracing = enabled ? 1 : 0;
+    return 1;
+}
+
+int irqsoff_enabled(void) {
+    return tracing;
+}
+
+// Readers keep interrupts off (untraced) so an interrupt exit on this CPU
+// cannot spin on the table lock they hold.
+void irqsoff_reset(void) {
+    uint32_t flags = irq_save_notrace();
+    worst_lock_acquire();
+    worst_count = 0;
+    worst_lock_release();
+    irq_restore_notrace(flags);
+}
+
+int irqsoff_get(int index, irqsoff_record_t* out) {
+    uint32_t flags = irq_save_notrace();
+    worst_lock_acquire();
+    int ok = (index >= 0 && index < worst_count);
+    if (ok) *out = worst[index];
+    worst_lock_release();
+    irq_restore_notrace(flags);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,56 @@
+#ifndef IRQSOFF_H
+#define IRQSOFF_H
+
+#include <stdint.h>
+
+// Interrupts-off latency tracer. Every IF transition made through
+// irq_save()/irq_restore(), irq_disable()/irq_enable(), the irqsave
+// spinlocks and interrupt entry/exit is timestamped with the TSC; the
+// longest sections are kept with the code addresses that disabled and
+// re-enabled interrupts (resolve with addr2line -e bin/kernel.elf).
+// Compiled in by default but idle until irqsoff_set_enabled(1); build with
+// -DIRQSOFF_TRACE=0 to remove the hooks entirely.
+
+#ifndef IRQSOFF_TRACE
+#define IRQSOFF_TRACE 1
+#endif
+
+#define IRQSOFF_WORST 8
+
+typedef struct {
+    uint64_t cycles;
+    uint32_t off_ip;    // where interrupts were disabled
+    uint32_t on_ip;     // where they were enabled again
+    int cpu;
+} irqsoff_record_t;
+
+#if IRQSOFF_TRACE
+// Hooks: call right after disabling / right before enabling interrupts.
+// The plain forms attribute the transition to their call site; the _ip
+// forms let wrappers (spinlocks) pass their own caller.
+void trace_irqs_off(void);
+void trace_irqs_on(void);
+void trace_irqs_off_ip(uint32_t ip);
+void trace_irqs_on_ip(uint32_t ip);
+
+// Interrupt exit onto another task's stack: close the current section and,
+// if the resumed context runs with interrupts off, open a new one.
+void trace_irqs_switch(int irqs_on);
+#else
+static inline void trace_irqs_off(void) {}
+static inline void trace_irqs_on(void) {}
+static inline void trace_irqs_off_ip(uint32_t ip) { (void)ip; }
+static inline void trace_irqs_on_ip(uint32_t ip) { (void)ip; }
+static inline void trace_irqs_switch(int irqs_on) { (void)irqs_on; }
+#endif
+
+// Start or stop tracing (starting clears nothing; see irqsoff_reset()).
+// Returns 0 if the tracer is compiled out or there is no TSC.
+int irqsoff_set_enabled(int enabled);
+int irqsoff_enabled(void);
+void irqsoff_reset(void);
+
+// Worst sections, longest first. Returns -1 past the last recorded one.
+int irqsoff_get(int index, irqsoff_record_t* out);
+
+#endif
@@ -1,70 +1,83 @@
 #include "sched.h"
-#include "../graphic/vbe.h"
+#include "fpu.h"
+#include "sync.h"
 #include "../drivers/pit.h"
+#include "../drivers/clock.h"
+#include "../kernel/smp.h"
+#include "../gdt.h"
 
-extern int g_heap_ok;
+// Small preemptive round-robin kernel-thread scheduler with one run queue
+// per CPU. Tasks are represented by a saved stack pointer that points to the
+// interrupt frame layout used by `isr.asm`'s irq_common_stub (i.e.,
+// registers_t*). All scheduler state is guarded by sched_lock; a CPU whose
+// queue runs dry steals the oldest stealable task from the longest queue.
 
-// Extremely small round-robin kernel-thread scheduler.
-// Tasks are represented by a saved stack pointer that points to the interrupt
-// frame layout used by `isr.asm`'s irq_common_stub (i.e., registers_t*).
-
-#define MAX_TASKS 8
 #define STACK_SIZE_DWORDS (4096) // 16 KiB stack (4096 * 4)
 
+// Timeslice length. With a periodic tick every tick ends a slice; in tickless
+// mode (BSP with a one-shot PIT) the timer is armed for slice expiry instead.
+#define SCHED_SLICE_NS 10000000ull
+
+// Task slots with fixed roles
+#define IDLE_TASK      0   // the BSP's idle task; APs allocate theirs
+#define BOOTSTRAP_TASK 1
+
 typedef enum {
     TASK_UNUSED = 0,
     TASK_RUNNABLE = 1,
+    TASK_BLOCKED = 2,
+    TASK_DEAD = 3,       // exited; freed once off its stack
 } task_state_t;
 
 typedef struct {
     task_state_t state;
     registers_t* regs;   // saved "regs pointer" (top of irq frame stack)
     uint32_t* stack_base;
+    uint32_t kstack_top; // ring 0 stack of a user task (tss.esp0), 0 for kernel threads
+    const char* name;
+    int cpu;             // CPU whose run queue owns the task
+    int on_cpu;          // executing, or its stack is still in use by a switch
+    int queued;          // sitting in cpus[cpu].runq
+    int wake_pending;    // woken while running: next sched_block() returns
+
+    // Accounting (see sched_get_stats)
+    uint64_t runtime_ns;
+    uint64_t runnable_since_ns;  // when it last became runnable but not running
+    uint32_t switches;           // times switched in
+    uint32_t voluntary;          // switched out by blocking/yielding
+    uint32_t involuntary;        // switched out by slice expiry/wakeup preemption
+    uint32_t lat_hist[SCHED_LAT_BUCKETS];
+    uint64_t lat_max_ns;
 } task_t;
 
+typedef struct {
+    int online;
+    int current;
+    int idle;
+    int switch_prev;             // task to release in sched_finish_switch
+    uint64_t slice_start_ns;     // also when current was switched in
+    volatile int need_resched;
+    int runq[MAX_TASKS];         // FIFO ring of runnable, not running tasks
+    int rq_head;
+    int rq_count;
+} cpu_rq_t;
+
 static task_t tasks[MAX_TASKS];
-static int current_task = -1;
+static cpu_rq_t cpus[MAX_CPUS];
+static spinlock_t sched_lock;
 static int bootstrap_registered = 0;
+static uint32_t steals = 0;
 
 static uint32_t idle_stack[STACK_SIZE_DWORDS];
-static uint32_t demo_stack[STACK_SIZE_DWORDS];
 
-__attribute__((noreturn)) static void demo_task(void) {
-    uint64_t last = 0;
-    for (;;) {
-        uint64_t t = pit_get_ticks();
-        if (t != last) {
-            last = t;
-
-            // Draw a tiny tick counter in the corner (proof of preemption).
-            // Keep it small and non-invasive.
-            char buf[32];
-            int pos = 0;
-            const char* prefix = "ticks:";
-            for (int i = 0; prefix[i]; i++) buf[pos++] = prefix[i];
-
-            // Convert ticks to decimal (simple, no libc)
-            uint64_t v = t;
-            char tmp[20];
-            int tp = 0;
-            if (v == 0) tmp[tp++] = '0';
-            while (v > 0 && tp < (int)sizeof(tmp)) {
-                tmp[tp++] = '0' + (char)(v % 10);
-                v /= 10;
-            }
-            for (int i = tp - 1; i >= 0; i--) buf[pos++] = tmp[i];
-            buf[pos] = '\0';
+static const char* const idle_names[MAX_CPUS] = {
+    "idle", "idle1", "idle2", "idle3", "idle4", "idle5", "idle6", "idle7",
+};
 
-            vbe_draw_string(10, 10, buf, vbe_rgb(255, 255, 255), 2);
-
-            if (g_heap_ok) {
-                vbe_draw_string(10, 40, "heap: ok", vbe_rgb(0, 255, 0), 2);
-            } else {
-                vbe_draw_string(10, 40, "heap: fail", vbe_rgb(255, 0, 0), 2);
-            }
-        }
-    }
-}
+// Wakeup/preemption-to-run latency bucket upper bounds (ns); last is open.
+static const uint32_t lat_bounds_ns[SCHED_LAT_BUCKETS - 1] = {
+    10000u, 100000u, 1000000u, 10000000u, 100000000u,
+};
 
 __attribute__((noreturn)) static void idle_task(void) {
     for (;;) {
@@ -111,53 +124,454 @@ static registers_t* build_initial_regs(uint32_t* stack_top, void (*entry)(void))
     return (registers_t*)sp;
 }
 
+static registers_t* build_user_regs(uint32_t* kstack_top, uint32_t entry, uint32_t user_esp) {
+    // Same frame as build_initial_regs, but the iret goes to ring 3 and
+    // also pops the user stack.
+    uint32_t* sp = kstack_top;
+
+    *(--sp) = GDT_USER_DS;            // ss
+    *(--sp) = user_esp;               // useresp
+    *(--sp) = 0x00000202u;            // eflags (IF=1)
+    *(--sp) = GDT_USER_CS;            // cs
+    *(--sp) = entry;                  // eip
+
+    *(--sp) = 0; // int_no
+    *(--sp) = 0; // err_code
+
+    for (int i = 0; i < 8; i++) *(--sp) = 0; // pusha regs
+
+    *(--sp) = GDT_USER_DS; // ds
+    *(--sp) = GDT_USER_DS; // es
+    *(--sp) = GDT_USER_DS; // fs
+    *(--sp) = GDT_USER_DS; // gs
+
+    return (registers_t*)sp;
+}
+
+static void reset_task(task_t* t) {
+    t->state = TASK_UNUSED;
+    t->regs = 0;
+    t->stack_base = 0;
+    t->kstack_top = 0;
+    t->name = "";
+    t->cpu = 0;
+    t->on_cpu = 0;
+    t->queued = 0;
+    t->wake_pending = 0;
+    t->runtime_ns = 0;
+    t->runnable_since_ns = 0;
+    t->switches = 0;
+    t->voluntary = 0;
+    t->involuntary = 0;
+    for (int b = 0; b < SCHED_LAT_BUCKETS; b++) t->lat_hist[b] = 0;
+    t->lat_max_ns = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Run queues (sched_lock held)
+
+static void rq_push(int cpu, int id, int at_head) {
+    cpu_rq_t* c = &cpus[cpu];
+    if (tasks[id].queued || c->rq_count >= MAX_TASKS) return;
+    if (at_head) {
+        c->rq_head = (c->rq_head + MAX_TASKS - 1) % MAX_TASKS;
+        c->runq[c->rq_head] = id;
+    } else {
+        c->runq[(c->rq_head + c->rq_count) % MAX_TASKS] = id;
+    }
+    c->rq_count++;
+    tasks[id].queued = 1;
+    tasks[id].cpu = cpu;
+}
+
+static int rq_pop(int cpu) {
+    cpu_rq_t* c = &cpus[cpu];
+    if (c->rq_count == 0) return -1;
+    int id = c->runq[c->rq_head];
+    c->rq_head = (c->rq_head + 1) % MAX_TASKS;
+    c->rq_count--;
+    tasks[id].queued = 0;
+    return id;
+}
+
+// Remove the i-th entry (0 = head) of a run queue.
+static int rq_remove_at(int cpu, int i) {
+    cpu_rq_t* c = &cpus[cpu];
+    int id = c->runq[(c->rq_head + i) % MAX_TASKS];
+    for (int j = i; j < c->rq_count - 1; j++) {
+        c->runq[(c->rq_head + j) % MAX_TASKS] = c->runq[(c->rq_head + j + 1) % MAX_TASKS];
+    }
+    c->rq_count--;
+    tasks[id].queued = 0;
+    return id;
+}
+
+// Idle-time work stealing: take the task nearest the tail of the longest
+// other queue that is neither still on its old CPU's stack nor holding live
+// FPU registers there.
+static int steal_task(int cpu) {
+    int victim = -1;
+    for (int v = 0; v < MAX_CPUS; v++) {
+        if (v == cpu || !cpus[v].online || cpus[v].rq_count == 0) continue;
+        if (victim < 0 || cpus[v].rq_count > cpus[victim].rq_count) victim = v;
+    }
+    if (victim < 0) return -1;
+
+    for (int i = cpus[victim].rq_count - 1; i >= 0; i--) {
+        int id = cpus[victim].runq[(cpus[victim].rq_head + i) % MAX_TASKS];
+        if (tasks[id].on_cpu || fpu_task_live_on(victim, id)) continue;
+        rq_remove_at(victim, i);
+        tasks[id].cpu = cpu;
+        steals++;
+        return id;
+    }
+    return -1;
+}
+
+static int cpu_load(int cpu) {
+    return cpus[cpu].rq_count + (cpus[cpu].current != cpus[cpu].idle ? 1 : 0);
+}
+
+// ---------------------------------------------------------------------------
+
 void sched_init(void) {
+    spin_lock_init(&sched_lock, "sched");
     for (int i = 0; i < MAX_TASKS; i++) {
-        tasks[i].state = TASK_UNUSED;
-        tasks[i].regs = 0;
-        tasks[i].stack_base = 0;
+        reset_task(&tasks[i]);
+    }
+    for (int c = 0; c < MAX_CPUS; c++) {
+        cpus[c].online = 0;
+        cpus[c].current = -1;
+        cpus[c].idle = -1;
+        cpus[c].switch_prev = -1;
+        cpus[c].slice_start_ns = 0;
+        cpus[c].need_resched = 0;
+        cpus[c].rq_head = 0;
+        cpus[c].rq_count = 0;
     }
 
-    // Task 0: idle
-    tasks[0].state = TASK_RUNNABLE;
-    tasks[0].stack_base = idle_stack;
-    tasks[0].regs = build_initial_regs(&idle_stack[STACK_SIZE_DWORDS], idle_task);
-
-    // Task 2: demo task (shows tick counter)
-    tasks[2].state = TASK_RUNNABLE;
-    tasks[2].stack_base = demo_stack;
-    tasks[2].regs = build_initial_regs(&demo_stack[STACK_SIZE_DWORDS], demo_task);
+    // Task 0: the BSP's idle task
+    tasks[IDLE_TASK].state = TASK_RUNNABLE;
+    tasks[IDLE_TASK].stack_base = idle_stack;
+    tasks[IDLE_TASK].name = idle_names[0];
+    tasks[IDLE_TASK].regs = build_initial_regs(&idle_stack[STACK_SIZE_DWORDS], idle_task);
 
-    current_task = 0;
+    // Until the first tick registers kmain, the BSP counts as idle.
+    cpus[0].online = 1;
+    cpus[0].current = IDLE_TASK;
+    cpus[0].idle = IDLE_TASK;
     bootstrap_registered = 0;
+    steals = 0;
+}
+
+static int alloc_slot(void) {
+    for (int i = BOOTSTRAP_TASK + 1; i < MAX_TASKS; i++) {
+        if (tasks[i].state == TASK_UNUSED) return i;
+    }
+    return -1;
+}
+
+void sched_start_ap(int cpu) {
+    if (cpu <= 0 || cpu >= MAX_CPUS) return;
+
+    spin_lock(&sched_lock);
+    int i = alloc_slot();
+    if (i >= 0) {
+        // The AP's boot stack is already running; its regs are saved at the
+        // first switch away from it.
+        reset_task(&tasks[i]);
+        tasks[i].name = idle_names[cpu];
+        tasks[i].state = TASK_RUNNABLE;
+        tasks[i].cpu = cpu;
+        tasks[i].on_cpu = 1;
+        tasks[i].switches = 1;
+        cpus[cpu].current = i;
+        cpus[cpu].idle = i;
+        cpus[cpu].slice_start_ns = clock_ns();
+        cpus[cpu].online = 1;
+    }
+    spin_unlock(&sched_lock);
+}
+
+static int create_task(const char* name, uint32_t* stack, uint32_t stack_dwords,
+                       void (*entry)(void), uint32_t user_entry, uint32_t user_esp) {
+    int self = smp_cpu_id();
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    int i = alloc_slot();
+    if (i < 0) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+
+    reset_task(&tasks[i]);
+    fpu_task_reset(i);
+    tasks[i].stack_base = stack;
+    tasks[i].name = name;
+    if (entry) {
+        tasks[i].regs = build_initial_regs(&stack[stack_dwords], entry);
+    } else {
+        tasks[i].kstack_top = (uint32_t)(uintptr_t)&stack[stack_dwords];
+        tasks[i].regs = build_user_regs(&stack[stack_dwords], user_entry, user_esp);
+    }
+    tasks[i].runnable_since_ns = clock_ns();
+    tasks[i].state = TASK_RUNNABLE;
+
+    int target = 0;
+    for (int c = 1; c < MAX_CPUS; c++) {
+        if (cpus[c].online && cpu_load(c) < cpu_load(target)) target = c;
+    }
+    rq_push(target, i, 0);
+    int kick = (target != self && cpus[target].current == cpus[target].idle);
+    if (kick) cpus[target].need_resched = 1;
+    spin_unlock_irqrestore(&sched_lock, flags);
+
+    if (kick) smp_send_resched(target);
+    return i;
+}
+
+int sched_create_task(const char* name, void (*entry)(void), uint32_t* stack, uint32_t stack_dwords) {
+    if (!entry) return -1;
+    return create_task(name, stack, stack_dwords, entry, 0, 0);
+}
+
+int sched_create_user_task(const char* name, uint32_t entry, uint32_t user_esp,
+                           uint32_t* kstack, uint32_t kstack_dwords) {
+    return create_task(name, kstack, kstack_dwords, 0, entry, user_esp);
+}
+
+// Lazily register the currently-running bootstrap context as a task.
+static int register_bootstrap(int cpu, registers_t* regs) {
+    if (bootstrap_registered || cpu != 0) return 0;
+    tasks[BOOTSTRAP_TASK].state = TASK_RUNNABLE;
+    tasks[BOOTSTRAP_TASK].regs = regs;
+    tasks[BOOTSTRAP_TASK].stack_base = 0;
+    tasks[BOOTSTRAP_TASK].name = "kmain";
+    tasks[BOOTSTRAP_TASK].cpu = 0;
+    tasks[BOOTSTRAP_TASK].on_cpu = 1;
+    tasks[BOOTSTRAP_TASK].switches = 1;
+    cpus[0].current = BOOTSTRAP_TASK;
+    cpus[0].slice_start_ns = clock_ns();
+    bootstrap_registered = 1;
+    return 1;
 }
 
-static int pick_next_task(void) {
-    for (int i = 1; i <= MAX_TASKS; i++) {
-        int idx = (current_task + i) % MAX_TASKS;
-        if (tasks[idx].state == TASK_RUNNABLE && tasks[idx].regs != 0) {
-            return idx;
+static void record_latency(task_t* t, uint64_t wait_ns) {
+    int b = 0;
+    while (b < SCHED_LAT_BUCKETS - 1 && wait_ns >= lat_bounds_ns[b]) b++;
+    t->lat_hist[b]++;
+    if (wait_ns > t->lat_max_ns) t->lat_max_ns = wait_ns;
+}
+
+// Queue order: the running task goes to the tail if still runnable, then
+// take the head; an empty queue steals before falling back to idle.
+static int pick_next_task(int cpu) {
+    cpu_rq_t* c = &cpus[cpu];
+    int prev = c->current;
+    if (prev != c->idle && tasks[prev].state == TASK_RUNNABLE) {
+        rq_push(cpu, prev, 0);
+    }
+
+    int next = rq_pop(cpu);
+    if (next < 0) next = steal_task(cpu);
+    if (next < 0) next = c->idle;
+    return next;
+}
+
+static registers_t* switch_task(int cpu, registers_t* regs, uint64_t now, int voluntary) {
+    cpu_rq_t* c = &cpus[cpu];
+    int prev_id = c->current;
+    task_t* prev = &tasks[prev_id];
+
+    // Save current regs pointer into current task slot.
+    prev->regs = regs;
+    prev->runtime_ns += now - c->slice_start_ns;
+
+    int next = pick_next_task(cpu);
+    if (next != prev_id) {
+        if (voluntary) {
+            prev->voluntary++;
+        } else {
+            prev->involuntary++;
         }
+        // A preempted task starts waiting now; a blocked one when woken.
+        if (prev->state == TASK_RUNNABLE) prev->runnable_since_ns = now;
+
+        task_t* t = &tasks[next];
+        t->switches++;
+        t->on_cpu = 1;
+        t->cpu = cpu;
+        if (next != c->idle) record_latency(t, now - t->runnable_since_ns);
+        fpu_switch(next);
+        if (t->kstack_top) tss_set_kernel_stack(t->kstack_top);
+
+        // prev stays on_cpu until the stub has left its stack.
+        c->switch_prev = prev_id;
+    }
+
+    c->current = next;
+    c->slice_start_ns = now;
+    c->need_resched = 0;
+    return tasks[next].regs;
+}
+
+void sched_finish_switch(void) {
+    int cpu = smp_cpu_id();
+    spin_lock(&sched_lock);
+    int prev = cpus[cpu].switch_prev;
+    if (prev >= 0 && prev != cpus[cpu].current) {
+        tasks[prev].on_cpu = 0;
+        if (tasks[prev].state == TASK_DEAD) reset_task(&tasks[prev]);
     }
-    return current_task;
+    cpus[cpu].switch_prev = -1;
+    spin_unlock(&sched_lock);
 }
 
 registers_t* sched_on_tick(registers_t* regs) {
-    // Lazily register the currently-running bootstrap context as a task.
-    if (!bootstrap_registered) {
-        tasks[1].state = TASK_RUNNABLE;
-        tasks[1].regs = regs;
-        tasks[1].stack_base = 0;
-        current_task = 1;
-        bootstrap_registered = 1;
+    int cpu = smp_cpu_id();
+    spin_lock(&sched_lock);
+    if (register_bootstrap(cpu, regs)) {
+        spin_unlock(&sched_lock);
         return regs;
     }
 
-    // Save current regs pointer into current task slot.
-    tasks[current_task].regs = regs;
+    // In tickless mode IRQ0 may fire for other deadlines; only switch once
+    // the current slice has been used up (or a wakeup asked for it).
+    uint64_t now = clock_ns();
+    if (cpu == 0 && pit_is_tickless() && !cpus[cpu].need_resched &&
+        now - cpus[cpu].slice_start_ns < SCHED_SLICE_NS) {
+        spin_unlock(&sched_lock);
+        return regs;
+    }
+    registers_t* next = switch_task(cpu, regs, now, 0);
+    spin_unlock(&sched_lock);
+    return next;
+}
+
+registers_t* sched_on_yield(registers_t* regs) {
+    int cpu = smp_cpu_id();
+    spin_lock(&sched_lock);
+    register_bootstrap(cpu, regs);
+    registers_t* next = switch_task(cpu, regs, clock_ns(), 1);
+    spin_unlock(&sched_lock);
+    return next;
+}
+
+uint64_t sched_next_event_ns(void) {
+    // Slice expiry on the BSP; nothing to preempt with a single runnable task.
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    uint64_t next = ~0ull;
+    if (cpu_load(0) > 1) next = cpus[0].slice_start_ns + SCHED_SLICE_NS;
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return next;
+}
 
-    int next = pick_next_task();
-    current_task = next;
-    return tasks[current_task].regs;
+int sched_need_resched(void) {
+    return cpus[smp_cpu_id()].need_resched;
 }
 
+int sched_current_task(void) {
+    uint32_t flags = irq_save();
+    int id = cpus[smp_cpu_id()].current;
+    irq_restore(flags);
+    return id;
+}
+
+void sched_yield(void) {
+    __asm__ __volatile__("int $0x81" : : : "memory");
+}
+
+void sched_block(void) {
+    int cpu = smp_cpu_id();
+    spin_lock(&sched_lock);
+    task_t* t = &tasks[cpus[cpu].current];
+    if (t->wake_pending) {
+        t->wake_pending = 0;
+        spin_unlock(&sched_lock);
+        return;
+    }
+    t->state = TASK_BLOCKED;
+    spin_unlock(&sched_lock);
+    sched_yield();
+}
+
+void sched_exit(void) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    cpu_rq_t* c = &cpus[smp_cpu_id()];
+    if (c->current == c->idle || c->current == BOOTSTRAP_TASK) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return;
+    }
+    tasks[c->current].state = TASK_DEAD;
+    spin_unlock(&sched_lock);
+
+    // Never scheduled again; sched_finish_switch frees the slot.
+    sched_yield();
+    for (;;) {
+        __asm__ __volatile__("hlt");
+    }
+}
+
+void sched_wake(int task_id) {
+    if (task_id < 0 || task_id >= MAX_TASKS) return;
+
+    int self = smp_cpu_id();
+    int kick = -1;
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    task_t* t = &tasks[task_id];
+    if (t->state == TASK_BLOCKED) {
+        t->state = TASK_RUNNABLE;
+        t->wake_pending = 0;
+        t->runnable_since_ns = clock_ns();
+        rq_push(t->cpu, task_id, 1);
+
+        // Preempt its CPU, or if that one is busy let an idle CPU steal it.
+        kick = t->cpu;
+        if (cpus[kick].current != cpus[kick].idle) {
+            for (int c = 0; c < MAX_CPUS; c++) {
+                if (cpus[c].online && cpus[c].current == cpus[c].idle && cpus[c].rq_count == 0) {
+                    kick = c;
+                    break;
+                }
+            }
+        }
+        cpus[kick].need_resched = 1;
+    } else if (t->state == TASK_RUNNABLE) {
+        // Not blocked yet (wake raced with the condition check on another CPU).
+        t->wake_pending = 1;
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
+
+    if (kick >= 0 && kick != self) smp_send_resched(kick);
+}
+
+uint32_t sched_steal_count(void) {
+    return steals;
+}
+
+int sched_get_stats(int task_id, sched_task_stats_t* out) {
+    if (task_id < 0 || task_id >= MAX_TASKS) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    task_t* t = &tasks[task_id];
+    if (t->state == TASK_UNUSED || t->state == TASK_DEAD) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return -1;
+    }
+
+    int running = (cpus[t->cpu].current == task_id);
+    out->name = t->name;
+    out->state = (t->state == TASK_BLOCKED) ? 'B' : (running ? 'R' : 'W');
+    out->cpu = t->cpu;
+    out->runtime_ns = t->runtime_ns;
+    if (running) {
+        // Include the slice that is still in progress.
+        out->runtime_ns += clock_ns() - cpus[t->cpu].slice_start_ns;
+    }
+    out->switches = t->switches;
+    out->voluntary = t->voluntary;
+    out->involuntary = t->involuntary;
+    for (int b = 0; b < SCHED_LAT_BUCKETS; b++) out->lat_hist[b] = t->lat_hist[b];
+    out->lat_max_ns = t->lat_max_ns;
+    spin_unlock_irqrestore(&sched_lock, flags);
+    return 0;
+}
@@ -4,11 +4,83 @@
 #include <stdint.h>
 #include "../idt.h"
 
+// Room for one idle task per CPU plus kernel threads
+#define MAX_TASKS 16
+
+// Runnable-to-running latency histogram buckets:
+// <10us, <100us, <1ms, <10ms, <100ms, >=100ms
+#define SCHED_LAT_BUCKETS 6
+
+typedef struct {
+    const char* name;
+    char state;                  // 'R' running, 'W' waiting to run, 'B' blocked
+    int cpu;                     // CPU it runs or is queued on
+    uint64_t runtime_ns;
+    uint32_t switches;
+    uint32_t voluntary;
+    uint32_t involuntary;
+    uint32_t lat_hist[SCHED_LAT_BUCKETS];
+    uint64_t lat_max_ns;
+} sched_task_stats_t;
+
 void sched_init(void);
 
+// Turn the calling AP's boot context into that CPU's idle task and start
+// scheduling on it. Called by smp.c with interrupts disabled.
+void sched_start_ap(int cpu);
+
+// Called from irq_common_stub right after it switched stacks: the previous
+// task's stack is no longer in use and it may now run on another CPU.
+void sched_finish_switch(void);
+
 // Called from timer IRQ (IRQ0 / vector 32). May return a new regs pointer
 // (i.e., a different task's saved stack) to switch tasks on interrupt return.
 registers_t* sched_on_tick(registers_t* regs);
 
+// Called from the yield vector (int 0x81): always switches to another task.
+registers_t* sched_on_yield(registers_t* regs);
+
+// Absolute clock_ns() deadline at which the current slice expires
+// (~0 if no preemption is needed). Used to arm the tickless timer.
+uint64_t sched_next_event_ns(void);
+
+// Start a kernel thread on a caller-provided stack, queued on the least
+// loaded CPU. Returns task id or -1.
+int sched_create_task(const char* name, void (*entry)(void), uint32_t* stack, uint32_t stack_dwords);
+
+// Start a ring 3 task at entry with the given user stack pointer. kstack is
+// its ring 0 stack for interrupts and system calls. Code, data and stack
+// must be mapped user-accessible. Returns task id or -1.
+int sched_create_user_task(const char* name, uint32_t entry, uint32_t user_esp,
+                           uint32_t* kstack, uint32_t kstack_dwords);
+
+// End the calling task; its slot is freed once another task runs. Returns
+// (doing nothing) when called from an idle task or the boot context.
+void sched_exit(void);
+
+// Task running on the calling CPU.
+int sched_current_task(void);
+
+// Set by sched_wake(): switch at the next interrupt exit on this CPU.
+int sched_need_resched(void);
+
+// Give up the CPU for the rest of the slice.
+void sched_yield(void);
+
+// Block the calling task until sched_wake(). Call with interrupts disabled
+// after checking the wait condition; interrupts are still disabled when it
+// returns. A wakeup that races in from another CPU after the check makes it
+// return immediately, so callers must loop re-checking the condition.
+void sched_block(void);
+
+// Make a blocked task runnable on its CPU; it is preferred at the next switch.
+void sched_wake(int task_id);
+
+// Tasks taken from another CPU's run queue by an idle CPU.
+uint32_t sched_steal_count(void);
+
+// Snapshot one task's accounting. Returns -1 for an unused slot.
+int sched_get_stats(int task_id, sched_task_stats_t* out);
+
 #endif
 
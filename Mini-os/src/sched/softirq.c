@@ -0,0 +1,90 @@
+#include "softirq.h"
+#include "../idt.h"
+
+// Pending softirqs are re-checked a bounded number of times per interrupt
+// so an IRQ storm cannot starve tasks; leftovers run at the next IRQ exit.
+#define SOFTIRQ_RESTART_MAX 10
+
+static void (*handlers[SOFTIRQ_MAX])(void);
+static volatile uint32_t pending = 0;
+static volatile int in_softirq = 0;
+
+static tasklet_t* tasklet_head = 0;
+static tasklet_t* tasklet_tail = 0;
+
+static void tasklet_action(void) {
+    // Detach the whole list so tasklets may reschedule themselves.
+    uint32_t flags = irq_save();
+    tasklet_t* t = tasklet_head;
+    tasklet_head = 0;
+    tasklet_tail = 0;
+    irq_restore(flags);
+
+    while (t) {
+        tasklet_t* next = t->next;
+        t->next = 0;
+        t->scheduled = 0;
+        t->fn(t->arg);
+        t = next;
+    }
+}
+
+void softirq_init(void) {
+    for (int i = 0; i < SOFTIRQ_MAX; i++) handlers[i] = 0;
+    pending = 0;
+    in_softirq = 0;
+    tasklet_head = 0;
+    tasklet_tail = 0;
+    softirq_register(SOFTIRQ_TASKLET, tasklet_action);
+}
+
+void softirq_register(int nr, void (*handler)(void)) {
+    if (nr < 0 || nr >= SOFTIRQ_MAX) return;
+    handlers[nr] = handler;
+}
+
+void softirq_raise(int nr) {
+    if (nr < 0 || nr >= SOFTIRQ_MAX) return;
+    // Locked OR: timers may be added (and expire) from any CPU.
+    __sync_fetch_and_or(&pending, 1u << nr);
+}
+
+int softirq_run(void) {
+    if (in_softirq) return 0;
+    in_softirq = 1;
+
+    for (int round = 0; pending && round < SOFTIRQ_RESTART_MAX; round++) {
+        uint32_t work = __sync_lock_test_and_set(&pending, 0u);
+
+        irq_enable();
+        for (int nr = 0; nr < SOFTIRQ_MAX; nr++) {
+            if ((work & (1u << nr)) && handlers[nr]) {
+                handlers[nr]();
+            }
+        }
+        irq_disable();
+    }
+
+    in_softirq = 0;
+    return 1;
+}
+
+void tasklet_init(tasklet_t* t, void (*fn)(void* arg), void* arg) {
+    t->next = 0;
+    t->fn = fn;
+    t->arg = arg;
+    t->scheduled = 0;
+}
+
+void tasklet_schedule(tasklet_t* t) {
+    uint32_t flags = irq_save();
+    if (!t->scheduled) {
+        t->scheduled = 1;
+        t->next = 0;
+        if (tasklet_tail) tasklet_tail->next = t;
+        else tasklet_head = t;
+        tasklet_tail = t;
+        __sync_fetch_and_or(&pending, 1u << SOFTIRQ_TASKLET);
+    }
+    irq_restore(flags);
+}
@@ -0,0 +1,40 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+
+// Bottom halves: work raised by an IRQ top half and run from irq_handler
+// right after EOI, with interrupts enabled.
+
+typedef enum {
+    SOFTIRQ_TIMER = 0,      // expired timer-wheel callbacks
+    SOFTIRQ_KEYBOARD = 1,   // scancode translation
+    SOFTIRQ_TASKLET = 2,    // tasklet_schedule() queue
+    SOFTIRQ_MAX
+} softirq_nr_t;
+
+typedef struct tasklet {
+    struct tasklet* next;
+    void (*fn)(void* arg);
+    void* arg;
+    int scheduled;
+} tasklet_t;
+
+void softirq_init(void);
+void softirq_register(int nr, void (*handler)(void));
+
+// Mark a softirq pending. Safe from IRQ and task context.
+void softirq_raise(int nr);
+
+// Run pending softirqs. Called from irq_handler on the BSP only (device IRQs
+// are delivered there) with interrupts disabled; returns with them disabled.
+// Returns 0 if softirqs were already running further down this stack
+// (nested IRQ), in which case nothing was done.
+int softirq_run(void);
+
+// Queue a one-shot callback on SOFTIRQ_TASKLET (no-op if already queued).
+// BSP interrupt context only.
+void tasklet_init(tasklet_t* t, void (*fn)(void* arg), void* arg);
+void tasklet_schedule(tasklet_t* t);
+
+#endif
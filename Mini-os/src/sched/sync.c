@@ -0,0 +1,287 @@
+#include "sync.h"
+#include "../idt.h"
+#include "../drivers/clock.h"
+
+// Every initialized lock is linked into one registry so `lockstat` can walk
+// them. Counters are only touched while the lock itself (or, for mutexes
+// and semaphores, their wait-queue lock) is held.
+
+static inline uint32_t xchg(volatile uint32_t* p, uint32_t v) {
+    __asm__ __volatile__("xchgl %0, %1" : "+r"(v), "+m"(*p) : : "memory");
+    return v;
+}
+
+static inline void raw_lock(volatile uint32_t* lock) {
+    while (xchg(lock, 1) != 0) {
+        while (*lock) {
+            __asm__ __volatile__("pause");
+        }
+    }
+}
+
+static inline void raw_unlock(volatile uint32_t* lock) {
+    __asm__ __volatile__("" : : : "memory");
+    *lock = 0;
+}
+
+#if LOCK_STATS
+static lock_stats_t* stats_head = 0;
+static lock_stats_t* stats_tail = 0;
+static volatile uint32_t registry_lock = 0;
+#endif
+
+static void stats_register(lock_stats_t* st, const char* name) {
+    st->name = name;
+    st->acquired = 0;
+    st->contended = 0;
+    st->wait_ns = 0;
+    st->wait_max_ns = 0;
+#if LOCK_STATS
+    uint32_t flags = irq_save();
+    raw_lock(&registry_lock);
+    lock_stats_t* it = stats_head;
+    while (it && it != st) it = it->next;
+    if (!it) {
+        // Re-initializing a lock resets its counters but links it only once.
+        st->next = 0;
+        if (stats_tail) stats_tail->next = st;
+        else stats_head = st;
+        stats_tail = st;
+    }
+    raw_unlock(&registry_lock);
+    irq_restore(flags);
+#else
+    st->next = 0;
+#endif
+}
+
+#if LOCK_STATS
+static inline void stats_acquired(lock_stats_t* st, uint64_t wait_start) {
+    st->acquired++;
+    if (wait_start) {
+        uint64_t waited = clock_ns() - wait_start;
+        st->contended++;
+        st->wait_ns += waited;
+        if (waited > st->wait_max_ns) st->wait_max_ns = waited;
+    }
+}
+#define WAIT_START() clock_ns()
+#else
+#define stats_acquired(st, wait_start) ((void)(wait_start))
+#define WAIT_START() 1
+#endif
+
+// ---------------------------------------------------------------------------
+// Wait queues
+
+void wait_queue_init(wait_queue_t* wq) {
+    wq->lock = 0;
+    wq->head = 0;
+    wq->count = 0;
+}
+
+// The irqsave lock paths report their caller, not this file, to the
+// irqs-off tracer.
+uint32_t wait_queue_lock(wait_queue_t* wq) {
+    uint32_t flags = irq_save_notrace();
+    if (flags & EFLAGS_IF) trace_irqs_off_ip((uint32_t)(uintptr_t)__builtin_return_address(0));
+    raw_lock(&wq->lock);
+    return flags;
+}
+
+void wait_queue_unlock(wait_queue_t* wq, uint32_t flags) {
+    raw_unlock(&wq->lock);
+    if (flags & EFLAGS_IF) trace_irqs_on_ip((uint32_t)(uintptr_t)__builtin_return_address(0));
+    irq_restore_notrace(flags);
+}
+
+void wait_queue_sleep(wait_queue_t* wq) {
+    int self = sched_current_task();
+    int queued = 0;
+    for (int i = 0; i < wq->count; i++) {
+        if (wq->ids[(wq->head + i) % MAX_TASKS] == self) queued = 1;
+    }
+    if (!queued && wq->count < MAX_TASKS) {
+        wq->ids[(wq->head + wq->count) % MAX_TASKS] = (uint8_t)self;
+        wq->count++;
+    }
+
+    // A wakeup between unlock and block is not lost: sched_block()
+    // returns at once if the task was woken in the meantime.
+    raw_unlock(&wq->lock);
+    sched_block();
+    raw_lock(&wq->lock);
+}
+
+void wait_queue_remove(wait_queue_t* wq, int task_id) {
+    int kept = 0;
+    for (int i = 0; i < wq->count; i++) {
+        uint8_t id = wq->ids[(wq->head + i) % MAX_TASKS];
+        if (id == task_id) continue;
+        wq->ids[(wq->head + kept) % MAX_TASKS] = id;
+        kept++;
+    }
+    wq->count = (uint8_t)kept;
+}
+
+int wait_queue_wake_one(wait_queue_t* wq) {
+    if (wq->count == 0) return -1;
+    int id = wq->ids[wq->head];
+    wq->head = (uint8_t)((wq->head + 1) % MAX_TASKS);
+    wq->count--;
+    sched_wake(id);
+    return id;
+}
+
+void wait_queue_wake_all(wait_queue_t* wq) {
+    while (wait_queue_wake_one(wq) >= 0) {
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Spinlocks
+
+void spin_lock_init(spinlock_t* lock, const char* name) {
+    lock->locked = 0;
+    stats_register(&lock->stats, name);
+}
+
+void spin_lock(spinlock_t* lock) {
+    uint64_t wait_start = 0;
+    if (xchg(&lock->locked, 1) != 0) {
+        wait_start = WAIT_START();
+        do {
+            while (lock->locked) {
+                __asm__ __volatile__("pause");
+            }
+        } while (xchg(&lock->locked, 1) != 0);
+    }
+    stats_acquired(&lock->stats, wait_start);
+}
+
+void spin_unlock(spinlock_t* lock) {
+    raw_unlock(&lock->locked);
+}
+
+uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_save_notrace();
+    if (flags & EFLAGS_IF) trace_irqs_off_ip((uint32_t)(uintptr_t)__builtin_return_address(0));
+    spin_lock(lock);
+    return flags;
+}
+
+void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    if (flags & EFLAGS_IF) trace_irqs_on_ip((uint32_t)(uintptr_t)__builtin_return_address(0));
+    irq_restore_notrace(flags);
+}
+
+// ---------------------------------------------------------------------------
+// Mutexes
+
+void mutex_init(mutex_t* m, const char* name) {
+    m->locked = 0;
+    m->owner = -1;
+    wait_queue_init(&m->waiters);
+    stats_register(&m->stats, name);
+}
+
+void mutex_lock(mutex_t* m) {
+    int self = sched_current_task();
+    uint32_t flags = wait_queue_lock(&m->waiters);
+    uint64_t wait_start = 0;
+    if (m->locked) {
+        wait_start = WAIT_START();
+        while (m->locked) {
+            wait_queue_sleep(&m->waiters);
+        }
+        wait_queue_remove(&m->waiters, self);
+    }
+    m->locked = 1;
+    m->owner = self;
+    stats_acquired(&m->stats, wait_start);
+    wait_queue_unlock(&m->waiters, flags);
+}
+
+int mutex_trylock(mutex_t* m) {
+    int self = sched_current_task();
+    uint32_t flags = wait_queue_lock(&m->waiters);
+    int ok = !m->locked;
+    if (ok) {
+        m->locked = 1;
+        m->owner = self;
+        stats_acquired(&m->stats, 0);
+    }
+    wait_queue_unlock(&m->waiters, flags);
+    return ok;
+}
+
+void mutex_unlock(mutex_t* m) {
+    uint32_t flags = wait_queue_lock(&m->waiters);
+    m->locked = 0;
+    m->owner = -1;
+    wait_queue_wake_one(&m->waiters);
+    wait_queue_unlock(&m->waiters, flags);
+}
+
+// ---------------------------------------------------------------------------
+// Counting semaphores
+
+void sem_init(semaphore_t* s, int count, const char* name) {
+    s->count = count;
+    wait_queue_init(&s->waiters);
+    stats_register(&s->stats, name);
+}
+
+void sem_down(semaphore_t* s) {
+    int self = sched_current_task();
+    uint32_t flags = wait_queue_lock(&s->waiters);
+    uint64_t wait_start = 0;
+    if (s->count <= 0) {
+        wait_start = WAIT_START();
+        while (s->count <= 0) {
+            wait_queue_sleep(&s->waiters);
+        }
+        wait_queue_remove(&s->waiters, self);
+    }
+    s->count--;
+    stats_acquired(&s->stats, wait_start);
+    wait_queue_unlock(&s->waiters, flags);
+}
+
+int sem_trydown(semaphore_t* s) {
+    uint32_t flags = wait_queue_lock(&s->waiters);
+    int ok = (s->count > 0);
+    if (ok) {
+        s->count--;
+        stats_acquired(&s->stats, 0);
+    }
+    wait_queue_unlock(&s->waiters, flags);
+    return ok;
+}
+
+void sem_up(semaphore_t* s) {
+    uint32_t flags = wait_queue_lock(&s->waiters);
+    s->count++;
+    wait_queue_wake_one(&s->waiters);
+    wait_queue_unlock(&s->waiters, flags);
+}
+
+// ---------------------------------------------------------------------------
+
+int lock_stats_get(int index, lock_stats_t* out) {
+#if !LOCK_STATS
+    (void)index;
+    (void)out;
+    return -1;
+#else
+    uint32_t flags = irq_save();
+    raw_lock(&registry_lock);
+    lock_stats_t* st = stats_head;
+    while (st && index-- > 0) st = st->next;
+    if (st) *out = *st;
+    raw_unlock(&registry_lock);
+    irq_restore(flags);
+    return st ? 0 : -1;
+#endif
+}
@@ -0,0 +1,96 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+#include "sched.h"
+
+// Kernel synchronization primitives.
+// Spinlocks disable interrupts on the local CPU and busy-wait; use them for
+// short sections that may be entered from IRQ context. Mutexes and
+// semaphores sleep on a wait queue and may only be taken in task context.
+
+// Build with -DLOCK_STATS=0 to compile out acquire/contention accounting.
+#ifndef LOCK_STATS
+#define LOCK_STATS 1
+#endif
+
+typedef struct lock_stats {
+    const char* name;
+    uint32_t acquired;       // total acquisitions
+    uint32_t contended;      // acquisitions that had to wait
+    uint64_t wait_ns;        // total time spent waiting
+    uint64_t wait_max_ns;
+    struct lock_stats* next; // registry link (see lock_stats_get)
+} lock_stats_t;
+
+// FIFO of sleeping task ids, guarded by its own lock. Mutexes and
+// semaphores keep their state under the same lock.
+typedef struct {
+    volatile uint32_t lock;
+    uint8_t ids[MAX_TASKS];
+    uint8_t head;
+    uint8_t count;
+} wait_queue_t;
+
+typedef struct {
+    volatile uint32_t locked;
+    lock_stats_t stats;
+} spinlock_t;
+
+// All three are usable zero-initialized (unlocked / count 0); the *_init
+// calls additionally register them for lock statistics.
+typedef struct {
+    volatile int locked;
+    int owner;               // task id while locked
+    wait_queue_t waiters;
+    lock_stats_t stats;
+} mutex_t;
+
+typedef struct {
+    volatile int count;
+    wait_queue_t waiters;
+    lock_stats_t stats;
+} semaphore_t;
+
+void wait_queue_init(wait_queue_t* wq);
+
+// Take/release the queue lock (interrupts disabled while held).
+uint32_t wait_queue_lock(wait_queue_t* wq);
+void wait_queue_unlock(wait_queue_t* wq, uint32_t flags);
+
+// The rest require the queue lock.
+
+// Queue the current task and block until woken. Call after checking the
+// wait condition; the lock is dropped while blocked and re-taken before
+// returning, so re-check the condition on return.
+void wait_queue_sleep(wait_queue_t* wq);
+
+// Drop a task from the queue (once it stops waiting).
+void wait_queue_remove(wait_queue_t* wq, int task_id);
+
+// Wake the longest waiter. Returns its task id, or -1 if the queue was empty.
+int wait_queue_wake_one(wait_queue_t* wq);
+void wait_queue_wake_all(wait_queue_t* wq);
+
+void spin_lock_init(spinlock_t* lock, const char* name);
+uint32_t spin_lock_irqsave(spinlock_t* lock);
+void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags);
+
+// For callers that already run with interrupts disabled.
+void spin_lock(spinlock_t* lock);
+void spin_unlock(spinlock_t* lock);
+
+void mutex_init(mutex_t* m, const char* name);
+void mutex_lock(mutex_t* m);
+int mutex_trylock(mutex_t* m);   // 1 if acquired
+void mutex_unlock(mutex_t* m);
+
+void sem_init(semaphore_t* s, int count, const char* name);
+void sem_down(semaphore_t* s);
+int sem_trydown(semaphore_t* s); // 1 if acquired
+void sem_up(semaphore_t* s);
+
+// Snapshot the index-th registered lock's counters. Returns -1 past the end.
+int lock_stats_get(int index, lock_stats_t* out);
+
+#endif
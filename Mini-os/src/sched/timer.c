@@ -0,0 +1,341 @@
+#include "timer.h"
+#include "../idt.h"
+#include "../drivers/clock.h"
+#include "../drivers/pit.h"
+#include "sched.h"
+#include "softirq.h"
+#include "sync.h"
+
+// Hierarchical timing wheel (classic tv1..tv4 layout).
+// Level 0 has 256 slots of one wheel jiffy (2^20 ns, ~1.05 ms). Each upper
+// level has 64 slots covering 64x the span of the level below; their slots
+// are cascaded down whenever level 0 wraps. Insert and cancel are O(1):
+// a timer goes straight into the slot for its deadline and unlinks itself
+// through its pprev pointer.
+
+#define TIMER_RES_SHIFT 20
+#define TVR_BITS   8
+#define TVN_BITS   6
+#define TVR_SIZE   (1 << TVR_BITS)
+#define TVN_SIZE   (1 << TVN_BITS)
+#define TVR_MASK   (TVR_SIZE - 1)
+#define TVN_MASK   (TVN_SIZE - 1)
+#define TVN_LEVELS 3
+#define WHEEL_SPAN (1ull << (TVR_BITS + TVN_LEVELS * TVN_BITS))
+
+typedef enum {
+    TIMER_FREE = 0,
+    TIMER_PENDING = 1,   // linked into a wheel slot
+    TIMER_EXPIRED = 2,   // waiting on the expired list for deferred run
+} timer_state_t;
+
+typedef struct ktimer {
+    struct ktimer* next;
+    struct ktimer** pprev;
+    struct ktimer** slot;
+    uint64_t expires;
+    timer_fn_t fn;
+    void* arg;
+    uint16_t gen;
+    uint8_t state;
+} ktimer_t;
+
+static ktimer_t pool[TIMER_MAX];
+static ktimer_t* free_list = 0;
+
+static ktimer_t* tv1[TVR_SIZE];
+static ktimer_t* tvn[TVN_LEVELS][TVN_SIZE];
+static uint32_t tv1_bitmap[TVR_SIZE / 32];
+static ktimer_t* expired_list = 0;
+
+static uint64_t wheel_jiffy = 0;   // next jiffy the wheel has not finished
+static int wheel_count = 0;
+static int tv1_count = 0;          // pending timers in level 0; the rest are in tvn
+
+// Guards the wheel, the pool and PIT reprogramming (any CPU may add timers)
+static spinlock_t timer_lock;
+
+static void list_add(ktimer_t** slot, ktimer_t* t) {
+    t->next = *slot;
+    if (t->next) t->next->pprev = &t->next;
+    *slot = t;
+    t->pprev = slot;
+    t->slot = slot;
+}
+
+static void list_del(ktimer_t* t) {
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+
+    // Keep the level-0 occupancy bitmap exact for next-deadline scans.
+    if (t->slot >= &tv1[0] && t->slot < &tv1[TVR_SIZE]) {
+        tv1_count--;
+        if (*t->slot == 0) {
+            uint32_t idx = (uint32_t)(t->slot - &tv1[0]);
+            tv1_bitmap[idx / 32] &= ~(1u << (idx % 32));
+        }
+    }
+    t->next = 0;
+    t->pprev = 0;
+    t->slot = 0;
+}
+
+static void internal_add(ktimer_t* t) {
+    uint64_t tj = t->expires >> TIMER_RES_SHIFT;
+    if (tj < wheel_jiffy) tj = wheel_jiffy;
+    uint64_t delta = tj - wheel_jiffy;
+
+    ktimer_t** slot;
+    if (delta < TVR_SIZE) {
+        uint32_t idx = (uint32_t)tj & TVR_MASK;
+        slot = &tv1[idx];
+        tv1_bitmap[idx / 32] |= 1u << (idx % 32);
+        tv1_count++;
+    } else if (delta < (1ull << (TVR_BITS + TVN_BITS))) {
+        slot = &tvn[0][(uint32_t)(tj >> TVR_BITS) & TVN_MASK];
+    } else if (delta < (1ull << (TVR_BITS + 2 * TVN_BITS))) {
+        slot = &tvn[1][(uint32_t)(tj >> (TVR_BITS + TVN_BITS)) & TVN_MASK];
+    } else {
+        // Clamp very long timeouts to the top of the wheel; they cascade
+        // down again and are re-checked against their real deadline.
+        if (delta >= WHEEL_SPAN) tj = wheel_jiffy + WHEEL_SPAN - 1;
+        slot = &tvn[2][(uint32_t)(tj >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK];
+    }
+    list_add(slot, t);
+}
+
+// Re-insert every timer of one upper-level slot; returns the slot index.
+static uint32_t cascade(int level, uint32_t idx) {
+    ktimer_t* t = tvn[level][idx];
+    tvn[level][idx] = 0;
+    while (t) {
+        ktimer_t* next = t->next;
+        internal_add(t);
+        t = next;
+    }
+    return idx;
+}
+
+static void expire(ktimer_t* t) {
+    list_del(t);
+    wheel_count--;
+    t->state = TIMER_EXPIRED;
+    list_add(&expired_list, t);
+    softirq_raise(SOFTIRQ_TIMER);
+}
+
+void timer_init(void) {
+    spin_lock_init(&timer_lock, "timer");
+    free_list = 0;
+    for (int i = TIMER_MAX - 1; i >= 0; i--) {
+        pool[i].state = TIMER_FREE;
+        pool[i].gen = 0;
+        pool[i].next = free_list;
+        free_list = &pool[i];
+    }
+    for (int i = 0; i < TVR_SIZE; i++) tv1[i] = 0;
+    for (int l = 0; l < TVN_LEVELS; l++) {
+        for (int i = 0; i < TVN_SIZE; i++) tvn[l][i] = 0;
+    }
+    for (int i = 0; i < TVR_SIZE / 32; i++) tv1_bitmap[i] = 0;
+    expired_list = 0;
+    wheel_count = 0;
+    tv1_count = 0;
+    wheel_jiffy = clock_ns() >> TIMER_RES_SHIFT;
+    softirq_register(SOFTIRQ_TIMER, timer_run_expired);
+}
+
+static uint64_t next_deadline_locked(void);
+static void reprogram_locked(void);
+
+int timer_add(uint64_t deadline_ns, timer_fn_t fn, void* arg) {
+    if (!fn) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    ktimer_t* t = free_list;
+    if (!t) {
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return -1;
+    }
+    free_list = t->next;
+
+    t->expires = deadline_ns;
+    t->fn = fn;
+    t->arg = arg;
+    t->state = TIMER_PENDING;
+    internal_add(t);
+    wheel_count++;
+
+    int handle = ((int)t->gen << 16) | (int)(t - pool);
+
+    // A tickless PIT may be armed far past this deadline; pull it in.
+    if (pit_is_tickless() && deadline_ns < pit_next_event_ns()) {
+        reprogram_locked();
+    }
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return handle;
+}
+
+static void release(ktimer_t* t) {
+    t->state = TIMER_FREE;
+    t->gen = (uint16_t)((t->gen + 1) & 0x7FFF);
+    t->next = free_list;
+    free_list = t;
+}
+
+int timer_cancel(int handle) {
+    if (handle < 0) return -1;
+    uint32_t idx = (uint32_t)handle & 0xFFFF;
+    uint16_t gen = (uint16_t)((uint32_t)handle >> 16);
+    if (idx >= TIMER_MAX) return -1;
+
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    ktimer_t* t = &pool[idx];
+    if (t->gen != gen || t->state == TIMER_FREE) {
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return -1;
+    }
+    if (t->state == TIMER_PENDING) wheel_count--;
+    list_del(t);
+    release(t);
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return 0;
+}
+
+void timer_on_tick(void) {
+    spin_lock(&timer_lock);
+    uint64_t now = clock_ns();
+    uint64_t now_jiffy = now >> TIMER_RES_SHIFT;
+
+    if (wheel_count == 0) {
+        // Nothing to cascade; jump straight to the present.
+        if (now_jiffy > wheel_jiffy) wheel_jiffy = now_jiffy;
+        spin_unlock(&timer_lock);
+        return;
+    }
+
+    for (;;) {
+        uint32_t idx = (uint32_t)wheel_jiffy & TVR_MASK;
+
+        // Expire what is due. In the current jiffy the rest stays put (sub-
+        // jiffy accuracy); in a past jiffy only clamped long timers can be
+        // left, and they go back up the wheel.
+        ktimer_t* t = tv1[idx];
+        while (t) {
+            ktimer_t* next = t->next;
+            if (t->expires <= now) {
+                expire(t);
+            } else if (wheel_jiffy < now_jiffy) {
+                list_del(t);
+                internal_add(t);
+            }
+            t = next;
+        }
+        if (wheel_jiffy >= now_jiffy) break;
+
+        wheel_jiffy++;
+        idx = (uint32_t)wheel_jiffy & TVR_MASK;
+        if (idx == 0 &&
+            cascade(0, (uint32_t)(wheel_jiffy >> TVR_BITS) & TVN_MASK) == 0 &&
+            cascade(1, (uint32_t)(wheel_jiffy >> (TVR_BITS + TVN_BITS)) & TVN_MASK) == 0) {
+            cascade(2, (uint32_t)(wheel_jiffy >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK);
+        }
+    }
+    spin_unlock(&timer_lock);
+}
+
+void timer_run_expired(void) {
+    for (;;) {
+        uint32_t flags = spin_lock_irqsave(&timer_lock);
+        ktimer_t* t = expired_list;
+        if (!t) {
+            spin_unlock_irqrestore(&timer_lock, flags);
+            return;
+        }
+        list_del(t);
+        timer_fn_t fn = t->fn;
+        void* arg = t->arg;
+        release(t);
+        spin_unlock_irqrestore(&timer_lock, flags);
+
+        fn(arg);
+    }
+}
+
+static uint64_t next_deadline_locked(void) {
+    uint64_t deadline = ~0ull;
+
+    if (expired_list) {
+        deadline = 0;
+    } else if (wheel_count > 0) {
+        // First occupied level-0 slot at or after the wheel position.
+        uint32_t start = (uint32_t)wheel_jiffy & TVR_MASK;
+        for (uint32_t i = 0; i < TVR_SIZE; i++) {
+            uint32_t idx = (start + i) & TVR_MASK;
+            if (tv1_bitmap[idx / 32] == 0 && (idx % 32) == 0 && i + 32 <= TVR_SIZE) {
+                i += 31;
+                continue;
+            }
+            if (tv1_bitmap[idx / 32] & (1u << (idx % 32))) {
+                for (ktimer_t* t = tv1[idx]; t; t = t->next) {
+                    if (t->expires < deadline) deadline = t->expires;
+                }
+                break;
+            }
+        }
+        // Level 0 is placed by delta, so it can hold timers past the next
+        // cascade while an upper level holds some due right after it: with
+        // anything above level 0, wake for the cascade at the latest.
+        if (wheel_count > tv1_count) {
+            uint64_t cascade_ns = ((wheel_jiffy | TVR_MASK) + 1) << TIMER_RES_SHIFT;
+            if (cascade_ns < deadline) deadline = cascade_ns;
+        }
+    }
+    return deadline;
+}
+
+uint64_t timer_next_deadline_ns(void) {
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    uint64_t deadline = next_deadline_locked();
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return deadline;
+}
+
+// Lock order: timer_lock, then sched_lock (taken by sched_next_event_ns).
+static void reprogram_locked(void) {
+    uint64_t next = sched_next_event_ns();
+    uint64_t timer_next = next_deadline_locked();
+    pit_program_next_event(timer_next < next ? timer_next : next);
+}
+
+void timer_reprogram(void) {
+    if (!pit_is_tickless()) return;
+
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    reprogram_locked();
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+static void sleep_wake(void* arg) {
+    sched_wake((int)(uintptr_t)arg);
+}
+
+void timer_sleep_ns(uint64_t ns) {
+    uint64_t deadline = clock_ns() + ns;
+    int task = sched_current_task();
+
+    uint32_t flags = irq_save();
+    int handle = timer_add(deadline, sleep_wake, (void*)(uintptr_t)task);
+    if (handle < 0) {
+        // Pool exhausted: fall back to spinning.
+        irq_restore(flags);
+        while (clock_ns() < deadline) sched_yield();
+        return;
+    }
+    // Other wakeups (e.g. queue_work on kworker) may end the block early.
+    while (clock_ns() < deadline) {
+        sched_block();
+    }
+    timer_cancel(handle);
+    irq_restore(flags);
+}
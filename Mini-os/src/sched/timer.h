@@ -0,0 +1,40 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Kernel timers on a hierarchical timing wheel.
+// Deadlines are absolute clock_ns() values. Callbacks run from
+// SOFTIRQ_TIMER (after EOI, interrupts enabled), never inside the IRQ0 top
+// half. Call after softirq_init().
+
+#define TIMER_MAX 64
+
+typedef void (*timer_fn_t)(void* arg);
+
+void timer_init(void);
+
+// Arm a one-shot timer. Returns a handle for timer_cancel(), or -1 if the
+// timer pool is exhausted.
+int timer_add(uint64_t deadline_ns, timer_fn_t fn, void* arg);
+
+// Disarm a pending timer. Returns 0 on success, -1 if it already fired.
+int timer_cancel(int handle);
+
+// Called from pit_on_tick(): advance the wheel and collect expired timers.
+void timer_on_tick(void);
+
+// Run callbacks collected by timer_on_tick(). SOFTIRQ_TIMER handler.
+void timer_run_expired(void);
+
+// Earliest clock_ns() at which the wheel needs attention (~0 if idle).
+uint64_t timer_next_deadline_ns(void);
+
+// Block the calling task for at least ns nanoseconds (task context only).
+void timer_sleep_ns(uint64_t ns);
+
+// Arm the tickless timer for the earlier of slice expiry and the next
+// timer deadline. No-op with a periodic tick.
+void timer_reprogram(void);
+
+#endif
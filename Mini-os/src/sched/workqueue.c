@@ -0,0 +1,63 @@
+#include "workqueue.h"
+#include "sched.h"
+#include "sync.h"
+
+#define KWORKER_STACK_DWORDS 4096 // 16 KiB
+
+static uint32_t kworker_stack[KWORKER_STACK_DWORDS];
+static int kworker_task = -1;
+
+static work_t* work_head = 0;
+static work_t* work_tail = 0;
+static spinlock_t work_lock;
+
+__attribute__((noreturn)) static void kworker_main(void) {
+    for (;;) {
+        uint32_t flags = spin_lock_irqsave(&work_lock);
+        while (!work_head) {
+            // sched_block() must not be entered holding a spinlock.
+            spin_unlock(&work_lock);
+            sched_block();
+            spin_lock(&work_lock);
+        }
+        work_t* w = work_head;
+        work_head = w->next;
+        if (!work_head) work_tail = 0;
+        w->next = 0;
+        w->queued = 0;
+        spin_unlock_irqrestore(&work_lock, flags);
+
+        w->fn(w->arg);
+    }
+}
+
+void workqueue_init(void) {
+    spin_lock_init(&work_lock, "workq");
+    work_head = 0;
+    work_tail = 0;
+    kworker_task = sched_create_task("kworker", kworker_main, kworker_stack, KWORKER_STACK_DWORDS);
+}
+
+void work_init(work_t* w, void (*fn)(void* arg), void* arg) {
+    w->next = 0;
+    w->fn = fn;
+    w->arg = arg;
+    w->queued = 0;
+}
+
+int queue_work(work_t* w) {
+    uint32_t flags = spin_lock_irqsave(&work_lock);
+    if (w->queued) {
+        spin_unlock_irqrestore(&work_lock, flags);
+        return 0;
+    }
+    w->queued = 1;
+    w->next = 0;
+    if (work_tail) work_tail->next = w;
+    else work_head = w;
+    work_tail = w;
+    spin_unlock_irqrestore(&work_lock, flags);
+
+    sched_wake(kworker_task);
+    return 1;
+}
@@ -0,0 +1,25 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+
+// Kernel workqueue: a dedicated kernel thread (kworker) runs queued work
+// items in task context, so they may take time, draw, or block.
+
+typedef struct work {
+    struct work* next;
+    void (*fn)(void* arg);
+    void* arg;
+    int queued;
+} work_t;
+
+// Start the kworker thread. Call after sched_init().
+void workqueue_init(void);
+
+void work_init(work_t* w, void (*fn)(void* arg), void* arg);
+
+// Queue a work item and wake kworker. Safe from IRQ/softirq context.
+// Returns 0 if the item was already queued.
+int queue_work(work_t* w);
+
+#endif
@@ -1,8 +1,22 @@
 #include "commands.h"
+#include "../idt.h"
 #include "../graphic/vbe.h"
+#include "../graphic/console.h"
 #include "../fs/filesystem.h"
 #include "../drivers/rtc.h"
 #include "../drivers/keyboard.h"
+#include "../drivers/clock.h"
+#include "../drivers/pit.h"
+#include "../sched/sched.h"
+#include "../sched/timer.h"
+#include "../sched/sync.h"
+#include "../sched/irqsoff.h"
+#include "../kernel/smp.h"
+#include "../kernel/usermode.h"
+#include "../syscall/uring.h"
+#include "../syscall/systrace.h"
+#include "../drivers/ata.h"
+#include "../fs/bcache.h"
 #include "shell.h"
 
 // Global command variables
@@ -26,7 +40,7 @@ void shell_reset_exit(void) {
 // Forward declarations
 void shell_print(const char *text, uint32_t color);
 void shell_new_line(void);
-void shell_change_directory(const char *path);
+int shell_change_directory(const char *path);
 extern shell_t shell;
 
 // String comparison helper
@@ -35,11 +49,47 @@ static int str_equal(const char *s1, const char *s2) {
     return (*s1 == '\0' && *s2 == '\0');
 }
 
+// Append a string, padded with spaces to width (0 = no padding)
+static int append_str(char *buf, int pos, const char *s, int width) {
+    int len = 0;
+    while (s[len]) buf[pos++] = s[len++];
+    while (len++ < width) buf[pos++] = ' ';
+    buf[pos] = '\0';
+    return pos;
+}
+
+// Append an unsigned number, right-aligned to width (0 = no padding)
+static int append_uint(char *buf, int pos, uint32_t value, int width) {
+    char tmp[12];
+    int len = 0;
+    do {
+        tmp[len++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (width-- > len) buf[pos++] = ' ';
+    while (len > 0) buf[pos++] = tmp[--len];
+    buf[pos] = '\0';
+    return pos;
+}
+
+// Append a value as 8 hex digits with a 0x prefix, right-aligned to width
+static int append_hex(char *buf, int pos, uint32_t value, int width) {
+    static const char digits[] = "0123456789abcdef";
+    while (width-- > 10) buf[pos++] = ' ';
+    buf[pos++] = '0';
+    buf[pos++] = 'x';
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        buf[pos++] = digits[(value >> shift) & 0xF];
+    }
+    buf[pos] = '\0';
+    return pos;
+}
+
 // Display available commands
 void cmd_help(void) {
     shell_print("Available commands:\n", vbe_rgb(255, 255, 0));
-    shell_print("  help, clear, ls, cd, pwd, create, write, read, echo\n", vbe_rgb(255, 255, 0));
-    shell_print("  delete, whoami, hostname, date, uname, exit\n", vbe_rgb(255, 255, 0));
+    shell_print("  help, clear, ls, cd, pwd, mkdir, create, write,\n", vbe_rgb(255, 255, 0));
+    shell_print("  append, read, echo, delete, whoami, hostname, date,\n  uname, top, lockstat, irqstat, irqbench, irqsoff, sysbench,\n  uringbench, ttyecho, sysstat, strace, disk, exit\n", vbe_rgb(255, 255, 0));
 }
 
 // Clear shell screen
@@ -47,10 +97,15 @@ void cmd_clear(void) {
     shell_clear_screen();
 }
 
-// List files in filesystem
+// List files in a directory (default: the current one)
 void cmd_ls(void) {
     char file_list[512];
-    fs_list_files(file_list);
+    if (fs_list_files(cmd_arg1, file_list, sizeof(file_list)) < 0) {
+        shell_print("No such directory: ", vbe_rgb(255, 0, 0));
+        shell_print(cmd_arg1, vbe_rgb(255, 255, 255));
+        shell_print("\n", vbe_rgb(255, 255, 255));
+        return;
+    }
     shell_print(file_list, vbe_rgb(255, 255, 255));
     shell_print("\n", vbe_rgb(255, 255, 255));
 }
@@ -58,8 +113,13 @@ void cmd_ls(void) {
 // Change current directory
 void cmd_cd(void) {
     if (cmd_arg1[0] != '\0') {
-        shell_change_directory(cmd_arg1);
-        shell_print("Directory changed\n", vbe_rgb(0, 255, 0));
+        if (shell_change_directory(cmd_arg1) == 0) {
+            shell_print("Directory changed\n", vbe_rgb(0, 255, 0));
+        } else {
+            shell_print("No such directory: ", vbe_rgb(255, 0, 0));
+            shell_print(cmd_arg1, vbe_rgb(255, 255, 255));
+            shell_print("\n", vbe_rgb(255, 255, 255));
+        }
     } else {
         shell_change_directory("~");
         shell_print("Changed to home directory\n", vbe_rgb(0, 255, 0));
@@ -72,6 +132,21 @@ void cmd_pwd(void) {
     shell_print("\n", vbe_rgb(255, 255, 255));
 }
 
+// Create new directory
+void cmd_mkdir(void) {
+    if (cmd_arg1[0] != '\0') {
+        if (fs_mkdir(cmd_arg1) >= 0) {
+            shell_print("Directory created: ", vbe_rgb(0, 255, 0));
+            shell_print(cmd_arg1, vbe_rgb(255, 255, 255));
+            shell_print("\n", vbe_rgb(255, 255, 255));
+        } else {
+            shell_print("Error creating directory\n", vbe_rgb(255, 0, 0));
+        }
+    } else {
+        shell_print("Usage: mkdir <path>\n", vbe_rgb(255, 0, 0));
+    }
+}
+
 // Create new file
 void cmd_create(void) {
     if (cmd_arg1[0] != '\0') {
@@ -102,16 +177,46 @@ void cmd_write(void) {
     }
 }
 
+// Append content to file
+void cmd_append(void) {
+    if (cmd_arg1[0] != '\0' && cmd_arg2[0] != '\0') {
+        if (fs_append_file(cmd_arg1, cmd_arg2) >= 0) {
+            shell_print("Content appended to: ", vbe_rgb(0, 255, 0));
+            shell_print(cmd_arg1, vbe_rgb(255, 255, 255));
+            shell_print("\n", vbe_rgb(255, 255, 255));
+        } else {
+            shell_print("Error appending to file\n", vbe_rgb(255, 0, 0));
+        }
+    } else {
+        shell_print("Usage: append <filename> <content>\n", vbe_rgb(255, 0, 0));
+    }
+}
+
 // Read file content
 void cmd_read(void) {
     if (cmd_arg1[0] != '\0') {
-        char content[1024];
-        int result = fs_read_file(cmd_arg1, content);
-        if (result >= 0) {
+        int self = sched_current_task();
+        int fd = fs_open(cmd_arg1, FS_O_RDONLY, self);
+        if (fd >= 0) {
             shell_new_line();
             shell_print("File content: ", vbe_rgb(0, 255, 255));
             shell_new_line();
-            shell_print(content, vbe_rgb(255, 255, 255));
+
+            // Read-only files print in place; others stream in chunks
+            // rather than sizing a buffer for the file
+            uint32_t size;
+            const char* data = (const char*)fs_map(fd, &size, self);
+            if (data) {
+                console_write(data, (int)size, vbe_rgb(255, 255, 255));
+            } else {
+                char content[256];
+                int n;
+                while ((n = fs_read(fd, content, sizeof(content) - 1, self)) > 0) {
+                    content[n] = '\0';
+                    shell_print(content, vbe_rgb(255, 255, 255));
+                }
+            }
+            fs_close(fd, self);
             shell_new_line();
         } else {
             shell_print("File not found: ", vbe_rgb(255, 0, 0));
@@ -222,9 +327,560 @@ void cmd_exit(void) {
     shell_print("Returning to boot menu...\n", vbe_rgb(255, 255, 0));
     
     // Short delay to show message
-    for (volatile int i = 0; i < 1000000; i++);
+    udelay(300000);
     
     // Set exit flag
     keyboard_set_shell_input(0);
     should_exit = 1;
-}
\ No newline at end of file
+}
+
+// Per-task CPU usage and scheduling latency, refreshed until a key is pressed
+void cmd_top(void) {
+    extern int g_heap_ok;
+    const uint32_t refresh_ms = 1000;
+    uint64_t prev_runtime[MAX_TASKS] = {0};
+    uint64_t prev_time = clock_ns();
+    char line[96];
+
+    keyboard_flush_scancodes();
+    for (int pass = 0; ; pass++) {
+        uint64_t now = clock_ns();
+        uint32_t interval_us = (uint32_t)div_u64_u32(now - prev_time, 1000u);
+        prev_time = now;
+
+        shell_clear_screen();
+        shell_print("top - press any key to quit    heap: ", vbe_rgb(255, 255, 0));
+        shell_print(g_heap_ok ? "ok\n" : "fail\n", g_heap_ok ? vbe_rgb(0, 255, 0) : vbe_rgb(255, 0, 0));
+        int pos = append_str(line, 0, "CPUs:", 0);
+        pos = append_uint(line, pos, (uint32_t)smp_cpu_count(), 2);
+        pos = append_str(line, pos, "    steals:", 0);
+        pos = append_uint(line, pos, sched_steal_count(), 6);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, vbe_rgb(255, 255, 0));
+        shell_print("ID NAME     S C CPU%   RUN_MS    SW   VOL INVOL\n", vbe_rgb(0, 255, 255));
+
+        sched_task_stats_t st[MAX_TASKS];
+        int valid[MAX_TASKS];
+        for (int id = 0; id < MAX_TASKS; id++) {
+            valid[id] = (sched_get_stats(id, &st[id]) == 0);
+            if (!valid[id]) continue;
+
+            uint64_t delta = st[id].runtime_ns - prev_runtime[id];
+            prev_runtime[id] = st[id].runtime_ns;
+            uint32_t cpu = 0;
+            if (pass > 0 && interval_us > 0) {
+                cpu = (uint32_t)div_u64_u32(div_u64_u32(delta, 1000u) * 100u, interval_us);
+            }
+
+            int pos = 0;
+            pos = append_uint(line, pos, (uint32_t)id, 2);
+            pos = append_str(line, pos, " ", 0);
+            pos = append_str(line, pos, st[id].name, 8);
+            line[pos++] = ' ';
+            line[pos++] = st[id].state;
+            pos = append_uint(line, pos, (uint32_t)st[id].cpu, 2);
+            pos = append_uint(line, pos, cpu, 5);
+            pos = append_uint(line, pos, (uint32_t)div_u64_u32(st[id].runtime_ns, 1000000u), 9);
+            pos = append_uint(line, pos, st[id].switches, 6);
+            pos = append_uint(line, pos, st[id].voluntary, 6);
+            pos = append_uint(line, pos, st[id].involuntary, 6);
+            append_str(line, pos, "\n", 0);
+            shell_print(line, vbe_rgb(255, 255, 255));
+        }
+
+        shell_print("\nRun latency  <10u <100u  <1m <10m<100m >100m  MAXus\n", vbe_rgb(0, 255, 255));
+        for (int id = 0; id < MAX_TASKS; id++) {
+            if (!valid[id] || id == 0) continue;
+            int pos = 0;
+            pos = append_uint(line, pos, (uint32_t)id, 2);
+            pos = append_str(line, pos, " ", 0);
+            pos = append_str(line, pos, st[id].name, 9);
+            for (int b = 0; b < SCHED_LAT_BUCKETS; b++) {
+                pos = append_uint(line, pos, st[id].lat_hist[b], 5);
+            }
+            pos = append_uint(line, pos, (uint32_t)div_u64_u32(st[id].lat_max_ns, 1000u), 7);
+            append_str(line, pos, "\n", 0);
+            shell_print(line, vbe_rgb(255, 255, 255));
+        }
+
+        // Sleep until the next refresh, checking for a key every 50ms.
+        for (uint32_t waited = 0; waited < refresh_ms; waited += 50) {
+            if (keyboard_scancode_available()) {
+                keyboard_flush_scancodes();
+                keyboard_discard_shell_input();
+                return;
+            }
+            timer_sleep_ns(50000000ull);
+        }
+    }
+}
+
+// Acquisition and contention counters for every registered lock
+void cmd_lockstat(void) {
+    char line[96];
+    lock_stats_t st;
+
+    shell_print("NAME       ACQUIRED  CONTEND  AVG_us  MAX_us\n", vbe_rgb(0, 255, 255));
+    for (int i = 0; lock_stats_get(i, &st) == 0; i++) {
+        uint32_t avg_us = 0;
+        if (st.contended > 0) {
+            avg_us = (uint32_t)div_u64_u32(div_u64_u32(st.wait_ns, st.contended), 1000u);
+        }
+
+        int pos = 0;
+        pos = append_str(line, pos, st.name, 9);
+        pos = append_uint(line, pos, st.acquired, 10);
+        pos = append_uint(line, pos, st.contended, 9);
+        pos = append_uint(line, pos, avg_us, 8);
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(st.wait_max_ns, 1000u), 8);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, st.contended ? vbe_rgb(255, 128, 0) : vbe_rgb(255, 255, 255));
+    }
+}
+
+// Per-vector interrupt counts and handler cost histograms
+void cmd_irqstat(void) {
+    char line[96];
+    irq_stats_t st;
+
+    shell_print("IRQ NAME       COUNT AVG_cy  MAX_cy  <1k  <4k <16k <64k more\n", vbe_rgb(0, 255, 255));
+    for (int slot = 0; irq_stats_get(slot, &st) == 0; slot++) {
+        if (!st.name && st.count == 0) continue;
+
+        int pos = 0;
+        if (st.vector < 32 + IRQ_LINES) {
+            pos = append_uint(line, pos, (uint32_t)(st.vector - 32), 3);
+        } else {
+            pos = append_str(line, pos, "  -", 0);
+        }
+        pos = append_str(line, pos, " ", 0);
+        pos = append_str(line, pos, st.name ? st.name : "?", 8);
+        pos = append_uint(line, pos, st.count, 8);
+        uint32_t avg = st.count ? (uint32_t)div_u64_u32(st.total_cycles, st.count) : 0;
+        pos = append_uint(line, pos, avg, 7);
+        pos = append_uint(line, pos, st.max_cycles, 8);
+        for (int b = 0; b < IRQ_HIST_BUCKETS; b++) {
+            pos = append_uint(line, pos, st.hist[b], 5);
+        }
+        append_str(line, pos, "\n", 0);
+        shell_print(line, vbe_rgb(255, 255, 255));
+    }
+
+    uint32_t max_depth, deferred;
+    irq_nesting_stats(&max_depth, &deferred);
+    int pos = append_str(line, 0, "max nesting depth:", 0);
+    pos = append_uint(line, pos, max_depth, 3);
+    pos = append_str(line, pos, "    deferred:", 0);
+    pos = append_uint(line, pos, deferred, 8);
+    append_str(line, pos, "\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 0));
+}
+
+static void irqbench_nop(void* arg) {
+    (void)arg;
+}
+
+// IRQ0 entry-to-exit cost through the 8259 and through the IO-APIC
+void cmd_irqbench(void) {
+    const uint32_t samples = 200;
+    static const char* const chip_names[2] = {"8259 PIC", "IO-APIC"};
+    int saved_chip = irqchip_current();
+    int saved_source = pit_event_source();
+    irq_cycle_stats_t st[2];
+    char line[96];
+
+    // Both runs need IRQ0 from the PIT, whatever drives the tick normally.
+    pit_set_event_source(PIT_EVENT_PIT);
+    irq_cycle_stats_reset();
+    for (int chip = IRQCHIP_PIC; chip <= IRQCHIP_APIC; chip++) {
+        st[chip].count = 0;
+        if (!irqchip_select(chip)) continue;
+
+        // A 1 ms timer per pass arms the one-shot PIT; give up after 4x the
+        // expected time if IRQ0 does not arrive.
+        for (uint32_t pass = 0; pass < samples * 4 && st[chip].count < samples; pass++) {
+            timer_add(clock_ns() + 1000000ull, irqbench_nop, 0);
+            udelay(1000);
+            irq_cycle_stats_get(chip, &st[chip]);
+        }
+    }
+    irqchip_select(saved_chip);
+    pit_set_event_source(saved_source);
+
+    shell_print("IRQ0 cycles, entry through EOI + tick handler\n", vbe_rgb(255, 255, 0));
+    shell_print("CHIP        COUNT     AVG     MIN     MAX\n", vbe_rgb(0, 255, 255));
+    for (int chip = IRQCHIP_PIC; chip <= IRQCHIP_APIC; chip++) {
+        int pos = append_str(line, 0, chip_names[chip], 9);
+        if (!irqchip_available(chip) || st[chip].count == 0) {
+            append_str(line, pos, "      n/a\n", 0);
+            shell_print(line, vbe_rgb(128, 128, 128));
+            continue;
+        }
+        pos = append_uint(line, pos, st[chip].count, 8);
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(st[chip].total_cycles, st[chip].count), 8);
+        pos = append_uint(line, pos, st[chip].min_cycles, 8);
+        pos = append_uint(line, pos, st[chip].max_cycles, 8);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, chip == saved_chip ? vbe_rgb(0, 255, 0) : vbe_rgb(255, 255, 255));
+    }
+}
+
+// Longest interrupts-off sections: irqsoff [on|off|reset]
+void cmd_irqsoff(void) {
+    char line[96];
+    irqsoff_record_t rec;
+
+    if (str_equal(cmd_arg1, "on") || str_equal(cmd_arg1, "off")) {
+        if (!irqsoff_set_enabled(str_equal(cmd_arg1, "on"))) {
+            shell_print("irqsoff: tracer unavailable (no TSC or built without IRQSOFF_TRACE)\n", vbe_rgb(255, 0, 0));
+            return;
+        }
+    } else if (str_equal(cmd_arg1, "reset")) {
+        irqsoff_reset();
+    } else if (cmd_arg1[0] != '\0') {
+        shell_print("Usage: irqsoff [on|off|reset]\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+
+    shell_print(irqsoff_enabled() ? "irqsoff tracer: on\n" : "irqsoff tracer: off\n", vbe_rgb(255, 255, 0));
+    shell_print(" #  CPU   OFF_us      OFF_AT       ON_AT\n", vbe_rgb(0, 255, 255));
+    for (int i = 0; irqsoff_get(i, &rec) == 0; i++) {
+        int pos = append_uint(line, 0, (uint32_t)i, 2);
+        pos = append_uint(line, pos, (uint32_t)rec.cpu, 5);
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(clock_cycles_to_ns(rec.cycles), 1000u), 9);
+        pos = append_hex(line, pos, rec.off_ip, 12);
+        pos = append_hex(line, pos, rec.on_ip, 12);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, vbe_rgb(255, 255, 255));
+    }
+}
+
+// Parse a decimal number; returns 0 for anything else
+static uint32_t parse_uint(const char *s) {
+    uint32_t value = 0;
+    if (*s == '\0') return 0;
+    while (*s >= '0' && *s <= '9') value = value * 10 + (uint32_t)(*s++ - '0');
+    return (*s == '\0') ? value : 0;
+}
+
+// Null system call round trip from ring 3: int 0x80 vs SYSENTER/SYSEXIT
+void cmd_sysbench(void) {
+    uint32_t iterations = 10000;
+    user_sysbench_t r;
+    char line[96];
+
+    if (cmd_arg1[0] != '\0') {
+        iterations = parse_uint(cmd_arg1);
+        if (iterations == 0) {
+            shell_print("Usage: sysbench [iterations]\n", vbe_rgb(255, 0, 0));
+            return;
+        }
+    }
+    if (user_sysbench(iterations, &r) != 0) {
+        shell_print("sysbench: user task failed (no TSC or no task slot)\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+
+    int pos = append_str(line, 0, "Null syscall round trip from ring 3, ", 0);
+    pos = append_uint(line, pos, r.iterations, 0);
+    append_str(line, pos, " calls\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 0));
+    shell_print("PATH         AVG_cy  MIN_cy\n", vbe_rgb(0, 255, 255));
+
+    pos = append_str(line, 0, "int 0x80", 9);
+    pos = append_uint(line, pos, (uint32_t)div_u64_u32(r.int80_total, r.iterations), 9);
+    pos = append_uint(line, pos, r.int80_min, 8);
+    append_str(line, pos, "\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+
+    pos = append_str(line, 0, "sysenter", 9);
+    if (!r.sysenter_ok) {
+        append_str(line, pos, "      n/a\n", 0);
+        shell_print(line, vbe_rgb(128, 128, 128));
+    } else {
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(r.sysenter_total, r.iterations), 9);
+        pos = append_uint(line, pos, r.sysenter_min, 8);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, vbe_rgb(255, 255, 255));
+    }
+
+    // Reading the clock from the shared data page, no system call at all
+    pos = append_str(line, 0, "vdso ns", 9);
+    pos = append_uint(line, pos, (uint32_t)div_u64_u32(r.vdso_total, r.iterations), 9);
+    pos = append_uint(line, pos, r.vdso_min, 8);
+    append_str(line, pos, "\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+}
+
+// Null system calls one trap each vs batched through the submission ring
+void cmd_uringbench(void) {
+    uint32_t iterations = 10000;
+    uint32_t batch = 16;
+    user_uringbench_t r;
+    uring_stats_t st;
+    char line[96];
+
+    if (cmd_arg1[0] != '\0') {
+        iterations = parse_uint(cmd_arg1);
+        if (cmd_arg2[0] != '\0') batch = parse_uint(cmd_arg2);
+        if (iterations == 0 || batch == 0) {
+            shell_print("Usage: uringbench [iterations] [batch]\n", vbe_rgb(255, 0, 0));
+            return;
+        }
+    }
+    if (user_uringbench(iterations, batch, &r) != 0) {
+        shell_print("uringbench: user task failed (no TSC or no task slot)\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+    if (!r.ring_ok) {
+        shell_print("uringbench: ring setup failed\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+
+    int pos = append_str(line, 0, "Null syscalls from ring 3, ", 0);
+    pos = append_uint(line, pos, r.iterations, 0);
+    pos = append_str(line, pos, " calls, batch ", 0);
+    pos = append_uint(line, pos, r.batch, 0);
+    append_str(line, pos, "\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 0));
+    shell_print("PATH       AVG_cy   TRAPS\n", vbe_rgb(0, 255, 255));
+
+    pos = append_str(line, 0, "int 0x80", 9);
+    pos = append_uint(line, pos, (uint32_t)div_u64_u32(r.sync_total, r.iterations), 7);
+    pos = append_uint(line, pos, r.sync_traps, 8);
+    append_str(line, pos, "\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+
+    pos = append_str(line, 0, "uring", 9);
+    pos = append_uint(line, pos, (uint32_t)div_u64_u32(r.ring_total, r.iterations), 7);
+    pos = append_uint(line, pos, r.ring_traps, 8);
+    append_str(line, pos, "\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+
+    uring_get_stats(&st);
+    pos = append_str(line, 0, "uringd: ", 0);
+    pos = append_uint(line, pos, st.submitted, 0);
+    pos = append_str(line, pos, " run, ", 0);
+    pos = append_uint(line, pos, st.enters, 0);
+    pos = append_str(line, pos, " enters, ", 0);
+    pos = append_uint(line, pos, st.wakeups, 0);
+    pos = append_str(line, pos, " wakeups, ", 0);
+    pos = append_uint(line, pos, r.ring_errors, 0);
+    append_str(line, pos, " errors\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+}
+
+// Keyboard input through sys_read from a ring 3 task
+void cmd_ttyecho(void) {
+    int raw = 0;
+    if (str_equal(cmd_arg1, "raw")) {
+        raw = 1;
+    } else if (cmd_arg1[0] != '\0') {
+        shell_print("Usage: ttyecho [raw]\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+    shell_print(raw ? "Raw mode, 'q' quits\n" : "Cooked mode, an empty line quits\n", vbe_rgb(255, 255, 0));
+    if (user_ttyecho(raw) != 0) {
+        shell_print("ttyecho: user task failed (no task slot)\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+    // Keys typed for the task must not run as commands afterwards.
+    keyboard_discard_shell_input();
+}
+
+// Per-system-call counts, errors and latency histograms: sysstat [reset]
+void cmd_sysstat(void) {
+    char line[96];
+    systrace_stats_t st;
+
+    if (str_equal(cmd_arg1, "reset")) {
+        systrace_reset();
+        shell_print("sysstat: counters cleared\n", vbe_rgb(255, 255, 0));
+        return;
+    } else if (cmd_arg1[0] != '\0') {
+        shell_print("Usage: sysstat [reset]\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+
+    shell_print("NAME      COUNT  ERR  AVG_cy <1k <4k<16k<64k <1M more\n", vbe_rgb(0, 255, 255));
+    for (uint32_t slot = 0; systrace_get_stats(slot, &st) == 0; slot++) {
+        if (st.count == 0) continue;
+        const syscall_desc_t* d = syscall_desc(slot);
+        int pos = append_str(line, 0, (slot < SYSCALL_COUNT && d->fn) ? d->name : "invalid", 8);
+        pos = append_uint(line, pos, st.count, 7);
+        pos = append_uint(line, pos, st.errors, 5);
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(st.total_cycles, st.count), 8);
+        for (int b = 0; b < SYSTRACE_HIST_BUCKETS; b++) {
+            pos = append_uint(line, pos, st.hist[b], 4);
+        }
+        append_str(line, pos, "\n", 0);
+        shell_print(line, st.errors ? vbe_rgb(255, 128, 0) : vbe_rgb(255, 255, 255));
+    }
+}
+
+// Most recent system calls: strace [on|off|reset]
+void cmd_strace(void) {
+    char line[96];
+    systrace_entry_t e;
+
+    if (str_equal(cmd_arg1, "on") || str_equal(cmd_arg1, "off")) {
+        systrace_set_enabled(str_equal(cmd_arg1, "on"));
+    } else if (str_equal(cmd_arg1, "reset")) {
+        systrace_clear();
+    } else if (cmd_arg1[0] != '\0') {
+        shell_print("Usage: strace [on|off|reset]\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+
+    shell_print(systrace_enabled() ? "strace: on\n" : "strace: off\n", vbe_rgb(255, 255, 0));
+    shell_print("TID NAME    ARG1       ARG2       RESULT   us\n", vbe_rgb(0, 255, 255));
+    for (int i = 0; systrace_get(i, &e) == 0; i++) {
+        const syscall_desc_t* d = syscall_desc(e.nr);
+        int pos = append_uint(line, 0, (uint32_t)e.task, 3);
+        pos = append_str(line, pos, " ", 0);
+        if (d && d->fn) {
+            pos = append_str(line, pos, d->name, 7);
+        } else {
+            pos = append_str(line, pos, "#", 0);
+            pos = append_uint(line, pos, e.nr, 6);
+        }
+        pos = append_str(line, pos, e.from_ring ? "@" : " ", 0);
+        pos = append_hex(line, pos, e.args[0], 11);
+        pos = append_hex(line, pos, e.args[1], 11);
+        if (e.result < 0) {
+            pos = append_str(line, pos, "      -", 0);
+            pos = append_uint(line, pos, (uint32_t)-e.result, 0);
+        } else {
+            pos = append_uint(line, pos, (uint32_t)e.result, 8);
+        }
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(clock_cycles_to_ns(e.cycles), 1000u), 6);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, vbe_rgb(255, 255, 255));
+    }
+}
+
+// First disk found by ata_init(), or -1
+static int disk_first(void) {
+    for (int dev = 0; dev < ATA_MAX_DRIVES; dev++) {
+        if (ata_drive(dev)) return dev;
+    }
+    return -1;
+}
+
+// ATA disks and the buffer cache: read/write a cached block, write back
+void cmd_disk(void) {
+    char line[96];
+    int dev = disk_first();
+
+    if (str_equal(cmd_arg1, "read") || str_equal(cmd_arg1, "write")) {
+        // arg2 is "<block>" or "<block> <text>"
+        char num[12];
+        int i = 0;
+        while (cmd_arg2[i] && cmd_arg2[i] != ' ' && i < (int)sizeof(num) - 1) {
+            num[i] = cmd_arg2[i];
+            i++;
+        }
+        num[i] = '\0';
+        const char* text = cmd_arg2 + i;
+        while (*text == ' ') text++;
+        int writing = str_equal(cmd_arg1, "write");
+        if (num[0] == '\0' || (num[0] != '0' && parse_uint(num) == 0) || (writing && *text == '\0')) {
+            shell_print("Usage: disk read <block> | disk write <block> <text>\n", vbe_rgb(255, 0, 0));
+            return;
+        }
+        if (dev < 0) {
+            shell_print("disk: no ATA disk\n", vbe_rgb(255, 0, 0));
+            return;
+        }
+
+        uint32_t block = parse_uint(num);
+        uint64_t start = clock_cycles();
+        buf_t* b = bread(dev, block);
+        uint64_t cycles = clock_cycles() - start;
+        if (!b) {
+            shell_print("disk: cannot read block\n", vbe_rgb(255, 0, 0));
+            return;
+        }
+        if (writing) {
+            int n = 0;
+            while (text[n] && n < BCACHE_BLOCK_SIZE) {
+                b->data[n] = (uint8_t)text[n];
+                n++;
+            }
+            bdirty(b);
+        }
+        int pos = append_str(line, 0, "block ", 0);
+        pos = append_uint(line, pos, block, 0);
+        pos = append_str(line, pos, ":", 0);
+        for (int k = 0; k < 8; k++) {
+            static const char digits[] = "0123456789abcdef";
+            line[pos++] = ' ';
+            line[pos++] = digits[b->data[k] >> 4];
+            line[pos++] = digits[b->data[k] & 0xF];
+        }
+        pos = append_str(line, pos, "  (", 0);
+        pos = append_uint(line, pos, (uint32_t)div_u64_u32(clock_cycles_to_ns(cycles), 1000u), 0);
+        append_str(line, pos, " us)\n", 0);
+        brelse(b);
+        shell_print(line, vbe_rgb(255, 255, 255));
+        return;
+    } else if (str_equal(cmd_arg1, "sync")) {
+        shell_print(bcache_sync() == 0 ? "disk: synced\n" : "disk: write-back failed\n",
+                    vbe_rgb(255, 255, 0));
+    } else if (cmd_arg1[0] != '\0') {
+        shell_print("Usage: disk [read <block> | write <block> <text> | sync]\n", vbe_rgb(255, 0, 0));
+        return;
+    }
+
+    for (int d = 0; d < ATA_MAX_DRIVES; d++) {
+        const ata_drive_t* drive = ata_drive(d);
+        if (!drive) continue;
+        int pos = append_str(line, 0, "hd", 0);
+        pos = append_uint(line, pos, (uint32_t)d, 0);
+        pos = append_str(line, pos, ": ", 0);
+        pos = append_str(line, pos, drive->model, 0);
+        pos = append_str(line, pos, ", ", 0);
+        pos = append_uint(line, pos, drive->sectors / 2, 0);
+        pos = append_str(line, pos, " KiB, multiple ", 0);
+        pos = append_uint(line, pos, drive->multiple, 0);
+        append_str(line, pos, "\n", 0);
+        shell_print(line, vbe_rgb(255, 255, 255));
+    }
+    if (dev < 0) shell_print("No ATA disks (run with -drive if=ide)\n", vbe_rgb(255, 255, 0));
+
+    bcache_stats_t cs;
+    bcache_get_stats(&cs);
+    int pos = append_str(line, 0, "cache: ", 0);
+    pos = append_uint(line, pos, cs.hits, 0);
+    pos = append_str(line, pos, " hits, ", 0);
+    pos = append_uint(line, pos, cs.misses, 0);
+    pos = append_str(line, pos, " misses, ", 0);
+    pos = append_uint(line, pos, cs.evictions, 0);
+    append_str(line, pos, " evictions\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+    pos = append_str(line, 0, "       ", 0);
+    pos = append_uint(line, pos, cs.dirty, 0);
+    pos = append_str(line, pos, " dirty, ", 0);
+    pos = append_uint(line, pos, cs.writebacks, 0);
+    append_str(line, pos, " written back\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+
+    ata_stats_t as;
+    ata_get_stats(&as);
+    pos = append_str(line, 0, "ata: ", 0);
+    pos = append_uint(line, pos, as.read_cmds, 0);
+    pos = append_str(line, pos, " reads (", 0);
+    pos = append_uint(line, pos, as.sectors_read, 0);
+    pos = append_str(line, pos, " sectors), ", 0);
+    pos = append_uint(line, pos, as.write_cmds, 0);
+    pos = append_str(line, pos, " writes (", 0);
+    pos = append_uint(line, pos, as.sectors_written, 0);
+    append_str(line, pos, " sectors)\n", 0);
+    shell_print(line, vbe_rgb(255, 255, 255));
+    if (as.errors) {
+        pos = append_str(line, 0, "ata: ", 0);
+        pos = append_uint(line, pos, as.errors, 0);
+        append_str(line, pos, " errors\n", 0);
+        shell_print(line, vbe_rgb(255, 0, 0));
+    }
+}
@@ -11,8 +11,10 @@ void cmd_clear(void);     // Clear screen
 void cmd_ls(void);        // List files
 void cmd_cd(void);        // Change directory
 void cmd_pwd(void);       // Print working directory
+void cmd_mkdir(void);     // Create directory
 void cmd_create(void);    // Create file
 void cmd_write(void);     // Write to file
+void cmd_append(void);    // Append to file
 void cmd_read(void);      // Read file content
 void cmd_delete(void);    // Delete file
 void cmd_whoami(void);    // Display current user
@@ -20,6 +22,17 @@ void cmd_hostname(void);  // Display system hostname
 void cmd_date(void);      // Show current date/time
 void cmd_uname(void);     // Display system information
 void cmd_echo(void);      // Echo text to screen
+void cmd_top(void);       // Show per-task CPU and latency statistics
+void cmd_lockstat(void);  // Show lock contention statistics
+void cmd_irqstat(void);   // Show per-vector IRQ counts and handler cost
+void cmd_irqbench(void);  // Compare IRQ cost through the 8259 and the IO-APIC
+void cmd_irqsoff(void);   // Show the longest interrupts-off sections
+void cmd_sysbench(void);  // Time null system calls from ring 3 (int 0x80, SYSENTER)
+void cmd_uringbench(void); // Null system calls trapped one by one vs batched through a ring
+void cmd_ttyecho(void);    // Read the keyboard through sys_read from ring 3 (cooked or raw)
+void cmd_sysstat(void);    // Per-system-call counts, errors and latency histograms
+void cmd_strace(void);     // Trace ring of recent system calls
+void cmd_disk(void);       // ATA disks and buffer cache: stats, read/write a block, sync
 void cmd_exit(void);      // Exit shell
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "shell.h"
 #include "commands.h"
 #include "../graphic/vbe.h"
+#include "../graphic/console.h"
 #include "../fs/filesystem.h"
 #include "../drivers/keyboard.h"
 #include "../drivers/rtc.h"
@@ -10,8 +11,6 @@ shell_t shell;
 
 static char command_buffer[MAX_COMMAND_LENGTH];
 static int command_pos = 0;
-static int output_cursor_x = 5;
-static int output_cursor_y = 5;
 
 // Forward declarations
 void shell_new_line(void);
@@ -25,11 +24,6 @@ static void shell_strcpy(char *dest, const char *src) {
     *dest = '\0';
 }
 
-static int shell_strcmp(const char *s1, const char *s2) {
-    while (*s1 && (*s1 == *s2)) { s1++; s2++; }
-    return *(unsigned char *)s1 - *(unsigned char *)s2;
-}
-
 static int shell_strlen(const char *str) {
     int len = 0; while (*str++) len++; return len;
 }
@@ -41,11 +35,7 @@ static int str_equal(const char *s1, const char *s2) {
 
 // Move to next line with automatic scroll
 void shell_new_line(void) {
-    output_cursor_x = 5;
-    output_cursor_y += LINE_HEIGHT;
-    if (output_cursor_y + LINE_HEIGHT > shell_get_screen_height()) {
-        shell_scroll_screen();
-    }
+    console_write("\n", 1, 0);
 }
 
 // Get display dimensions from VBE
@@ -54,72 +44,26 @@ int shell_get_screen_height(void) {
     return (vbe_info && vbe_info->framebuffer) ? vbe_info->height : 600;
 }
 
-static int shell_get_screen_width(void) {
-    extern struct vbe_mode_info* vbe_info;
-    return (vbe_info && vbe_info->framebuffer) ? vbe_info->width : 800;
-}
-
 // Clear entire screen and reset shell state
 void shell_clear_screen(void) {
-    vbe_clear_screen(vbe_rgb(0, 0, 0));
-    output_cursor_x = 5;
-    output_cursor_y = 5;
+    console_clear();
     command_pos = 0;
     command_buffer[0] = '\0';
 }
 
 // Scroll screen content up by one line
 void shell_scroll_screen(void) {
-    extern struct vbe_mode_info* vbe_info;
-    if (!vbe_info || !vbe_info->framebuffer) return;
-    
-    int screen_width = vbe_info->width;
-    int screen_height = vbe_info->height;
-    int pitch = vbe_info->pitch;
-    int bpp = vbe_info->bpp / 8;
-    uint8_t* fb = (uint8_t*)vbe_info->framebuffer;
-    
-    // Copy pixel data up by one line
-    for (int y = 5; y < screen_height - LINE_HEIGHT; y++) {
-        for (int x = 0; x < screen_width; x++) {
-            uint8_t* src_pixel = fb + ((y + LINE_HEIGHT) * pitch) + (x * bpp);
-            uint8_t* dest_pixel = fb + (y * pitch) + (x * bpp);
-            
-            if (bpp == 2) {
-                *(uint16_t*)dest_pixel = *(uint16_t*)src_pixel;
-            } else if (bpp == 3) {
-                dest_pixel[0] = src_pixel[0]; dest_pixel[1] = src_pixel[1]; dest_pixel[2] = src_pixel[2];
-            } else if (bpp == 4) {
-                *(uint32_t*)dest_pixel = *(uint32_t*)src_pixel;
-            }
-        }
-    }
-    
-    // Clear the new bottom line
-    for (int y = screen_height - LINE_HEIGHT; y < screen_height; y++) {
-        for (int x = 0; x < screen_width; x++) {
-            vbe_put_pixel(x, y, vbe_rgb(0, 0, 0));
-        }
-    }
-    output_cursor_y -= LINE_HEIGHT;
+    console_scroll();
 }
 
-// Output text at current cursor position with color
+// Output text at current cursor position with color (buffered, see console.h)
 void shell_print(const char *text, uint32_t color) {
-    const char *ptr = text;
-    while (*ptr) {
-        if (*ptr == '\n') {
-            output_cursor_x = 5;
-            output_cursor_y += LINE_HEIGHT;
-            if (output_cursor_y + LINE_HEIGHT > shell_get_screen_height()) {
-                shell_scroll_screen();
-            }
-        } else {
-            vbe_draw_char(output_cursor_x, output_cursor_y, *ptr, color, 2);
-            output_cursor_x += CHAR_WIDTH * 2;
-        }
-        ptr++;
-    }
+    console_write(text, shell_strlen(text), color);
+}
+
+// Track the console cursor for the input line
+static void shell_sync_cursor(void) {
+    console_get_cursor(&shell.cursor_x, &shell.cursor_y);
 }
 
 // Display shell prompt
@@ -136,22 +80,21 @@ void shell_draw_prompt(void) {
     prompt[pos++] = ':';
     
     const char *path = shell.current_path;
-    while (*path) prompt[pos++] = *path++;
+    while (*path && pos < (int)sizeof(prompt) - 3) prompt[pos++] = *path++;
     prompt[pos++] = '$'; prompt[pos++] = ' '; prompt[pos] = '\0';
     
     shell_print(prompt, vbe_rgb(0, 255, 0));
+    console_flush();
 }
 
 // Initialize shell with default settings
 void shell_init(void) {
     shell_strcpy(shell.username, "mini");
     shell_strcpy(shell.hostname, "miniOS");
-    shell_strcpy(shell.current_path, "~");
+    shell_change_directory("/");
     
     command_pos = 0;
     command_buffer[0] = '\0';
-    output_cursor_x = 5;
-    output_cursor_y = 5;
     
     shell_clear_screen();
     shell_draw_prompt();
@@ -159,85 +102,46 @@ void shell_init(void) {
     keyboard_flush_scancodes();
     keyboard_set_shell_input(1);
     
-    int prompt_length = shell_strlen("mini@miniOS:~$ ");
-    output_cursor_x = 5 + (prompt_length * CHAR_WIDTH * 2);
-    shell.cursor_x = output_cursor_x;
-    shell.cursor_y = output_cursor_y;
+    shell_sync_cursor();
 }
 
-// Change current working directory
-void shell_change_directory(const char *path) {
-    if (shell_strcmp(path, "/") == 0 || shell_strcmp(path, "~") == 0) {
-        shell_strcpy(shell.current_path, "~");
-    } else if (shell_strcmp(path, "..") == 0) {
-        shell_strcpy(shell.current_path, "~");
-    } else {
-        shell_strcpy(shell.current_path, path);
+// Change current working directory (-1 if path is not a directory)
+int shell_change_directory(const char *path) {
+    if (fs_chdir(path) < 0) return -1;
+    if (fs_getcwd(shell.current_path, sizeof(shell.current_path)) < 0) {
+        shell_strcpy(shell.current_path, "...");  // Too deep to show
     }
+    return 0;
 }
 
 // Handle keyboard input character by character
 void shell_add_char(char c) {
     if (c == '\b') { // Backspace
         if (command_pos > 0) {
-            // Clear character from screen
-            for (int y = output_cursor_y; y < output_cursor_y + 20; y++) {
-                for (int x = output_cursor_x - (CHAR_WIDTH * 2); x < output_cursor_x; x++) {
-                    vbe_put_pixel(x, y, vbe_rgb(0, 0, 0));
-                }
-            }
             command_pos--;
             command_buffer[command_pos] = '\0';
-            output_cursor_x -= CHAR_WIDTH * 2;
-            
-            // Handle line wrapping
-            if (output_cursor_x < 5) {
-                int screen_width = shell_get_screen_width();
-                output_cursor_x = screen_width - (CHAR_WIDTH * 2);
-                output_cursor_y -= LINE_HEIGHT;
-            }
-            shell.cursor_x = output_cursor_x;
-            shell.cursor_y = output_cursor_y;
+            console_backspace();
+            shell_sync_cursor();
         }
     } else if (c == '\n') { // Execute command
-        output_cursor_x = 5;
-        output_cursor_y += LINE_HEIGHT;
-        if (output_cursor_y + LINE_HEIGHT > shell_get_screen_height()) {
-            shell_scroll_screen();
-        }
+        shell_new_line();
         
         shell_execute_command(command_buffer);
         
         command_pos = 0;
         command_buffer[0] = '\0';
-        output_cursor_x = 5;
-        output_cursor_y += LINE_HEIGHT;
-        if (output_cursor_y + LINE_HEIGHT > shell_get_screen_height()) {
-            shell_scroll_screen();
-        }
+        shell_new_line();
         
         shell_draw_prompt();
-        int prompt_length = shell_strlen("mini@miniOS:~$ ");
-        output_cursor_x = 5 + (prompt_length * CHAR_WIDTH * 2);
-        shell.cursor_x = output_cursor_x;
-        shell.cursor_y = output_cursor_y;
+        shell_sync_cursor();
     } else if (command_pos < MAX_COMMAND_LENGTH - 1) { // Normal character
-        vbe_draw_char(output_cursor_x, output_cursor_y, c, vbe_rgb(255, 255, 255), 2);
         command_buffer[command_pos++] = c;
         command_buffer[command_pos] = '\0';
-        output_cursor_x += CHAR_WIDTH * 2;
-        
-        // Handle line wrapping
-        int screen_width = shell_get_screen_width();
-        if (output_cursor_x + (CHAR_WIDTH * 2) > screen_width) {
-            output_cursor_x = 5;
-            output_cursor_y += LINE_HEIGHT;
-            if (output_cursor_y + LINE_HEIGHT > shell_get_screen_height()) {
-                shell_scroll_screen();
-            }
-        }
-        shell.cursor_x = output_cursor_x;
-        shell.cursor_y = output_cursor_y;
+
+        // Echo right away; the console wraps long lines
+        console_write(&c, 1, vbe_rgb(255, 255, 255));
+        console_flush();
+        shell_sync_cursor();
     }
 }
 
@@ -308,10 +212,14 @@ void shell_execute_command(const char *command) {
         cmd_cd();
     } else if (str_equal(parsed_cmd_name, "pwd")) {
         cmd_pwd();
+    } else if (str_equal(parsed_cmd_name, "mkdir")) {
+        cmd_mkdir();
     } else if (str_equal(parsed_cmd_name, "create") || str_equal(parsed_cmd_name, "touch")) {
         cmd_create();
     } else if (str_equal(parsed_cmd_name, "write")) {
         cmd_write();
+    } else if (str_equal(parsed_cmd_name, "append")) {
+        cmd_append();
     } else if (str_equal(parsed_cmd_name, "read") || str_equal(parsed_cmd_name, "cat")) {
         cmd_read();
     } else if (str_equal(parsed_cmd_name, "delete") || str_equal(parsed_cmd_name, "rm")) {
@@ -326,6 +234,28 @@ void shell_execute_command(const char *command) {
         cmd_uname();
     } else if (str_equal(parsed_cmd_name, "echo")) {
         cmd_echo();
+    } else if (str_equal(parsed_cmd_name, "top")) {
+        cmd_top();
+    } else if (str_equal(parsed_cmd_name, "lockstat")) {
+        cmd_lockstat();
+    } else if (str_equal(parsed_cmd_name, "irqstat")) {
+        cmd_irqstat();
+    } else if (str_equal(parsed_cmd_name, "irqbench")) {
+        cmd_irqbench();
+    } else if (str_equal(parsed_cmd_name, "irqsoff")) {
+        cmd_irqsoff();
+    } else if (str_equal(parsed_cmd_name, "sysbench")) {
+        cmd_sysbench();
+    } else if (str_equal(parsed_cmd_name, "uringbench")) {
+        cmd_uringbench();
+    } else if (str_equal(parsed_cmd_name, "ttyecho")) {
+        cmd_ttyecho();
+    } else if (str_equal(parsed_cmd_name, "sysstat")) {
+        cmd_sysstat();
+    } else if (str_equal(parsed_cmd_name, "strace")) {
+        cmd_strace();
+    } else if (str_equal(parsed_cmd_name, "disk")) {
+        cmd_disk();
     } else if (str_equal(parsed_cmd_name, "exit") || str_equal(parsed_cmd_name, "logout")) {
         cmd_exit();
     } else if (shell_strlen(parsed_cmd_name) > 0) {
@@ -25,7 +25,7 @@ void shell_add_char(char c);                        // Add character to command
 void shell_execute_command(const char *command);    // Execute shell command
 void shell_print(const char *text, uint32_t color); // Print text to shell
 void shell_new_line(void);                          // Move to new line
-void shell_change_directory(const char *path);      // Change current directory
+int shell_change_directory(const char *path);       // Change current directory
 
 // Screen functions
 int shell_get_screen_height(void);                  // Get available screen height
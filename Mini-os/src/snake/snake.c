@@ -2,6 +2,7 @@
 #include "../graphic/vbe.h"
 #include "../drivers/keyboard.h"
 #include "../io.h"
+#include "../drivers/clock.h"
 #include "../boot_menu.h" 
 
 // Global game state
@@ -390,9 +391,9 @@ void grow_snake(Snake *snake) {
     }
 }
 
-// Simple delay function for game timing
-void delay(int cycles) {
-    for (volatile int i = 0; i < cycles; i++);
+// Frame delay for game timing
+void delay(int us) {
+    udelay((uint32_t)us);
 }
 
 // Main snake game function
@@ -458,7 +459,7 @@ void snake_game(void) {
         }
         
         frame_count++;
-        delay(200000); // Slow speed delay
+        delay(2000); // 2ms per frame (one move every game_speed frames)
     }
     
     // Show simple game over screen and return to boot menu
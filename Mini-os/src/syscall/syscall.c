@@ -1,60 +1,241 @@
 #include "syscall.h"
 #include "../graphic/vbe.h"
+#include "../graphic/console.h"
 #include "../drivers/keyboard.h"
+#include "../drivers/clock.h"
+#include "../gdt.h"
+#include "../io.h"
+#include "../sched/sched.h"
+#include "../kernel/usermode.h"
+#include "uring.h"
+#include "systrace.h"
+#include "../drivers/tty.h"
+#include "../fs/filesystem.h"
 #include <stdint.h>
 
-// System call dispatcher - routes syscalls to appropriate handlers
-void syscall_dispatcher(registers_t *regs) {
-    switch(regs->eax) {
-        case SYSCALL_WRITE:
-            regs->eax = sys_write((char*)regs->ebx, regs->ecx);
-            break;
-        case SYSCALL_READ:
-            regs->eax = sys_read((char*)regs->ebx, regs->ecx);
-            break;
-        case SYSCALL_EXIT:
-            sys_exit(regs->ebx);
-            break;
-        default:
-            regs->eax = -1; // Invalid syscall
+// SYSENTER target MSRs
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+extern void sysenter_entry(void);
+
+static int sep_checked = 0;
+static int has_sep = 0;
+
+int syscall_fast_available(void) {
+    if (!sep_checked) {
+        uint32_t regs[4];
+        if (cpu_cpuid(1, regs)) {
+            uint32_t family = (regs[0] >> 8) & 0xF;
+            uint32_t model = (regs[0] >> 4) & 0xF;
+            uint32_t stepping = regs[0] & 0xF;
+            // CPUID.1:EDX.SEP; early Pentium Pro parts set it without
+            // implementing the instructions.
+            has_sep = (regs[3] & (1u << 11)) != 0 &&
+                      !(family == 6 && model < 3 && stepping < 3);
+        }
+        sep_checked = 1;
     }
+    return has_sep;
 }
 
-// Write system call - outputs text to screen
-int sys_write(char *buffer, int length) {
-    static int sys_write_x = 50;    // Current X position for text
-    static int sys_write_y = 400;   // Current Y position for text
-    
-    for(int i = 0; i < length; i++) {
-        if (buffer[i] == '\n') {
-            // Handle newline - move to next line
-            sys_write_x = 50;
-            sys_write_y += 16;
-        } else {
-            // Draw character and advance position
-            vbe_draw_char(sys_write_x, sys_write_y, buffer[i], vbe_rgb(255, 255, 255), 2);
-            sys_write_x += 16;
-            
-            // Wrap to next line if at screen edge
-            if (sys_write_x > 1000) {
-                sys_write_x = 50;
-                sys_write_y += 16;
-            }
+void syscall_init_cpu(int cpu) {
+    if (!syscall_fast_available()) return;
+
+    // SYSENTER loads SS = CS + 8; SYSEXIT loads CS = CS + 16 and SS = CS + 24
+    // (RPL 3), which is the GDT_KERNEL_CS..GDT_USER_DS layout. ESP points at
+    // this CPU's TSS so the entry stub can pick up the task's esp0 without
+    // an MSR write on every context switch.
+    cpu_wrmsr(MSR_SYSENTER_CS, GDT_KERNEL_CS);
+    cpu_wrmsr(MSR_SYSENTER_ESP, (uint32_t)(uintptr_t)tss_for_cpu(cpu));
+    cpu_wrmsr(MSR_SYSENTER_EIP, (uint32_t)(uintptr_t)sysenter_entry);
+}
+
+// System Call Handler (int 0x80 and SYSENTER)
+void syscall_handler(registers_t *regs) {
+    // Call the system call dispatcher
+    syscall_dispatcher(regs);
+}
+
+// Table adapters: every entry takes the calling task and the three raw
+// argument registers. The task is the submitter for ring calls, which run
+// on uringd.
+static int sc_write(int task, uint32_t buffer, uint32_t length, uint32_t unused) {
+    (void)task;
+    (void)unused;
+    return sys_write((char*)(uintptr_t)buffer, (int)length);
+}
+
+static int sc_read(int task, uint32_t buffer, uint32_t length, uint32_t unused) {
+    (void)task;
+    (void)unused;
+    return sys_read((char*)(uintptr_t)buffer, (int)length);
+}
+
+static int sc_open(int task, uint32_t name, uint32_t length, uint32_t flags) {
+    return sys_open((const char*)(uintptr_t)name, (int)length, (int)flags, task);
+}
+
+static int sc_close(int task, uint32_t fd, uint32_t unused1, uint32_t unused2) {
+    (void)unused1;
+    (void)unused2;
+    return fs_close((int)fd, task);
+}
+
+static int sc_fread(int task, uint32_t fd, uint32_t buffer, uint32_t length) {
+    return fs_read((int)fd, (void*)(uintptr_t)buffer, length, task);
+}
+
+static int sc_fwrite(int task, uint32_t fd, uint32_t buffer, uint32_t length) {
+    return fs_write((int)fd, (const void*)(uintptr_t)buffer, length, task);
+}
+
+static int sc_lseek(int task, uint32_t fd, uint32_t offset, uint32_t whence) {
+    return fs_lseek((int)fd, (int32_t)offset, (int)whence, task);
+}
+
+static int sc_tty_mode(int task, uint32_t mode, uint32_t unused1, uint32_t unused2) {
+    (void)task;
+    (void)unused1;
+    (void)unused2;
+    return tty_set_mode(mode);
+}
+
+static int sc_exit(int task, uint32_t status, uint32_t unused1, uint32_t unused2) {
+    (void)task;
+    (void)unused1;
+    (void)unused2;
+    sys_exit((int)status);
+    return 0;
+}
+
+static int sc_nop(int task, uint32_t unused1, uint32_t unused2, uint32_t unused3) {
+    (void)task;
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    return 0;
+}
+
+static int sc_draw(int task, uint32_t xy, uint32_t wh, uint32_t color) {
+    (void)task;
+    return sys_draw_rect((int)(xy & 0xFFFF), (int)(xy >> 16), (int)(wh & 0xFFFF), (int)(wh >> 16), color);
+}
+
+static int sc_uring_setup(int task, uint32_t ring, uint32_t unused1, uint32_t unused2) {
+    (void)task;
+    (void)unused1;
+    (void)unused2;
+    return uring_setup(ring);
+}
+
+static int sc_uring_enter(int task, uint32_t min_complete, uint32_t unused1, uint32_t unused2) {
+    (void)task;
+    (void)unused1;
+    (void)unused2;
+    return uring_enter(min_complete);
+}
+
+static const syscall_desc_t syscall_table[SYSCALL_COUNT] = {
+    [SYSCALL_WRITE] = {"write", sc_write, 2, 0, {SYSARG_BUF_IN, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_READ]  = {"read",  sc_read,  2, SYSCALL_F_SYNC, {SYSARG_BUF_OUT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_OPEN]  = {"open",  sc_open,  3, 0, {SYSARG_BUF_IN, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_CLOSE] = {"close", sc_close, 1, 0, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_EXEC]  = {"exec",  0,        0, 0, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_EXIT]  = {"exit",  sc_exit,  1, SYSCALL_F_SYNC, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_NOP]   = {"nop",   sc_nop,   0, 0, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_DRAW]  = {"draw",  sc_draw,  3, 0, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_URING_SETUP] = {"uring_setup", sc_uring_setup, 1, SYSCALL_F_SYNC, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_URING_ENTER] = {"uring_enter", sc_uring_enter, 1, SYSCALL_F_SYNC, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_TTY_MODE] = {"tty_mode", sc_tty_mode, 1, SYSCALL_F_SYNC, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+    [SYSCALL_FREAD]  = {"fread",  sc_fread,  3, 0, {SYSARG_INT, SYSARG_BUF_OUT, SYSARG_INT}},
+    [SYSCALL_FWRITE] = {"fwrite", sc_fwrite, 3, 0, {SYSARG_INT, SYSARG_BUF_IN, SYSARG_INT}},
+    [SYSCALL_LSEEK]  = {"lseek",  sc_lseek,  3, 0, {SYSARG_INT, SYSARG_INT, SYSARG_INT}},
+};
+
+const syscall_desc_t* syscall_desc(uint32_t nr) {
+    return (nr < SYSCALL_COUNT) ? &syscall_table[nr] : 0;
+}
+
+// Check ring 3 buffer arguments against the table's metadata
+static int syscall_args_ok(const syscall_desc_t* d, const uint32_t args[SYSCALL_MAX_ARGS]) {
+    for (int i = 0; i < d->nargs; i++) {
+        uint8_t kind = d->arg_kind[i];
+        if (kind == SYSARG_INT) continue;
+
+        uint32_t len = (i + 1 < SYSCALL_MAX_ARGS) ? args[i + 1] : 0;
+        if ((int32_t)len < 0 || !user_range_ok(args[i], len, kind == SYSARG_BUF_OUT)) {
+            return 0;
         }
     }
+    return 1;
+}
+
+static int syscall_run(uint32_t nr, const uint32_t args[SYSCALL_MAX_ARGS], int task, int from_user, int from_ring) {
+    if (nr >= SYSCALL_COUNT || !syscall_table[nr].fn) return -1; // Invalid syscall
+
+    const syscall_desc_t* d = &syscall_table[nr];
+    if (from_ring && (d->flags & SYSCALL_F_SYNC)) return -1;
+    if (from_user && !syscall_args_ok(d, args)) return -1;       // Bad user pointer
+    return d->fn(task, args[0], args[1], args[2]);
+}
+
+int syscall_invoke(uint32_t nr, const uint32_t args[SYSCALL_MAX_ARGS], int task, int from_user, int from_ring) {
+#if SYSCALL_STATS
+    uint64_t start = clock_cycles();
+    int result = syscall_run(nr, args, task, from_user, from_ring);
+    systrace_record(nr, args, result, clock_cycles() - start, task, from_ring);
+    return result;
+#else
+    return syscall_run(nr, args, task, from_user, from_ring);
+#endif
+}
+
+// System call dispatcher - routes syscalls to appropriate handlers
+void syscall_dispatcher(registers_t *regs) {
+    uint32_t args[SYSCALL_MAX_ARGS] = {regs->ebx, regs->ecx, regs->edx};
+    regs->eax = (uint32_t)syscall_invoke(regs->eax, args, sched_current_task(), (regs->cs & 3) == 3, 0);
+}
+
+// Write system call - outputs text to the console (buffered, see console.h)
+int sys_write(char *buffer, int length) {
+    if (length < 0) return -1;
+    console_write(buffer, length, vbe_rgb(255, 255, 255));
     return length; // Return number of characters written
 }
 
-// Read system call - placeholder implementation
+// Draw system call - fills a rectangle, clipped to the screen
+int sys_draw_rect(int x, int y, int w, int h, uint32_t color) {
+    extern struct vbe_mode_info* vbe_info;
+    if (!vbe_info || w <= 0 || h <= 0) return -1;
+    vbe_fill_rect(x, y, w, h, color);
+    return 0;
+}
+
+// Read system call - keyboard input through the line discipline (tty.h)
 int sys_read(char *buffer, int length) {
-    (void)buffer;  // Mark parameters as unused
-    (void)length;
-    return 0;      // Return 0 bytes read
+    return tty_read(buffer, length);
+}
+
+// Open system call - the name is copied so it need not be NUL-terminated
+int sys_open(const char *name, int length, int flags, int task) {
+    char path[FS_PATH_MAX];
+    if (length <= 0 || length >= FS_PATH_MAX) return -1;
+    for (int i = 0; i < length; i++) path[i] = name[i];
+    path[length] = '\0';
+    return fs_open(path, flags, task);
 }
 
 // Exit system call - terminates process
 void sys_exit(int status) {
-    // Basic exit - show exit message
     (void)status; // Mark parameter as unused
+    uring_release(sched_current_task());
+    tty_release(sched_current_task());
+    fs_release(sched_current_task());
+
+    // Tasks end here; the boot context and idle tasks cannot exit and
+    // just show the exit message.
+    sched_exit();
     vbe_draw_string(50, 100, "Process exited", vbe_rgb(255, 0, 0), 2);
 }
\ No newline at end of file
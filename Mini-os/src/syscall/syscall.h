@@ -6,17 +6,68 @@
 // System call numbers
 #define SYSCALL_WRITE   0  // Write to output
 #define SYSCALL_READ    1  // Read from input  
-#define SYSCALL_OPEN    2  // Open file
-#define SYSCALL_CLOSE   3  // Close file
+#define SYSCALL_OPEN    2  // Open file: (name, name length, FS_O_* flags), returns fd
+#define SYSCALL_CLOSE   3  // Close file descriptor
 #define SYSCALL_EXEC    4  // Execute program
 #define SYSCALL_EXIT    5  // Exit process
+#define SYSCALL_NOP     6  // Do nothing (measures entry/exit cost)
+#define SYSCALL_DRAW    7  // Fill a rectangle: (x | y << 16, w | h << 16, color)
+#define SYSCALL_URING_SETUP 8  // Register a uring_t (see uring.h)
+#define SYSCALL_URING_ENTER 9  // Wake uringd, wait for min_complete completions
+#define SYSCALL_TTY_MODE 10 // Set TTY_RAW / TTY_ECHO (tty.h), returns the old mode
+#define SYSCALL_FREAD  11  // Read from a file: (fd, buffer, length)
+#define SYSCALL_FWRITE 12  // Write to a file: (fd, buffer, length)
+#define SYSCALL_LSEEK  13  // Move a file offset: (fd, offset, FS_SEEK_*)
+#define SYSCALL_COUNT   14
+
+// Up to three arguments, in EBX, ECX, EDX
+#define SYSCALL_MAX_ARGS 3
+
+// Argument kinds. A buffer argument is followed by its length; calls from
+// ring 3 are rejected unless the whole buffer is user memory.
+#define SYSARG_INT     0  // plain value
+#define SYSARG_BUF_IN  1  // buffer the kernel reads
+#define SYSARG_BUF_OUT 2  // buffer the kernel writes
+
+typedef int (*syscall_fn_t)(int task, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+// syscall_desc_t.flags
+#define SYSCALL_F_SYNC 0x1   // only as a trap, not from a submission ring
+
+typedef struct {
+    const char* name;
+    syscall_fn_t fn;                    // 0: number reserved, not implemented
+    uint8_t nargs;
+    uint8_t flags;
+    uint8_t arg_kind[SYSCALL_MAX_ARGS];
+} syscall_desc_t;
+
+// Program this CPU's SYSENTER MSRs (no-op without SEP). Call after the
+// CPU's GDT and TSS are loaded.
+void syscall_init_cpu(int cpu);
+
+// SYSENTER/SYSEXIT usable on this machine
+int syscall_fast_available(void);
 
 // System call dispatcher - routes interrupts to handler functions
 void syscall_dispatcher(registers_t *regs);
 
+// Table entry for a system call number (0 if out of range)
+const syscall_desc_t* syscall_desc(uint32_t nr);
+
+// Validate and run one call on behalf of task (the trapping task, or the
+// ring's owner). from_user applies the ring 3 buffer checks; from_ring
+// rejects SYSCALL_F_SYNC calls. Returns the call's result or -1.
+int syscall_invoke(uint32_t nr, const uint32_t args[SYSCALL_MAX_ARGS], int task, int from_user, int from_ring);
+
+// Entry from int 0x80 and SYSENTER (regs->eax = number, args in ebx/ecx/edx)
+void syscall_handler(registers_t *regs);
+
 // System call handler functions
 int sys_write(char *buffer, int length);  // Write data to output
 int sys_read(char *buffer, int length);   // Read data from input
 void sys_exit(int status);                // Terminate process
+int sys_draw_rect(int x, int y, int w, int h, uint32_t color); // Fill a rectangle
+int sys_open(const char *name, int length, int flags, int task); // Open a file for task (name need not be terminated)
 
 #endif
\ No newline at end of file
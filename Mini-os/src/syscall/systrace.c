@@ -0,0 +1,118 @@
+#include "systrace.h"
+#include "../idt.h"
+#include "../kernel/smp.h"
+#include "../sched/sync.h"
+
+#define SYSTRACE_SLOTS (SYSCALL_COUNT + 1)
+
+// Per-CPU counters, updated with interrupts off so a preempted caller
+// cannot interleave with another task on the same CPU.
+static systrace_stats_t counters[MAX_CPUS][SYSTRACE_SLOTS];
+
+// Histogram upper bounds in cycles; the last bucket is open.
+static const uint32_t hist_bounds[SYSTRACE_HIST_BUCKETS - 1] = {
+    1000u, 4000u, 16000u, 64000u, 1000000u,
+};
+
+static spinlock_t ring_lock;
+static systrace_entry_t ring[SYSTRACE_RING];
+static uint32_t ring_seq = 0;          // calls recorded so far
+static uint32_t ring_first = 0;        // seq of the oldest kept entry
+static volatile int ring_enabled = 0;
+
+void systrace_init(void) {
+    spin_lock_init(&ring_lock, "systrace");
+}
+
+void systrace_record(uint32_t nr, const uint32_t args[SYSCALL_MAX_ARGS], int result, uint64_t cycles, int task, int from_ring) {
+    uint32_t slot = nr < SYSCALL_COUNT && syscall_desc(nr)->fn ? nr : SYSTRACE_INVALID;
+    uint32_t c = (cycles > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)cycles;
+    int b = 0;
+    while (b < SYSTRACE_HIST_BUCKETS - 1 && c >= hist_bounds[b]) b++;
+
+    uint32_t flags = irq_save();
+    int cpu = smp_cpu_id();
+    systrace_stats_t* s = &counters[cpu][slot];
+    s->count++;
+    if (result < 0) s->errors++;
+    s->total_cycles += c;
+    if (c > s->max_cycles) s->max_cycles = c;
+    s->hist[b]++;
+    irq_restore(flags);
+
+    if (!ring_enabled) return;
+
+    flags = spin_lock_irqsave(&ring_lock);
+    systrace_entry_t* e = &ring[ring_seq % SYSTRACE_RING];
+    e->seq = ring_seq;
+    e->task = task;
+    e->cpu = cpu;
+    e->nr = nr;
+    for (int i = 0; i < SYSCALL_MAX_ARGS; i++) e->args[i] = args[i];
+    e->result = result;
+    e->cycles = c;
+    e->from_ring = from_ring;
+    ring_seq++;
+    if (ring_seq - ring_first > SYSTRACE_RING) ring_first = ring_seq - SYSTRACE_RING;
+    spin_unlock_irqrestore(&ring_lock, flags);
+}
+
+int systrace_get_stats(uint32_t slot, systrace_stats_t* out) {
+    if (slot >= SYSTRACE_SLOTS) return -1;
+
+    // Summed without stopping other CPUs, like irq_stats_get().
+    out->count = 0;
+    out->errors = 0;
+    out->total_cycles = 0;
+    out->max_cycles = 0;
+    for (int b = 0; b < SYSTRACE_HIST_BUCKETS; b++) out->hist[b] = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        const systrace_stats_t* s = &counters[cpu][slot];
+        out->count += s->count;
+        out->errors += s->errors;
+        out->total_cycles += s->total_cycles;
+        if (s->max_cycles > out->max_cycles) out->max_cycles = s->max_cycles;
+        for (int b = 0; b < SYSTRACE_HIST_BUCKETS; b++) out->hist[b] += s->hist[b];
+    }
+    return 0;
+}
+
+void systrace_reset(void) {
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        uint32_t flags = irq_save();
+        for (int slot = 0; slot < SYSTRACE_SLOTS; slot++) {
+            systrace_stats_t* s = &counters[cpu][slot];
+            s->count = 0;
+            s->errors = 0;
+            s->total_cycles = 0;
+            s->max_cycles = 0;
+            for (int b = 0; b < SYSTRACE_HIST_BUCKETS; b++) s->hist[b] = 0;
+        }
+        irq_restore(flags);
+    }
+}
+
+void systrace_set_enabled(int enabled) {
+    ring_enabled = enabled ? 1 : 0;
+}
+
+int systrace_enabled(void) {
+    return ring_enabled;
+}
+
+void systrace_clear(void) {
+    uint32_t flags = spin_lock_irqsave(&ring_lock);
+    ring_first = ring_seq;
+    spin_unlock_irqrestore(&ring_lock, flags);
+}
+
+int systrace_get(int index, systrace_entry_t* out) {
+    int ok = 0;
+    uint32_t flags = spin_lock_irqsave(&ring_lock);
+    if (index >= 0 && (uint32_t)index < ring_seq - ring_first) {
+        *out = ring[(ring_first + (uint32_t)index) % SYSTRACE_RING];
+        ok = 1;
+    }
+    spin_unlock_irqrestore(&ring_lock, flags);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,63 @@
+#ifndef SYSTRACE_H
+#define SYSTRACE_H
+
+#include <stdint.h>
+#include "syscall.h"
+
+// System call accounting for syscall_invoke(): per-number counts, errors
+// (negative results) and latency histograms, kept per CPU, plus an
+// strace-style ring of the most recent calls. The counters are always on;
+// the ring records only while enabled. Build with -DSYSCALL_STATS=0 to
+// compile both out. Latency includes time spent blocked (read,
+// uring_enter); exit never returns and is not counted.
+
+#ifndef SYSCALL_STATS
+#define SYSCALL_STATS 1
+#endif
+
+// Stats slot for numbers without a handler
+#define SYSTRACE_INVALID SYSCALL_COUNT
+
+// Latency histogram buckets in cycles: <1k, <4k, <16k, <64k, <1M, >=1M
+#define SYSTRACE_HIST_BUCKETS 6
+
+#define SYSTRACE_RING 32
+
+typedef struct {
+    uint32_t count;
+    uint32_t errors;
+    uint64_t total_cycles;
+    uint32_t max_cycles;
+    uint32_t hist[SYSTRACE_HIST_BUCKETS];
+} systrace_stats_t;
+
+typedef struct {
+    uint32_t seq;           // increases by one per recorded call
+    int task;
+    int cpu;
+    uint32_t nr;
+    uint32_t args[SYSCALL_MAX_ARGS];
+    int32_t result;
+    uint32_t cycles;
+    int from_ring;          // submitted through a uring, not trapped
+} systrace_entry_t;
+
+// Register the trace ring lock. Call before the first system call.
+void systrace_init(void);
+
+void systrace_record(uint32_t nr, const uint32_t args[SYSCALL_MAX_ARGS], int result, uint64_t cycles, int task, int from_ring);
+
+// Counters for one number (or SYSTRACE_INVALID) summed over CPUs.
+// Returns -1 for slots out of range.
+int systrace_get_stats(uint32_t slot, systrace_stats_t* out);
+void systrace_reset(void);
+
+// Trace ring: start/stop recording, drop what was recorded.
+void systrace_set_enabled(int enabled);
+int systrace_enabled(void);
+void systrace_clear(void);
+
+// Recorded calls, oldest first. Returns -1 past the newest.
+int systrace_get(int index, systrace_entry_t* out);
+
+#endif
@@ -0,0 +1,203 @@
+#include "uring.h"
+#include "syscall.h"
+#include "../kernel/usermode.h"
+#include "../sched/sched.h"
+#include "../sched/sync.h"
+#include "../drivers/clock.h"
+
+#define URINGD_STACK_DWORDS 2048 // 8 KiB
+
+static uint32_t uringd_stack[URINGD_STACK_DWORDS];
+static int uringd_task = -1;
+
+// Registered rings by task id. rings[], draining and uringd_sleeping are
+// guarded by uringd_wq's lock, cq_wanted[] by cq_waiters' lock.
+static uring_t* rings[MAX_TASKS];
+static int draining = -1;               // task whose ring uringd is running
+static uint32_t cq_wanted[MAX_TASKS];   // completions an entering task waits for
+static wait_queue_t uringd_wq;          // uringd sleeps here when idle
+static wait_queue_t cq_waiters;         // tasks blocked in uring_enter()
+static volatile int uringd_sleeping = 0;
+static uring_stats_t stats;
+
+// Run what is queued on one task's ring; stops early if its completion
+// ring is full. Returns the number of entries consumed.
+static uint32_t uring_drain(int task) {
+    // Take the ring under the lock and mark it in use; uring_release()
+    // waits for the drain to finish before the task goes away.
+    uint32_t flags = wait_queue_lock(&uringd_wq);
+    uring_t* r = rings[task];
+    if (r) draining = task;
+    wait_queue_unlock(&uringd_wq, flags);
+    if (!r) return 0;
+
+    uint32_t n = 0;
+    uint32_t head = r->sq_head;
+    for (;;) {
+        uint32_t tail = r->sq_tail;
+        if (head == tail || r->cq_tail - r->cq_head >= URING_ENTRIES) break;
+        __asm__ __volatile__("" ::: "memory");
+
+        // Copy first: the task may refill the slot once sq_head moves.
+        uring_sqe_t sqe = r->sq[head & URING_MASK];
+        int result = syscall_invoke(sqe.opcode, sqe.args, task, 1, 1);
+
+        uint32_t ctail = r->cq_tail;
+        r->cq[ctail & URING_MASK].user_data = sqe.user_data;
+        r->cq[ctail & URING_MASK].result = result;
+        __asm__ __volatile__("" ::: "memory");
+        r->cq_tail = ctail + 1;
+        r->sq_head = ++head;
+        n++;
+    }
+
+    if (n) {
+        stats.submitted += n;
+        flags = wait_queue_lock(&cq_waiters);
+        if (cq_wanted[task] && r->cq_tail - r->cq_head >= cq_wanted[task]) {
+            wait_queue_wake_all(&cq_waiters);
+        }
+        wait_queue_unlock(&cq_waiters, flags);
+    }
+
+    flags = wait_queue_lock(&uringd_wq);
+    draining = -1;
+    wait_queue_wake_all(&uringd_wq); // A releasing task may be waiting
+    wait_queue_unlock(&uringd_wq, flags);
+    return n;
+}
+
+// uringd_wq lock held
+static void set_need_wakeup(int on) {
+    for (int t = 0; t < MAX_TASKS; t++) {
+        if (!rings[t]) continue;
+        if (on) {
+            rings[t]->flags |= URING_NEED_WAKEUP;
+        } else {
+            rings[t]->flags &= ~URING_NEED_WAKEUP;
+        }
+    }
+}
+
+// uringd_wq lock held
+static int any_pending(void) {
+    for (int t = 0; t < MAX_TASKS; t++) {
+        if (rings[t] && rings[t]->sq_head != rings[t]->sq_tail) return 1;
+    }
+    return 0;
+}
+
+__attribute__((noreturn)) static void uringd_main(void) {
+    uint64_t idle_since = clock_ns();
+    for (;;) {
+        uint32_t done = 0;
+        for (int t = 0; t < MAX_TASKS; t++) done += uring_drain(t);
+        if (done) {
+            idle_since = clock_ns();
+            continue;
+        }
+
+        // Keep polling for a while so busy submitters never need to trap.
+        if (clock_ns() - idle_since < URING_IDLE_NS) {
+            sched_yield();
+            continue;
+        }
+
+        // Going to sleep: tell submitters to enter, then look once more.
+        // The full barrier pairs with the one a submitter issues between
+        // advancing sq_tail and reading flags.
+        uint32_t flags = wait_queue_lock(&uringd_wq);
+        set_need_wakeup(1);
+        __sync_synchronize();
+        if (!any_pending()) {
+            uringd_sleeping = 1;
+            while (uringd_sleeping) {
+                wait_queue_sleep(&uringd_wq);
+            }
+            wait_queue_remove(&uringd_wq, uringd_task);
+        }
+        set_need_wakeup(0);
+        wait_queue_unlock(&uringd_wq, flags);
+        idle_since = clock_ns();
+    }
+}
+
+void uring_init(void) {
+    wait_queue_init(&uringd_wq);
+    wait_queue_init(&cq_waiters);
+    for (int t = 0; t < MAX_TASKS; t++) {
+        rings[t] = 0;
+        cq_wanted[t] = 0;
+    }
+    uringd_sleeping = 0;
+    draining = -1;
+    stats.submitted = 0;
+    stats.enters = 0;
+    stats.wakeups = 0;
+    uringd_task = sched_create_task("uringd", uringd_main, uringd_stack, URINGD_STACK_DWORDS);
+}
+
+int uring_setup(uint32_t ring_addr) {
+    int self = sched_current_task();
+    if (self < 0 || self >= MAX_TASKS) return -1;
+    if (!user_range_ok(ring_addr, sizeof(uring_t), 1)) return -1;
+
+    uring_t* r = (uring_t*)(uintptr_t)ring_addr;
+    r->sq_head = 0;
+    r->sq_tail = 0;
+    r->cq_head = 0;
+    r->cq_tail = 0;
+
+    uint32_t flags = wait_queue_lock(&uringd_wq);
+    r->flags = uringd_sleeping ? URING_NEED_WAKEUP : 0;
+    rings[self] = r;
+    wait_queue_unlock(&uringd_wq, flags);
+    return 0;
+}
+
+int uring_enter(uint32_t min_complete) {
+    int self = sched_current_task();
+    uring_t* r = (self >= 0 && self < MAX_TASKS) ? rings[self] : 0;
+    if (!r) return -1;
+    if (min_complete > URING_ENTRIES) min_complete = URING_ENTRIES;
+
+    uint32_t flags = wait_queue_lock(&uringd_wq);
+    stats.enters++;
+    if (uringd_sleeping) {
+        uringd_sleeping = 0;
+        stats.wakeups++;
+        wait_queue_wake_all(&uringd_wq);
+    }
+    wait_queue_unlock(&uringd_wq, flags);
+
+    if (min_complete) {
+        flags = wait_queue_lock(&cq_waiters);
+        cq_wanted[self] = min_complete;
+        while (r->cq_tail - r->cq_head < min_complete) {
+            wait_queue_sleep(&cq_waiters);
+        }
+        cq_wanted[self] = 0;
+        wait_queue_remove(&cq_waiters, self);
+        wait_queue_unlock(&cq_waiters, flags);
+    }
+    return (int)(r->cq_tail - r->cq_head);
+}
+
+void uring_release(int task_id) {
+    if (task_id < 0 || task_id >= MAX_TASKS) return;
+    uint32_t flags = wait_queue_lock(&uringd_wq);
+    rings[task_id] = 0;
+    // No new drain can pick the ring up; let a running one finish so none
+    // of the task's calls run after it is gone.
+    if (draining == task_id) {
+        while (draining == task_id) {
+            wait_queue_sleep(&uringd_wq);
+        }
+        wait_queue_remove(&uringd_wq, sched_current_task());
+    }
+    wait_queue_unlock(&uringd_wq, flags);
+}
+
+void uring_get_stats(uring_stats_t* out) {
+    *out = stats;
+}
@@ -0,0 +1,99 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+
+// Batched asynchronous system calls through a pair of rings shared with
+// the kernel (io_uring style). The task owns the ring memory and registers
+// it once with SYSCALL_URING_SETUP. It fills submission entries (any
+// system call number and its arguments) and advances sq_tail. The "uringd"
+// kernel thread consumes them, runs each call, and posts a completion
+// carrying the entry's user_data and the call's result.
+//
+// While uringd is polling, submissions need no trap at all. Once it has
+// been idle for URING_IDLE_NS it sets URING_NEED_WAKEUP and sleeps, and the
+// next SYSCALL_URING_ENTER wakes it. SYSCALL_URING_ENTER can also block
+// until min_complete completions are waiting, so one trap covers a batch.
+
+#define URING_ENTRIES 64                 // power of two
+#define URING_MASK    (URING_ENTRIES - 1)
+
+// uring_t.flags (set by the kernel)
+#define URING_NEED_WAKEUP 0x1u
+
+// uringd keeps polling this long after the last submission
+#define URING_IDLE_NS 2000000ull
+
+typedef struct {
+    uint32_t opcode;      // system call number (SYSCALL_*)
+    uint32_t user_data;   // copied to the completion
+    uint32_t args[3];     // as EBX, ECX, EDX for int 0x80
+} uring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t result;
+} uring_cqe_t;
+
+typedef struct {
+    volatile uint32_t sq_head;   // next entry the kernel takes
+    volatile uint32_t sq_tail;   // next entry the task fills
+    volatile uint32_t cq_head;   // next completion the task reads
+    volatile uint32_t cq_tail;   // next completion the kernel posts
+    volatile uint32_t flags;
+    uring_sqe_t sq[URING_ENTRIES];
+    uring_cqe_t cq[URING_ENTRIES];
+} uring_t;
+
+// Start the uringd kernel thread. Call after sched_init().
+void uring_init(void);
+
+// SYSCALL_URING_SETUP / SYSCALL_URING_ENTER for the calling task.
+int uring_setup(uint32_t ring_addr);
+int uring_enter(uint32_t min_complete);
+
+// Drop the calling task's ring (on exit); waits if uringd is running its
+// calls right now.
+void uring_release(int task_id);
+
+typedef struct {
+    uint32_t submitted;     // entries consumed from all rings
+    uint32_t enters;        // SYSCALL_URING_ENTER calls
+    uint32_t wakeups;       // enters that had to wake a sleeping uringd
+} uring_stats_t;
+
+void uring_get_stats(uring_stats_t* out);
+
+// Task side, forced inline so ring 3 code can use them from .user.
+
+// Next free submission entry, or 0 if the ring is full.
+static inline __attribute__((always_inline)) uring_sqe_t* uring_get_sqe(uring_t* r) {
+    if (r->sq_tail - r->sq_head >= URING_ENTRIES) return 0;
+    return &r->sq[r->sq_tail & URING_MASK];
+}
+
+// Publish the entry returned by uring_get_sqe().
+static inline __attribute__((always_inline)) void uring_submit(uring_t* r) {
+    __asm__ __volatile__("" ::: "memory");
+    r->sq_tail = r->sq_tail + 1;
+}
+
+// After submitting: uringd is asleep and needs SYSCALL_URING_ENTER. The
+// full barrier orders the sq_tail store before the flags load.
+static inline __attribute__((always_inline)) int uring_need_enter(uring_t* r) {
+    __sync_synchronize();
+    return (r->flags & URING_NEED_WAKEUP) != 0;
+}
+
+// Take one completion; 0 if none is waiting.
+static inline __attribute__((always_inline)) int uring_peek_cqe(uring_t* r, uring_cqe_t* out) {
+    uint32_t head = r->cq_head;
+    if (head == r->cq_tail) return 0;
+    __asm__ __volatile__("" ::: "memory");
+    *out = r->cq[head & URING_MASK];
+    __asm__ __volatile__("" ::: "memory");
+    r->cq_head = head + 1;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,81 @@
+// Host tool: pack files into an initrd image (format in src/fs/initrd.h).
+//
+//   mkinitrd <output> <root dir> <path relative to root>...
+//
+// Paths are stored as given, so the kernel recreates the same tree.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fs/initrd.h"
+
+static uint32_t align_up(uint32_t v, uint32_t a) {
+    return (v + a - 1u) & ~(a - 1u);
+}
+
+static unsigned char* read_file(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* data = malloc(len > 0 ? (size_t)len : 1);
+    if (data && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = 0;
+    }
+    fclose(f);
+    *size = (uint32_t)len;
+    return data;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <output> <root dir> <file>...\n", argv[0]);
+        return 1;
+    }
+    const char* root = argv[2];
+    uint32_t count = (uint32_t)(argc - 3);
+
+    initrd_entry_t* entries = calloc(count ? count : 1, sizeof(initrd_entry_t));
+    unsigned char** data = calloc(count ? count : 1, sizeof(unsigned char*));
+    if (!entries || !data) return 1;
+
+    // Paths follow the entry table; data follows the paths
+    uint32_t pos = (uint32_t)(sizeof(initrd_header_t) + count * sizeof(initrd_entry_t));
+    for (uint32_t i = 0; i < count; i++) {
+        entries[i].path_offset = pos;
+        pos += (uint32_t)strlen(argv[3 + i]) + 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        char full[4096];
+        snprintf(full, sizeof(full), "%s/%s", root, argv[3 + i]);
+        data[i] = read_file(full, &entries[i].size);
+        if (!data[i]) {
+            fprintf(stderr, "mkinitrd: cannot read %s\n", full);
+            return 1;
+        }
+        pos = align_up(pos, INITRD_ALIGN);
+        entries[i].data_offset = pos;
+        pos += entries[i].size;
+    }
+
+    initrd_header_t header = {INITRD_MAGIC, count, align_up(pos, INITRD_ALIGN)};
+
+    FILE* out = fopen(argv[1], "wb");
+    if (!out) {
+        fprintf(stderr, "mkinitrd: cannot create %s\n", argv[1]);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(entries, sizeof(initrd_entry_t), count, out);
+    for (uint32_t i = 0; i < count; i++) {
+        fwrite(argv[3 + i], 1, strlen(argv[3 + i]) + 1, out);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        while ((uint32_t)ftell(out) < entries[i].data_offset) fputc(0, out);
+        fwrite(data[i], 1, entries[i].size, out);
+    }
+    while ((uint32_t)ftell(out) < header.size) fputc(0, out);
+    return fclose(out) == 0 ? 0 : 1;
+}